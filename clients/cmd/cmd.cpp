@@ -25,6 +25,7 @@
 #include "../../common/utils/HexFile.h"
 #include "../../common/utils/FormatableString.h"
 #include "../../common/utils/BootloaderInterface.h"
+#include "../../common/utils/BootloaderFleet.h"
 #include "../../transport/dashel_plugins/dashel-plugins.h"
 #include <iostream>
 #include <fstream>
@@ -33,6 +34,7 @@
 #include <cassert>
 #include <cstring>
 #include <memory>
+#include <deque>
 
 namespace Aseba 
 {
@@ -47,10 +49,13 @@ namespace Aseba
 		stream << "* rdpage : bootloader read page [dest] [page number]\n";
 		stream << "* rdpageusb : bootloader read page usb [dest] [page number]\n";
 		stream << "* whex : write hex file [dest] [file name] [reset]\n";
+		stream << "* whexdiff : write only the pages of hex file that differ from the flash [dest] [file name] [reset]\n";
+		stream << "* whexfleet : write hex file to many nodes at once, resetting them [file name] [dest or dest@target] ...\n";
 		stream << "* rhex : read hex file [source] [file name]\n";
 		stream << "* eb: exit from bootloader, go back into user mode [dest]\n";
 		stream << "* sb: switch into bootloader: reboot node, then enter bootloader for a while [dest]\n";
 		stream << "* sleep: put the vm to sleep [dest]\n";
+		stream << "* profile: print the counters of the profiler of the vm, then clear them if reset is given [dest] [reset]\n";
 		stream << "* wusb : write hex file to [dest] [file name] [reset]\n";
 	}
 	
@@ -176,6 +181,11 @@ namespace Aseba
 			cout << "In bootloader, about to write " << pagesCount << " pages" << endl;
 		}
 		
+		virtual void writeHexPagesCompared(unsigned unchangedCount, unsigned changedCount)
+		{
+			cout << unchangedCount << " pages unchanged and skipped, " << changedCount << " pages to write" << endl;
+		}
+		
 		virtual void writeHexWritten()
 		{
 			cout << "Write completed" << endl;
@@ -192,8 +202,105 @@ namespace Aseba
 		}
 	};
 	
+	class CmdBootloaderFleet:public BootloaderFleet
+	{
+	public:
+		CmdBootloaderFleet(const string& hexFileName):
+			BootloaderFleet(hexFileName)
+		{}
+	
+	protected:
+		// reporting function
+		virtual void nodeProgress(const Node& node)
+		{
+			// report every tenth of the pages, as many nodes are written at once
+			const size_t step(max<size_t>(node.pages.size() / 10, 1));
+			if ((node.ackedCount % step == 0) || (node.ackedCount == node.pages.size()))
+				cout << node.target << " node " << node.dest << ": " << node.ackedCount << "/" << node.pages.size() << " pages" << endl;
+		}
+		
+		virtual void nodeRetry(const Node& node, const string& reason)
+		{
+			cout << node.target << " node " << node.dest << ": " << reason << ", retrying" << endl;
+		}
+		
+		virtual void nodeFinished(const Node& node)
+		{
+			cout << node.target << " node " << node.dest << ": " << (node.state == Node::DONE ? "done" : "failed, " + node.error) << endl;
+		}
+	};
+	
+	//! Write an hex file to the nodes given as dest or dest@target in argv, return the number of arguments eaten
+	int processFleetCommand(const char* target, int argc, char *argv[])
+	{
+		// first arg is file name, then nodes
+		if (argc < 3)
+			errorMissingArgument(argv[0]);
+		
+		try
+		{
+			CmdBootloaderFleet fleet(argv[1]);
+			for (int i = 2; i < argc; ++i)
+			{
+				const char* at(strchr(argv[i], '@'));
+				fleet.addNode(at ? string(at + 1) : string(target), atoi(argv[i]));
+			}
+			
+			const unsigned failuresCount(fleet.upgrade());
+			fleet.dumpReport(cout);
+			if (failuresCount)
+				exit(11);
+		}
+		catch (HexFile::Error &e)
+		{
+			errorHexFile(e.toString());
+		}
+		catch (Dashel::DashelException e)
+		{
+			errorServerDisconnected();
+		}
+		
+		return argc - 1;
+	}
+	
+	//! A hub keeping the messages it receives, for commands which must not wait forever for an answer
+	class CmdHub: public Hub
+	{
+	public:
+		virtual ~CmdHub()
+		{
+			for (deque<Message*>::iterator it = messages.begin(); it != messages.end(); ++it)
+				delete *it;
+		}
+		
+		//! Return the next message received within timeout ms, to be deleted by the caller, or 0 if none was
+		Message* receive(UnifiedTime::Value timeout)
+		{
+			const UnifiedTime startTime;
+			while (messages.empty())
+			{
+				const UnifiedTime::Value elapsed((UnifiedTime() - startTime).value);
+				if (elapsed >= timeout)
+					return 0;
+				step(int(timeout - elapsed));
+			}
+			Message* message(messages.front());
+			messages.pop_front();
+			return message;
+		}
+		
+	protected:
+		virtual void incomingData(Stream *stream)
+		{
+			messages.push_back(Message::receive(stream));
+		}
+		
+	protected:
+		deque<Message*> messages; //!< messages received but not processed yet
+	};
+	
 	//! Process a command, return the number of arguments eaten (not counting the command itself)
-	int processCommand(Stream* stream, int argc, char *argv[])
+	int processCommand(CmdHub& hub, Stream* stream, int argc, char *argv[])
 	{
 		const char *cmd = argv[0];
 		int argEaten = 0;
@@ -261,7 +368,7 @@ namespace Aseba
 			else
 				errorReadPage(atoi(argv[2]));
 		}
-		else if (strcmp(cmd, "whex") == 0)
+		else if ((strcmp(cmd, "whex") == 0) || (strcmp(cmd, "whexdiff") == 0))
 		{
 			bool reset = 0;
 			// first arg is dest, second is file name
@@ -279,7 +386,7 @@ namespace Aseba
 			try
 			{
 				CmdBootloaderInterface bootloader(stream, atoi(argv[1]));
-				bootloader.writeHex(argv[2], reset, false);
+				bootloader.writeHex(argv[2], reset, false, strcmp(cmd, "whexdiff") == 0);
 			}
 			catch (HexFile::Error &e)
 			{
@@ -386,6 +493,59 @@ namespace Aseba
 			Sleep msg(dest);
 			msg.serialize(stream);
 			stream->flush();
+		}
+		else if (strcmp(cmd, "profile") == 0)
+		{
+			bool reset = false;
+			// first arg is dest
+			if (argc < 2)
+				errorMissingArgument(argv[0]);
+			argEaten = 1;
+			
+			if (argc > 2 && !strcmp(argv[2], "reset"))
+			{
+				reset = true;
+				argEaten = 2;
+			}
+			
+			const uint16 dest(atoi(argv[1]));
+			GetProfile(dest).serialize(stream);
+			stream->flush();
+			
+			// the node sends one message per event handler or subroutine,
+			// it does not answer if its vm was compiled without profiler, so give up after a while
+			const UnifiedTime::Value timeout(1000);
+			const UnifiedTime startTime;
+			bool received(false);
+			while (true)
+			{
+				const UnifiedTime::Value elapsed((UnifiedTime() - startTime).value);
+				auto_ptr<Message> message(elapsed < timeout ? hub.receive(timeout - elapsed) : 0);
+				if (!message.get())
+				{
+					cerr << (received ? "incomplete profile received" : "no profile received") << endl;
+					break;
+				}
+				if (message->type != ASEBA_MESSAGE_PROFILE)
+					continue;
+				const Profile *profile(static_cast<const Profile *>(message.get()));
+				if (profile->source != dest)
+					continue;
+				if (!received)
+					cout << "address instructions native_calls native_time" << endl;
+				received = true;
+				if (profile->entriesCount == 0)
+					break;
+				cout << profile->address << " " << profile->instructionsCount << " " << profile->nativeCallsCount << " " << profile->nativeTime << endl;
+				if (profile->index + 1 >= profile->entriesCount)
+					break;
+			}
+			
+			if (reset)
+			{
+				ResetProfile(dest).serialize(stream);
+				stream->flush();
+			}
 		} else 
 			errorUnknownCommand(cmd);
 		
@@ -426,16 +586,21 @@ int main(int argc, char *argv[])
 			Aseba::dumpVersion(std::cout);
 			return 0;
 		}
+		else if (strcmp(arg, "whexfleet") == 0)
+		{
+			// the fleet connects to its targets itself
+			argCounter += Aseba::processFleetCommand(target, argc - argCounter, &argv[argCounter]);
+		}
 		else
 		{
-			Dashel::Hub client;
+			Aseba::CmdHub client;
 			Dashel::Stream* stream = client.connect(target);
 			assert(stream);
 			
 			// process command
 			try
 			{
-				 argCounter += Aseba::processCommand(stream, argc - argCounter, &argv[argCounter]);
+				 argCounter += Aseba::processCommand(client, stream, argc - argCounter, &argv[argCounter]);
 				 stream->flush();
 			}
 			catch (Dashel::DashelException e)
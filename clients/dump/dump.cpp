@@ -43,6 +43,7 @@ namespace Aseba
 	{
 	private:
 		bool rawTime; //!< should displayed timestamps be of the form sec:usec since 1970
+		MessagePool messagePool; //!< reusable instances of received messages
 	
 	public:
 		Dump(bool rawTime) :
@@ -60,7 +61,7 @@ namespace Aseba
 		
 		void incomingData(Stream *stream)
 		{
-			Message *message = Message::receive(stream);
+			Message *message = messagePool.receive(stream);
 			
 			dumpTime(cout, rawTime);
 			cout << stream->getTargetName()  << " ";
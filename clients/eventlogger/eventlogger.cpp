@@ -5,6 +5,8 @@
 #include <cmath>
 #include <QtGui>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -26,38 +28,154 @@ using namespace Dashel;
 using namespace Aseba;
 using namespace std;
 
+//! History of the values of an event, bounded to a number of samples.
+//! For zoomed-out views, it keeps a pyramid of the minimum and maximum values
+//! over blocks of 2, 4, 8, ... samples, so that the cost of a plot depends on
+//! its width and not on the number of samples.
+class EventHistory
+{
+public:
+	//! Minimum and maximum values over a block of samples
+	struct MinMax
+	{
+		sint16 min;
+		sint16 max;
+	};
+
+protected:
+	size_t capacity; //!< maximum number of samples kept
+	unsigned long long totalCount; //!< number of samples ever added
+	vector<double> timeStamps; //!< ring of time stamps
+	vector<vector<sint16> > values; //!< for each variable, ring of values
+	//! for each level above 0, for each variable, ring of min/max over blocks of 2^level samples
+	vector<vector<vector<MinMax> > > pyramid;
+	unsigned level; //!< level used for plotting, 0 for all samples
+
+public:
+	EventHistory(size_t variablesCount, size_t capacity) :
+		capacity(capacity),
+		totalCount(0),
+		timeStamps(capacity),
+		values(variablesCount, vector<sint16>(capacity)),
+		level(0)
+	{
+		for (unsigned l = 1; (capacity >> l) > 0; ++l)
+			pyramid.push_back(vector<vector<MinMax> >(variablesCount, vector<MinMax>(bucketsCapacity(l))));
+	}
+	
+	//! Add a sample at time, missing values being 0
+	void add(double time, const vector<sint16>& data)
+	{
+		const size_t pos(totalCount % capacity);
+		timeStamps[pos] = time;
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			const sint16 value(i < data.size() ? data[i] : 0);
+			values[i][pos] = value;
+			for (unsigned l = 1; l <= pyramid.size(); ++l)
+			{
+				MinMax& minMax(pyramid[l-1][i][(totalCount >> l) % bucketsCapacity(l)]);
+				// first sample of the block, reset it
+				if ((totalCount & ((1ULL << l) - 1)) == 0)
+				{
+					minMax.min = value;
+					minMax.max = value;
+				}
+				else
+				{
+					minMax.min = std::min(minMax.min, value);
+					minMax.max = std::max(minMax.max, value);
+				}
+			}
+		}
+		++totalCount;
+	}
+	
+	//! Return the number of variables
+	size_t variablesCount() const { return values.size(); }
+	
+	//! Select the smallest level that yields at most maxPoints points, without going to a level that yields none
+	void selectLevel(size_t maxPoints)
+	{
+		level = 0;
+		while ((level < pyramid.size()) && (pointsCount(level) > maxPoints) && (pointsCount(level + 1) > 0))
+			++level;
+	}
+	
+	//! Return the number of points to plot at the selected level
+	size_t pointsCount() const { return pointsCount(level); }
+	
+	//! Return the time of the i-th point to plot at the selected level
+	double x(size_t i) const
+	{
+		if (level == 0)
+			return timeStamps[(oldest() + i) % capacity];
+		else
+			return timeStamps[((firstBucket(level) + i / 2) << level) % capacity];
+	}
+	
+	//! Return the value of variable for the i-th point to plot at the selected level, alternatively the minimum and the maximum of blocks if above level 0
+	double y(size_t variable, size_t i) const
+	{
+		if (level == 0)
+			return values[variable][(oldest() + i) % capacity];
+		const MinMax& minMax(pyramid[level-1][variable][(firstBucket(level) + i / 2) % bucketsCapacity(level)]);
+		return (i % 2 == 0) ? minMax.min : minMax.max;
+	}
+
+protected:
+	//! Return the absolute index of the oldest sample in history
+	unsigned long long oldest() const { return totalCount > capacity ? totalCount - capacity : 0; }
+	
+	//! Return the number of blocks kept at level l
+	size_t bucketsCapacity(unsigned l) const { return (capacity >> l) + 2; }
+	
+	//! Return the first block at level l whose samples are all in history
+	unsigned long long firstBucket(unsigned l) const { return (oldest() + (1ULL << l) - 1) >> l; }
+	
+	//! Return the number of points to plot at level l, two per block above level 0
+	size_t pointsCount(unsigned l) const
+	{
+		if (l == 0)
+			return totalCount - oldest();
+		const unsigned long long endBucket(totalCount >> l);
+		const unsigned long long beginBucket(firstBucket(l));
+		return endBucket > beginBucket ? 2 * (endBucket - beginBucket) : 0;
+	}
+};
+
 #if QWT_VERSION >= 0x060000
 class EventDataWrapper : public QwtSeriesData<QPointF>
 {
 private:
-	std::vector<double>& _x;
-	std::vector<sint16>& _y;
-	
+	const EventHistory& history;
+	size_t variable;
+
 public:
-	EventDataWrapper(std::vector<double>& _x, std::vector<sint16>& _y) :
-		_x(_x),
-		_y(_y)
+	EventDataWrapper(const EventHistory& history, size_t variable) :
+		history(history),
+		variable(variable)
 	{ }
 	virtual QRectF boundingRect () const { return qwtBoundingRect(*this); }
-	virtual QPointF sample (size_t i) const { return QPointF(_x[i], double(_y[i])); }
-	virtual size_t size () const { return _x.size(); }
+	virtual QPointF sample (size_t i) const { return QPointF(history.x(i), history.y(variable, i)); }
+	virtual size_t size () const { return history.pointsCount(); }
 };
 #else
 class EventDataWrapper : public QwtData
 {
 private:
-	std::vector<double>& _x;
-	std::vector<sint16>& _y;
-	
+	const EventHistory& history;
+	size_t variable;
+
 public:
-	EventDataWrapper(std::vector<double>& _x, std::vector<sint16>& _y) :
-		_x(_x),
-		_y(_y)
+	EventDataWrapper(const EventHistory& history, size_t variable) :
+		history(history),
+		variable(variable)
 	{ }
 	virtual QwtData *   copy () const { return new EventDataWrapper(*this); }
-	virtual size_t   size () const { return _x.size(); }
-	virtual double x (size_t i) const { return _x[i]; }
-	virtual double y (size_t i) const { return (double)_y[i]; }
+	virtual size_t   size () const { return history.pointsCount(); }
+	virtual double x (size_t i) const { return history.x(i); }
+	virtual double y (size_t i) const { return history.y(variable, i); }
 };
 #endif
 
@@ -66,21 +184,34 @@ class EventLogger : public Hub, public QwtPlot
 protected:
 	Stream* stream;
 	int eventId;
-	vector<vector<sint16> > values;
-	vector<double> timeStamps;
+	EventHistory history;
+	bool historyChanged;
 	QTime startingTime;
+	QTime lastReplotTime;
+	QTime lastFlushTime;
+	vector<char> outputFileBuffer;
 	ofstream outputFile;
+	MessagePool messagePool;
 	
+	//! Minimum duration between two replots in ms, to cap the frame rate
+	static const int replotInterval = 40;
+	//! Size of the buffer of the output file
+	static const size_t outputFileBufferSize = 65536;
+
 public:
-	EventLogger(const char* target, int eventId, int eventVariablesCount, const char* filename) :
+	EventLogger(const char* target, int eventId, int eventVariablesCount, const char* filename, size_t historyLength) :
 		QwtPlot(QwtText(QString(tr("Plot for event %0")).arg(eventId))),
 		eventId(eventId),
-		values(eventVariablesCount)
+		history(eventVariablesCount, historyLength),
+		historyChanged(false),
+		outputFileBuffer(outputFileBufferSize)
 	{
 		stream = Hub::connect(target);
 		cout << "Connected to " << stream->getTargetName() << endl;
 		
 		startingTime = QTime::currentTime();
+		lastReplotTime = startingTime;
+		lastFlushTime = startingTime;
 		
 		setCanvasBackground(Qt::white);
 		setAxisTitle(xBottom, tr("Time (seconds)"));
@@ -90,22 +221,26 @@ public:
 		//legend->setItemMode(QwtLegend::CheckableItem);
 		insertLegend(legend, QwtPlot::BottomLegend);
 		
-		for (size_t i = 0; i < values.size(); i++)
+		for (size_t i = 0; i < history.variablesCount(); i++)
 		{
 			QwtPlotCurve *curve = new QwtPlotCurve(QString("%0").arg(i));
 			#if QWT_VERSION >= 0x060000
-			curve->setData(new EventDataWrapper(timeStamps, values[i]));
+			curve->setData(new EventDataWrapper(history, i));
 			#else
-			curve->setData(EventDataWrapper(timeStamps, values[i]));
+			curve->setData(EventDataWrapper(history, i));
 			#endif
 			curve->attach(this);
-			curve->setPen(QColor::fromHsv((i * 360) / values.size(), 255, 100));
+			curve->setPen(QColor::fromHsv((i * 360) / history.variablesCount(), 255, 100));
 		}
 		
 		resize(1000, 600);
 		
 		if (filename)
+		{
+			// the buffer must be set before opening the file
+			outputFile.rdbuf()->pubsetbuf(&outputFileBuffer[0], outputFileBuffer.size());
 			outputFile.open(filename);
+		}
 		
 		startTimer(10);
 	}
@@ -115,41 +250,46 @@ protected:
 	{
 		if (!step(0))
 			close();
+		
+		// replot at a capped frame rate, only if new data arrived
+		const QTime now(QTime::currentTime());
+		if (historyChanged && (lastReplotTime.msecsTo(now) >= replotInterval))
+		{
+			// at most two points per horizontal pixel
+			history.selectLevel(2 * canvas()->width());
+			replot();
+			historyChanged = false;
+			lastReplotTime = now;
+		}
+		
+		// write the output file regularly, rather than after each line
+		if (outputFile.is_open() && (lastFlushTime.msecsTo(now) >= 1000))
+		{
+			outputFile.flush();
+			lastFlushTime = now;
+		}
 	}
 	
 	void incomingData(Stream *stream)
 	{
-		Message *message = Message::receive(stream);
-		UserMessage *userMessage = dynamic_cast<UserMessage *>(message);
-		if (userMessage)
+		Message *message = messagePool.receive(stream);
+		if (message->isUserMessage())
 		{
+			UserMessage *userMessage = static_cast<UserMessage *>(message);
 			if (userMessage->type == eventId)
 			{
 				double elapsedTime = (double)startingTime.msecsTo(QTime::currentTime()) / 1000.;
 				if (outputFile.is_open())
-					outputFile << elapsedTime;
-				timeStamps.push_back(elapsedTime);
-				for (size_t i = 0; i < values.size(); i++)
 				{
-					if (i < userMessage->data.size())
-					{
-						if (outputFile.is_open())
-							outputFile << " " << userMessage->data[i];
-						values[i].push_back(userMessage->data[i]);
-					}
-					else
-					{
-						if (outputFile.is_open())
-							outputFile << " " << 0;
-						values[i].push_back(0);
-					}
+					outputFile << elapsedTime;
+					for (size_t i = 0; i < history.variablesCount(); i++)
+						outputFile << " " << (i < userMessage->data.size() ? userMessage->data[i] : 0);
+					outputFile << "\n";
 				}
-				if (outputFile.is_open())
-					outputFile << endl;
-				replot();
+				history.add(elapsedTime, userMessage->data);
+				historyChanged = true;
 			}
 		}
-		delete message;
 	}
 	
 	void connectionClosed(Stream *stream, bool abnormal)
@@ -166,9 +306,28 @@ protected:
 int main(int argc, char *argv[])
 {
 	Dashel::initPlugins();
-	if (argc < 4)
+	
+	// options, then positional arguments
+	size_t historyLength = 65536;
+	vector<const char*> arguments;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--history") == 0)
+		{
+			if ((i + 1 >= argc) || (atoi(argv[i + 1]) <= 0))
+			{
+				cerr << "positive history length needed" << endl;
+				return 1;
+			}
+			historyLength = atoi(argv[++i]);
+		}
+		else
+			arguments.push_back(argv[i]);
+	}
+	
+	if (arguments.size() < 3)
 	{
-		cerr << "Usage " << argv[0] << " target event_id event_variables_count [output file]" << endl;
+		cerr << "Usage " << argv[0] << " [--history SAMPLES] target event_id event_variables_count [output file]" << endl;
 		return 1;
 	}
 	
@@ -177,7 +336,7 @@ int main(int argc, char *argv[])
 	int res;
 	try
 	{
-		EventLogger logger(argv[1], atoi(argv[2]), atoi(argv[3]), (argc > 4 ? argv[4] : 0));
+		EventLogger logger(arguments[0], atoi(arguments[1]), atoi(arguments[2]), (arguments.size() > 3 ? arguments[3] : 0), historyLength);
 		logger.show();
 		res = app.exec();
 	}
@@ -19,6 +19,7 @@
 */
 
 #include <memory>
+#include <set>
 #include <cassert>
 #include <iostream>
 #include <dashel/dashel.h>
@@ -31,6 +32,7 @@
 #include <QString>
 #include <QStringList>
 #include <QFile>
+#include <QDir>
 #include <QDomDocument>
 
 namespace Aseba 
@@ -42,13 +44,17 @@ namespace Aseba
 	{
 	protected:
 		QString fileName;
+		std::string cacheFileName;
 		Stream* stream;
 		
 	public:
-		MassLoader(const QString& fileName):fileName(fileName),stream(0) {}
+		MassLoader(const QString& fileName);
 		void loadToTarget(const std::string& target);
 		
 	protected:
+		std::set<unsigned> readExpectedNodesIds() const;
+		
+
 		// from Hub
 		virtual void connectionCreated(Stream *stream);
 		virtual void incomingData(Stream *stream);
@@ -56,8 +62,17 @@ namespace Aseba
 	
 		// from DescriptionsManager
 		virtual void nodeDescriptionReceived(unsigned nodeId);
+		virtual void nodeDescriptionHashUnknown(unsigned nodeId);
 	};
 	
+	MassLoader::MassLoader(const QString& fileName):
+		fileName(fileName),
+		cacheFileName(QDir(QDir::homePath()).filePath(".aseba-descriptions-cache").toStdString()),
+		stream(0)
+	{
+		loadDescriptionsCache(cacheFileName);
+	}
+	
 	void MassLoader::loadToTarget(const std::string& target)
 	{
 		while (true)
@@ -67,6 +82,10 @@ namespace Aseba
 				stream = connect(target);
 				if (stream)
 				{
+					// first ask for descriptions hashes, nodes whose hash is in cache will not need to send their descriptions
+					GetDescriptionHash().serialize(stream);
+					stream->flush();
+					
 					// TODO: make this timeout a parameter
 					// wait 1 s
 					UnifiedTime now;
@@ -78,9 +97,17 @@ namespace Aseba
 						step(delta);
 					}
 					
-					// requests description
-					GetDescription().serialize(stream);
-					stream->flush();
+					// requests descriptions, if some nodes we have code for did not answer to the hash request
+					const std::set<unsigned> expectedNodesIds(readExpectedNodesIds());
+					bool missing(nodesDescriptions.empty() && pendingCacheKeys.empty());
+					for (std::set<unsigned>::const_iterator it = expectedNodesIds.begin(); it != expectedNodesIds.end(); ++it)
+						if ((nodesDescriptions.find(*it) == nodesDescriptions.end()) && (pendingCacheKeys.find(*it) == pendingCacheKeys.end()))
+							missing = true;
+					if (missing)
+					{
+						GetDescription().serialize(stream);
+						stream->flush();
+					}
 					// then run
 					run();
 				}
@@ -91,6 +118,23 @@ namespace Aseba
 		}
 	}
 	
+	std::set<unsigned> MassLoader::readExpectedNodesIds() const
+	{
+		std::set<unsigned> ids;
+		
+		QFile file(fileName);
+		if (!file.open(QFile::ReadOnly))
+			return ids;
+		QDomDocument document("aesl-source");
+		if (!document.setContent(&file, false))
+			return ids;
+		
+		for (QDomElement element = document.documentElement().firstChildElement("node"); !element.isNull(); element = element.nextSiblingElement("node"))
+			if (element.hasAttribute("nodeId"))
+				ids.insert(element.attribute("nodeId").toUInt());
+		return ids;
+	}
+	
 	void MassLoader::connectionCreated(Stream *stream)
 	{
 		//cerr << "Connection created to " << stream->getTargetName() << endl;
@@ -123,11 +167,22 @@ namespace Aseba
 		reset();
 	}
 	
+	void MassLoader::nodeDescriptionHashUnknown(unsigned nodeId)
+	{
+		// only this node has to send its description
+		assert(stream);
+		GetNodeDescription(nodeId).serialize(stream);
+		stream->flush();
+	}
+	
 	void MassLoader::nodeDescriptionReceived(unsigned nodeId)
 	{
 		//cerr << "Description received" << endl;
 		assert(stream);
 		
+		// the description might be new, keep the cache up to date
+		saveDescriptionsCache(cacheFileName);
+		
 		// we have a new node description, load file to see if there is code for it
 		CommonDefinitions commonDefinitions;
 		
@@ -0,0 +1,204 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "capture.h"
+#include "../../common/consts.h"
+#include <cstring>
+#include <algorithm>
+
+namespace Aseba
+{
+	/** \addtogroup logfile */
+	/*@{*/
+	
+	//! Full memory barrier, so that the content of the ring is visible to the other thread before the updated head or tail
+	#if defined(WIN32) && !defined(__GNUC__)
+	#define CAPTURE_MEMORY_BARRIER() MemoryBarrier()
+	#else
+	#define CAPTURE_MEMORY_BARRIER() __sync_synchronize()
+	#endif
+	
+	//! Each frame in the ring is preceded by its size (uint16) and its time (uint64), in host byte order
+	static const size_t frameHeaderSize = 10;
+	
+	CaptureRing::CaptureRing(size_t capacity) :
+		capacity(1),
+		head(0),
+		tail(0)
+	{
+		// a power of two allows the counters to wrap around without breaking the positions in data
+		while (this->capacity < capacity)
+			this->capacity *= 2;
+		data = new uint8[this->capacity];
+	}
+	
+	CaptureRing::~CaptureRing()
+	{
+		delete[] data;
+	}
+	
+	bool CaptureRing::push(UnifiedTime::Value time, const uint8* frame, size_t size)
+	{
+		const size_t needed(frameHeaderSize + size);
+		const size_t currentHead(head);
+		const size_t currentTail(tail);
+		CAPTURE_MEMORY_BARRIER();
+		if (capacity - (currentHead - currentTail) < needed)
+			return false;
+		
+		const uint16 frameSize(size);
+		copyIn(currentHead, &frameSize, sizeof(frameSize));
+		copyIn(currentHead + sizeof(frameSize), &time, sizeof(time));
+		copyIn(currentHead + frameHeaderSize, frame, size);
+		
+		CAPTURE_MEMORY_BARRIER();
+		head = currentHead + needed;
+		return true;
+	}
+	
+	bool CaptureRing::pushOverwrite(UnifiedTime::Value time, const uint8* frame, size_t size)
+	{
+		const size_t needed(frameHeaderSize + size);
+		if (needed > capacity)
+			return false;
+		
+		// drop the oldest frames until there is enough space
+		while (capacity - (head - tail) < needed)
+		{
+			uint16 frameSize;
+			copyOut(tail, &frameSize, sizeof(frameSize));
+			tail = tail + frameHeaderSize + frameSize;
+		}
+		
+		return push(time, frame, size);
+	}
+	
+	bool CaptureRing::pop(UnifiedTime::Value& time, std::vector<uint8>& frame)
+	{
+		size_t currentTail(tail);
+		if (!read(currentTail, time, frame))
+			return false;
+		
+		CAPTURE_MEMORY_BARRIER();
+		tail = currentTail;
+		return true;
+	}
+	
+	bool CaptureRing::read(size_t& pos, UnifiedTime::Value& time, std::vector<uint8>& frame) const
+	{
+		const size_t currentHead(head);
+		CAPTURE_MEMORY_BARRIER();
+		if (pos == currentHead)
+			return false;
+		
+		uint16 frameSize;
+		copyOut(pos, &frameSize, sizeof(frameSize));
+		copyOut(pos + sizeof(frameSize), &time, sizeof(time));
+		frame.resize(frameSize);
+		if (frameSize)
+			copyOut(pos + frameHeaderSize, &frame[0], frameSize);
+		
+		pos += frameHeaderSize + frameSize;
+		return true;
+	}
+	
+	void CaptureRing::copyIn(size_t pos, const void* source, size_t size)
+	{
+		const size_t offset(pos & (capacity - 1));
+		const size_t firstPart(std::min(size, capacity - offset));
+		memcpy(data + offset, source, firstPart);
+		memcpy(data, reinterpret_cast<const uint8*>(source) + firstPart, size - firstPart);
+	}
+	
+	void CaptureRing::copyOut(size_t pos, void* dest, size_t size) const
+	{
+		const size_t offset(pos & (capacity - 1));
+		const size_t firstPart(std::min(size, capacity - offset));
+		memcpy(dest, data + offset, firstPart);
+		memcpy(reinterpret_cast<uint8*>(dest) + firstPart, data, size - firstPart);
+	}
+	
+	//
+	
+	CaptureWriterThread::CaptureWriterThread(CaptureRing& ring, LogWriter& writer) :
+		ring(ring),
+		writer(writer),
+		stopRequested(false)
+	{
+		#ifdef WIN32
+		thread = CreateThread(0, 0, win32Run, this, 0, 0);
+		#else // WIN32
+		pthread_create(&thread, 0, run, this);
+		#endif // WIN32
+	}
+	
+	CaptureWriterThread::~CaptureWriterThread()
+	{
+		CAPTURE_MEMORY_BARRIER();
+		stopRequested = true;
+		#ifdef WIN32
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+		#else // WIN32
+		pthread_join(thread, 0);
+		#endif // WIN32
+	}
+	
+	void* CaptureWriterThread::run(void* arg)
+	{
+		CaptureWriterThread* that(reinterpret_cast<CaptureWriterThread*>(arg));
+		UnifiedTime::Value time;
+		std::vector<uint8> frame;
+		frame.reserve(ASEBA_MAX_EVENT_ARG_SIZE + 6);
+		UnifiedTime lastFlushTime;
+		while (true)
+		{
+			// read stopRequested before draining, so that no frame pushed before the request is lost
+			const bool stopping(that->stopRequested);
+			CAPTURE_MEMORY_BARRIER();
+			
+			// the writer buffers frames, so that the disk sees large sequential writes
+			while (that->ring.pop(time, frame))
+				that->writer.write(UnifiedTime(time), &frame[0], frame.size());
+			
+			if (stopping)
+				break;
+			
+			// write regularly so that little is lost if we are killed
+			if ((UnifiedTime() - lastFlushTime).value >= 1000)
+			{
+				that->writer.flush();
+				lastFlushTime = UnifiedTime();
+			}
+			UnifiedTime(10).sleep();
+		}
+		return 0;
+	}
+	
+	#ifdef WIN32
+	DWORD WINAPI CaptureWriterThread::win32Run(LPVOID arg)
+	{
+		run(arg);
+		return 0;
+	}
+	#endif // WIN32
+	
+	/*@}*/
+} // namespace Aseba
@@ -0,0 +1,104 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEBA_CAPTURE_H
+#define ASEBA_CAPTURE_H
+
+#include "logfile.h"
+#include <vector>
+#ifdef WIN32
+	#include <windows.h>
+#else // WIN32
+	#include <pthread.h>
+#endif // WIN32
+
+namespace Aseba
+{
+	/** \addtogroup logfile */
+	/*@{*/
+	
+	//! A ring buffer of timestamped frames in memory.
+	//! One thread can push while another one pops without any lock.
+	//! When used from a single thread, it can also keep the latest frames, dropping the oldest ones.
+	class CaptureRing
+	{
+	public:
+		//! Create a ring of at least capacity bytes
+		CaptureRing(size_t capacity);
+		//! Free the ring
+		~CaptureRing();
+		
+		//! Add a frame received at time, return false if there is not enough space; only call from the producer thread
+		bool push(UnifiedTime::Value time, const uint8* frame, size_t size);
+		//! Add a frame received at time, dropping the oldest frames if required; only call when no other thread uses the ring
+		bool pushOverwrite(UnifiedTime::Value time, const uint8* frame, size_t size);
+		//! Remove the oldest frame and copy it to time and frame, return false if the ring is empty; only call from the consumer thread
+		bool pop(UnifiedTime::Value& time, std::vector<uint8>& frame);
+		
+		//! Return the position of the oldest frame, to read frames without removing them
+		size_t begin() const { return tail; }
+		//! Copy the frame at pos to time and frame and move pos to the next frame, return false at the end; only call when no other thread uses the ring
+		bool read(size_t& pos, UnifiedTime::Value& time, std::vector<uint8>& frame) const;
+	
+	protected:
+		//! Copy size bytes from source to the ring at pos, wrapping around if needed
+		void copyIn(size_t pos, const void* source, size_t size);
+		//! Copy size bytes from the ring at pos to dest, wrapping around if needed
+		void copyOut(size_t pos, void* dest, size_t size) const;
+	
+	protected:
+		uint8* data; //!< content of the ring
+		size_t capacity; //!< size of data, a power of two
+		volatile size_t head; //!< count of bytes ever written, only modified by the producer
+		volatile size_t tail; //!< count of bytes ever read, only modified by the consumer
+	};
+	
+	//! A thread writing the frames of a ring to a log file in the background, so that a slow disk does not block the reception of messages
+	class CaptureWriterThread
+	{
+	public:
+		//! Create the thread, which starts draining ring into writer
+		CaptureWriterThread(CaptureRing& ring, LogWriter& writer);
+		//! Wait until all frames are written, and stop the thread
+		~CaptureWriterThread();
+	
+	protected:
+		//! Body of the thread
+		static void* run(void* arg);
+		#ifdef WIN32
+		//! Entry point of the thread for the Windows API, calls run()
+		static DWORD WINAPI win32Run(LPVOID arg);
+		#endif // WIN32
+	
+	protected:
+		CaptureRing& ring; //!< ring to drain
+		LogWriter& writer; //!< writer to write frames to
+		#ifdef WIN32
+		HANDLE thread; //!< the background thread
+		#else // WIN32
+		pthread_t thread; //!< the background thread
+		#endif // WIN32
+		volatile bool stopRequested; //!< set to ask the thread to stop once the ring is empty
+	};
+	
+	/*@}*/
+} // namespace Aseba
+
+#endif // ASEBA_CAPTURE_H
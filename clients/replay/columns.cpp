@@ -0,0 +1,150 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "columns.h"
+#include <cstdio>
+#include <algorithm>
+#include <sstream>
+
+namespace Aseba
+{
+	using namespace std;
+	
+	/** \addtogroup columns */
+	/*@{*/
+	
+	static const char columnsMagic[8] = { 'A', 'S', 'E', 'B', 'A', 'C', 'O', 'L' };
+	
+	//! Append value in little endian on bytesCount bytes to buffer
+	static void appendLittleEndian(std::vector<uint8>& buffer, uint64 value, unsigned bytesCount)
+	{
+		for (unsigned i = 0; i < bytesCount; ++i)
+			buffer.push_back(uint8((value >> (8 * i)) & 0xff));
+	}
+	
+	ColumnWriter::ColumnWriter(const std::string& prefix, uint16 source, uint16 event, unsigned variablesCount) :
+		values(variablesCount),
+		error(false)
+	{
+		ostringstream oss;
+		oss << prefix << "." << source << "." << event << ".";
+		this->prefix = oss.str();
+		
+		times.reserve(COLUMNS_CHUNK_ROWS);
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i].reserve(COLUMNS_CHUNK_ROWS);
+		
+		// start the files anew, so that the index matches the columns
+		buffer.insert(buffer.end(), columnsMagic, columnsMagic + sizeof(columnsMagic));
+		appendLittleEndian(buffer, COLUMNS_FORMAT_VERSION, 2);
+		appendLittleEndian(buffer, source, 2);
+		appendLittleEndian(buffer, event, 2);
+		appendLittleEndian(buffer, variablesCount, 2);
+		remove(fileName("index").c_str());
+		append("index", buffer);
+		remove(fileName("time").c_str());
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			ostringstream column;
+			column << i;
+			remove(fileName(column.str()).c_str());
+		}
+	}
+	
+	ColumnWriter::~ColumnWriter()
+	{
+		flush();
+	}
+	
+	void ColumnWriter::add(UnifiedTime::Value time, const uint8* payload, size_t wordsCount)
+	{
+		times.push_back(time);
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i].push_back(i < wordsCount ? sint16(uint16(payload[2*i]) | (uint16(payload[2*i+1]) << 8)) : 0);
+		
+		if (times.size() >= COLUMNS_CHUNK_ROWS)
+			flush();
+	}
+	
+	void ColumnWriter::flushIfOlder(UnifiedTime::Value time)
+	{
+		if (!times.empty() && (time - times.front() >= COLUMNS_CHUNK_DURATION))
+			flush();
+	}
+	
+	void ColumnWriter::flush()
+	{
+		if (times.empty())
+			return;
+		
+		// columns
+		buffer.clear();
+		for (size_t row = 0; row < times.size(); ++row)
+			appendLittleEndian(buffer, times[row], 8);
+		append("time", buffer);
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			buffer.clear();
+			for (size_t row = 0; row < values[i].size(); ++row)
+				appendLittleEndian(buffer, uint16(values[i][row]), 2);
+			ostringstream column;
+			column << i;
+			append(column.str(), buffer);
+		}
+		
+		// index entry, written last so that it only refers to complete chunks
+		buffer.clear();
+		appendLittleEndian(buffer, times.size(), 4);
+		appendLittleEndian(buffer, times.front(), 8);
+		appendLittleEndian(buffer, times.back(), 8);
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			appendLittleEndian(buffer, uint16(*min_element(values[i].begin(), values[i].end())), 2);
+			appendLittleEndian(buffer, uint16(*max_element(values[i].begin(), values[i].end())), 2);
+		}
+		append("index", buffer);
+		
+		times.clear();
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i].clear();
+	}
+	
+	std::string ColumnWriter::fileName(const std::string& column) const
+	{
+		return prefix + column;
+	}
+	
+	void ColumnWriter::append(const std::string& column, const std::vector<uint8>& data)
+	{
+		// files are only open while writing a chunk, so that many events can be logged without running out of file descriptors
+		FILE* file(fopen(fileName(column).c_str(), "ab"));
+		if (!file)
+		{
+			error = true;
+			return;
+		}
+		if (!data.empty() && (fwrite(&data[0], 1, data.size(), file) != data.size()))
+			error = true;
+		if (fclose(file) != 0)
+			error = true;
+	}
+	
+	/*@}*/
+} // namespace Aseba
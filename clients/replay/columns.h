@@ -0,0 +1,95 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEBA_COLUMNS_H
+#define ASEBA_COLUMNS_H
+
+#include "../../common/types.h"
+#include "../../common/utils/utils.h"
+#include <string>
+#include <vector>
+
+namespace Aseba
+{
+	/**
+	\defgroup columns Columnar log of events
+		
+		The values of an event sent by a node are stored in one file per column,
+		named PREFIX.SOURCE.EVENT.COLUMN, so that an analysis can read only the columns it needs.
+		Column "time" holds the time of reception in ms since 1970 (uint64),
+		and columns "0", "1", ... hold the values of the event (sint16).
+		Missing values are 0 and extra values are ignored.
+		
+		Rows are written by chunks. For each chunk, the file PREFIX.SOURCE.EVENT.index
+		gives its number of rows (uint32), its first and last times (uint64 each),
+		and the minimum and maximum of each value column (sint16 each),
+		so that an analysis can skip chunks outside a time range or a value range.
+		This file starts with a header of 16 bytes: the magic "ASEBACOL",
+		the format version (uint16), the source (uint16), the event (uint16)
+		and the number of value columns (uint16).
+		
+		All numbers are little endian.
+	*/
+	/*@{*/
+	
+	//! Version of the columnar log format
+	static const uint16 COLUMNS_FORMAT_VERSION = 1;
+	//! Maximum number of rows of a chunk
+	static const unsigned COLUMNS_CHUNK_ROWS = 4096;
+	//! Maximum duration in ms between the first row of a chunk and the time it is written
+	static const UnifiedTime::Value COLUMNS_CHUNK_DURATION = 10000;
+	
+	//! Write the values of an event from a node into columns, by chunks kept in memory
+	class ColumnWriter
+	{
+	public:
+		//! Create a writer for event from source with variablesCount values, to files starting with prefix
+		ColumnWriter(const std::string& prefix, uint16 source, uint16 event, unsigned variablesCount);
+		//! Write the last chunk
+		~ColumnWriter();
+		
+		//! Append a row received at time, with wordsCount values in little endian in payload
+		void add(UnifiedTime::Value time, const uint8* payload, size_t wordsCount);
+		//! Write the current chunk if it is older than COLUMNS_CHUNK_DURATION at time
+		void flushIfOlder(UnifiedTime::Value time);
+		//! Write the current chunk
+		void flush();
+		
+		//! Return whether an error occurred while writing to the files
+		bool hasError() const { return error; }
+	
+	protected:
+		//! Return the name of the file of column
+		std::string fileName(const std::string& column) const;
+		//! Append data to the file of column
+		void append(const std::string& column, const std::vector<uint8>& data);
+	
+	protected:
+		std::string prefix; //!< beginning of the names of the files, including source and event
+		std::vector<UnifiedTime::Value> times; //!< times of the rows of the current chunk
+		std::vector<std::vector<sint16> > values; //!< for each variable, values of the rows of the current chunk
+		std::vector<uint8> buffer; //!< buffer to encode a column before writing it
+		bool error; //!< whether an error occurred while writing
+	};
+	
+	/*@}*/
+} // namespace Aseba
+
+#endif // ASEBA_COLUMNS_H
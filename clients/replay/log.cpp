@@ -0,0 +1,307 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dashel/dashel.h>
+#include "../../common/consts.h"
+#include "../../common/utils/utils.h"
+#include "../../transport/dashel_plugins/dashel-plugins.h"
+#include "logfile.h"
+#include "columns.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include <csignal>
+
+namespace Aseba
+{
+	using namespace Dashel;
+	using namespace std;
+	
+	/**
+	\defgroup log Columnar event logger
+	*/
+	/*@{*/
+	
+	//! An event to log, from one node or from all nodes
+	struct Selection
+	{
+		bool anySource; //!< whether to log the event from all nodes, each in its own columns
+		uint16 source; //!< node to log the event from, if not anySource
+		uint16 event; //!< event to log
+		unsigned variablesCount; //!< number of values to log, 0 to use the size of the first event received
+		
+		//! Parse SOURCE:EVENT[:COUNT], SOURCE being a node identifier or *, return false on error
+		bool parse(const char* text)
+		{
+			const char* eventText(strchr(text, ':'));
+			if (!eventText || eventText == text)
+				return false;
+			anySource = (strncmp(text, "*:", 2) == 0);
+			source = anySource ? 0 : atoi(text);
+			event = atoi(eventText + 1);
+			const char* countText(strchr(eventText + 1, ':'));
+			variablesCount = countText ? atoi(countText + 1) : 0;
+			return event < 0x8000;
+		}
+	};
+	
+	//! A logger of selected events from many nodes into columnar files.
+	//! Frames are read raw and dispatched to their writer through a map,
+	//! so that a single process can keep up with a whole network.
+	class ColumnLogger : public Hub
+	{
+	protected:
+		//! Source and type of a message
+		typedef std::pair<uint16, uint16> Key;
+		//! Writers of logged messages, 0 for messages that are not selected
+		typedef std::map<Key, ColumnWriter*> Writers;
+		
+		std::string prefix; //!< beginning of the names of the output files
+		std::vector<Selection> selections; //!< events to log
+		Writers writers; //!< writers for each source and type seen so far
+		std::vector<uint8> frame; //!< buffer to receive frames into
+	
+	public:
+		//! Log selections to files starting with prefix
+		ColumnLogger(const std::string& prefix, const std::vector<Selection>& selections) :
+			prefix(prefix),
+			selections(selections)
+		{
+			frame.reserve(ASEBA_MAX_EVENT_ARG_SIZE + 6);
+		}
+		
+		//! Write the remaining rows
+		~ColumnLogger()
+		{
+			bool error(false);
+			for (Writers::iterator it = writers.begin(); it != writers.end(); ++it)
+			{
+				if (it->second)
+				{
+					it->second->flush();
+					error = error || it->second->hasError();
+					delete it->second;
+				}
+			}
+			if (error)
+				cerr << "Error while writing the output files" << endl;
+		}
+		
+		//! Log a message from source of type received at time, with len bytes of payload
+		void log(UnifiedTime::Value time, uint16 source, uint16 type, const uint8* payload, uint16 len)
+		{
+			if (type >= 0x8000)
+				return;
+			
+			const Key key(source, type);
+			Writers::iterator it(writers.find(key));
+			if (it == writers.end())
+				it = writers.insert(Writers::value_type(key, createWriter(source, type, len / 2))).first;
+			if (it->second)
+				it->second->add(time, payload, len / 2);
+		}
+		
+		//! Write the chunks that are waiting for too long, so that little is lost if we are killed
+		void flushOld()
+		{
+			const UnifiedTime::Value now(UnifiedTime().value);
+			for (Writers::iterator it = writers.begin(); it != writers.end(); ++it)
+				if (it->second)
+					it->second->flushIfOlder(now);
+		}
+	
+	protected:
+		//! Return a writer if type from source is selected, 0 otherwise
+		ColumnWriter* createWriter(uint16 source, uint16 type, unsigned wordsCount)
+		{
+			for (size_t i = 0; i < selections.size(); ++i)
+			{
+				const Selection& selection(selections[i]);
+				if ((selection.event == type) && (selection.anySource || (selection.source == source)))
+					return new ColumnWriter(prefix, source, type, selection.variablesCount ? selection.variablesCount : wordsCount);
+			}
+			return 0;
+		}
+		
+		void incomingData(Stream *stream)
+		{
+			// read the raw frame without constructing any message
+			frame.resize(6);
+			stream->read(&frame[0], 6);
+			const uint16 len(uint16(frame[0]) | (uint16(frame[1]) << 8));
+			const uint16 source(uint16(frame[2]) | (uint16(frame[3]) << 8));
+			const uint16 type(uint16(frame[4]) | (uint16(frame[5]) << 8));
+			frame.resize(6 + len);
+			if (len)
+				stream->read(&frame[6], len);
+			
+			log(UnifiedTime().value, source, type, &frame[6], len);
+		}
+		
+		void connectionClosed(Stream *stream, bool abnormal)
+		{
+			dumpTime(cerr);
+			cerr << "Connection closed to " << stream->getTargetName();
+			if (abnormal)
+				cerr << " : " << stream->getFailReason();
+			cerr << endl;
+		}
+	};
+	
+	/*@}*/
+}
+
+//! Set when the user requests the logger to stop
+static volatile sig_atomic_t interrupted = 0;
+
+//! Request the logger to stop, so that the last chunks are written
+static void interruptHandler(int)
+{
+	interrupted = 1;
+}
+
+//! Show usage
+void dumpHelp(std::ostream &stream, const char *programName)
+{
+	stream << "Aseba log, log selected events of many nodes into columnar files, usage:\n";
+	stream << programName << " [options] [targets]*\n";
+	stream << "Options:\n";
+	stream << "-e SOURCE:EVENT[:COUNT] : log event EVENT from node SOURCE, or from all nodes if SOURCE is *,\n";
+	stream << "                  keeping COUNT values (default: as many as in the first event); can be repeated\n";
+	stream << "-o PREFIX       : write to files starting with PREFIX (default: aseba)\n";
+	stream << "-i LOG_FILE     : read the messages from a binary log instead of from targets\n";
+	stream << "-h, --help      : shows this help\n";
+	stream << "-V, --version   : shows the version number\n";
+	stream << "Each event of each node is written to PREFIX.SOURCE.EVENT.time, PREFIX.SOURCE.EVENT.0, ...,\n";
+	stream << "with an index of the chunks of rows in PREFIX.SOURCE.EVENT.index.\n";
+	stream << "Targets are any valid Dashel targets." << std::endl;
+	stream << "Report bugs to: aseba-dev@gna.org" << std::endl;
+}
+
+//! Show version
+void dumpVersion(std::ostream &stream)
+{
+	stream << "Aseba log " << ASEBA_VERSION << std::endl;
+	stream << "Aseba protocol " << ASEBA_PROTOCOL_VERSION << std::endl;
+	stream << "Licence LGPLv3: GNU LGPL version 3 <http://www.gnu.org/licenses/lgpl.html>\n";
+}
+
+int main(int argc, char *argv[])
+{
+	Dashel::initPlugins();
+	std::vector<std::string> targets;
+	std::vector<Aseba::Selection> selections;
+	std::string prefix("aseba");
+	const char* inputFile = 0;
+	
+	int argCounter = 1;
+	
+	while (argCounter < argc)
+	{
+		const char *arg = argv[argCounter];
+		
+		if ((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0))
+		{
+			dumpHelp(std::cout, argv[0]);
+			return 0;
+		}
+		else if ((strcmp(arg, "-V") == 0) || (strcmp(arg, "--version") == 0))
+		{
+			dumpVersion(std::cout);
+			return 0;
+		}
+		else if ((strcmp(arg, "-e") == 0) || (strcmp(arg, "-o") == 0) || (strcmp(arg, "-i") == 0))
+		{
+			argCounter++;
+			if (argCounter >= argc)
+			{
+				dumpHelp(std::cout, argv[0]);
+				return 1;
+			}
+			if (strcmp(arg, "-e") == 0)
+			{
+				Aseba::Selection selection;
+				if (!selection.parse(argv[argCounter]))
+				{
+					std::cerr << "Invalid event selection " << argv[argCounter] << std::endl;
+					return 1;
+				}
+				selections.push_back(selection);
+			}
+			else if (strcmp(arg, "-o") == 0)
+				prefix = argv[argCounter];
+			else
+				inputFile = argv[argCounter];
+		}
+		else
+		{
+			targets.push_back(argv[argCounter]);
+		}
+		argCounter++;
+	}
+	
+	if (selections.empty())
+	{
+		std::cerr << "No event selected" << std::endl;
+		dumpHelp(std::cerr, argv[0]);
+		return 1;
+	}
+	
+	// offline conversion of a binary log
+	if (inputFile)
+	{
+		Aseba::LogReader reader(inputFile);
+		if (!reader.isValid())
+		{
+			std::cerr << "Cannot read binary log " << inputFile << std::endl;
+			return 1;
+		}
+		Aseba::ColumnLogger logger(prefix, selections);
+		Aseba::LogFrame frame;
+		while (reader.next(frame))
+			logger.log(frame.time, frame.source, frame.type, frame.payload, frame.len);
+		return 0;
+	}
+	
+	if (targets.empty())
+		targets.push_back(ASEBA_DEFAULT_TARGET);
+	
+	signal(SIGINT, interruptHandler);
+	signal(SIGTERM, interruptHandler);
+	
+	try
+	{
+		Aseba::ColumnLogger logger(prefix, selections);
+		for (size_t i = 0; i < targets.size(); i++)
+			logger.connect(targets[i]);
+		
+		// run until interrupted
+		while (!interrupted && logger.step(100))
+			logger.flushOld();
+	}
+	catch(Dashel::DashelException e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
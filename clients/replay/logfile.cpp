@@ -0,0 +1,465 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "logfile.h"
+#include "../../common/consts.h"
+#include <cstring>
+#include <algorithm>
+#ifndef WIN32
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif // WIN32
+
+namespace Aseba
+{
+	using namespace std;
+	
+	/** \addtogroup logfile */
+	/*@{*/
+	
+	static const char logMagic[8] = { 'A', 'S', 'E', 'B', 'A', 'L', 'O', 'G' };
+	static const char indexMagic[8] = { 'A', 'S', 'E', 'B', 'A', 'I', 'D', 'X' };
+	//! Size of the buffer of the writer, above which it is written to the file
+	static const size_t writerBufferSize = 65536;
+	
+	//! Append value in little endian on bytesCount bytes to buffer
+	static void appendLittleEndian(std::vector<uint8>& buffer, uint64 value, unsigned bytesCount)
+	{
+		for (unsigned i = 0; i < bytesCount; ++i)
+			buffer.push_back(uint8((value >> (8 * i)) & 0xff));
+	}
+	
+	//! Return the index cache file name of a log
+	static std::string indexCacheFileName(const std::string& fileName)
+	{
+		return fileName + ".idx";
+	}
+	
+	//! Compare the time of index entries, for binary search
+	static bool indexEntryTimeLess(const UnifiedTime::Value time, const LogIndexEntry& entry)
+	{
+		return time < entry.time;
+	}
+	
+	LogWriter::LogWriter(FILE* file, uint32 flags, const UnifiedTime& startTime) :
+		file(file),
+		fileOffset(0),
+		lastTime(startTime.value),
+		lastIndexTime(0),
+		framesSinceIndex(LOG_INDEX_FRAMES_INTERVAL),
+		closed(false),
+		error(false)
+	{
+		buffer.reserve(writerBufferSize + ASEBA_MAX_EVENT_ARG_SIZE + 16);
+		buffer.insert(buffer.end(), logMagic, logMagic + sizeof(logMagic));
+		add(LOG_FORMAT_VERSION, 2);
+		add(ASEBA_PROTOCOL_VERSION, 2);
+		add(flags, 4);
+		add(startTime.value, 8);
+	}
+	
+	LogWriter::~LogWriter()
+	{
+		close();
+	}
+	
+	void LogWriter::write(const UnifiedTime& time, const uint8* frame, size_t size)
+	{
+		// time might go backward if the clock is adjusted, in which case we consider the frame simultaneous with the previous one
+		const UnifiedTime::Value frameTime(std::max(time.value, lastTime));
+		
+		// add an entry to the seek index if enough frames or time passed since the last one
+		if ((framesSinceIndex >= LOG_INDEX_FRAMES_INTERVAL) || (frameTime - lastIndexTime >= LOG_INDEX_TIME_INTERVAL))
+		{
+			const LogIndexEntry entry = { frameTime, fileOffset + buffer.size() };
+			index.push_back(entry);
+			lastIndexTime = frameTime;
+			framesSinceIndex = 0;
+		}
+		
+		// delta time as unsigned LEB128
+		UnifiedTime::Value delta(frameTime - lastTime);
+		do
+		{
+			uint8 byte(delta & 0x7f);
+			delta >>= 7;
+			if (delta)
+				byte |= 0x80;
+			buffer.push_back(byte);
+		}
+		while (delta);
+		
+		// raw message
+		buffer.insert(buffer.end(), frame, frame + size);
+		
+		lastTime = frameTime;
+		++framesSinceIndex;
+		
+		if (buffer.size() >= writerBufferSize)
+			flush();
+	}
+	
+	void LogWriter::flush()
+	{
+		if (!buffer.empty())
+		{
+			if (fwrite(&buffer[0], 1, buffer.size(), file) != buffer.size())
+				error = true;
+			fileOffset += buffer.size();
+			buffer.clear();
+		}
+		if (fflush(file) != 0)
+			error = true;
+	}
+	
+	void LogWriter::close()
+	{
+		if (closed)
+			return;
+		
+		const uint64 indexOffset(fileOffset + buffer.size());
+		for (LogIndex::const_iterator it = index.begin(); it != index.end(); ++it)
+		{
+			add(it->time, 8);
+			add(it->offset, 8);
+		}
+		add(indexOffset, 8);
+		add(index.size(), 8);
+		buffer.insert(buffer.end(), indexMagic, indexMagic + sizeof(indexMagic));
+		flush();
+		
+		closed = true;
+	}
+	
+	void LogWriter::add(uint64 value, unsigned bytesCount)
+	{
+		appendLittleEndian(buffer, value, bytesCount);
+	}
+	
+	//
+	
+	LogReader::LogReader(const std::string& fileName) :
+		data(0),
+		size(0),
+		framesEnd(0),
+		mapped(false),
+		startTime(0),
+		flags(0),
+		pos(LOG_HEADER_SIZE),
+		time(0)
+	{
+		#ifndef WIN32
+		const int fd(open(fileName.c_str(), O_RDONLY));
+		if (fd < 0)
+			return;
+		struct stat st;
+		if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+		{
+			void* address(mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+			if (address != MAP_FAILED)
+			{
+				data = reinterpret_cast<const uint8*>(address);
+				size = st.st_size;
+				mapped = true;
+				madvise(address, st.st_size, MADV_SEQUENTIAL);
+			}
+		}
+		::close(fd);
+		#else // WIN32
+		FILE* file(fopen(fileName.c_str(), "rb"));
+		if (!file)
+			return;
+		fseek(file, 0, SEEK_END);
+		const long fileSize(ftell(file));
+		fseek(file, 0, SEEK_SET);
+		if (fileSize > 0)
+		{
+			uint8* content(new uint8[fileSize]);
+			if (fread(content, 1, fileSize, file) == size_t(fileSize))
+			{
+				data = content;
+				size = fileSize;
+			}
+			else
+				delete[] content;
+		}
+		fclose(file);
+		#endif // WIN32
+		
+		if (data && !readHeaderAndIndex(fileName))
+			unmap();
+	}
+	
+	LogReader::~LogReader()
+	{
+		unmap();
+	}
+	
+	void LogReader::unmap()
+	{
+		if (!data)
+			return;
+		#ifndef WIN32
+		if (mapped)
+			munmap(const_cast<uint8*>(data), size);
+		#else // WIN32
+		delete[] data;
+		#endif // WIN32
+		data = 0;
+	}
+	
+	bool LogReader::isLogFile(const std::string& fileName)
+	{
+		FILE* file(fopen(fileName.c_str(), "rb"));
+		if (!file)
+			return false;
+		char magic[sizeof(logMagic)];
+		const bool result((fread(magic, 1, sizeof(magic), file) == sizeof(magic)) && (memcmp(magic, logMagic, sizeof(magic)) == 0));
+		fclose(file);
+		return result;
+	}
+	
+	bool LogReader::next(LogFrame& frame)
+	{
+		return readFrame(pos, time, frame);
+	}
+	
+	void LogReader::rewind()
+	{
+		pos = LOG_HEADER_SIZE;
+		time = startTime;
+	}
+	
+	void LogReader::seek(UnifiedTime::Value time)
+	{
+		// find the last entry not later than time
+		const LogIndex::const_iterator it(upper_bound(index.begin(), index.end(), time, indexEntryTimeLess));
+		if (it == index.begin())
+		{
+			rewind();
+			return;
+		}
+		const LogIndexEntry& entry(*(it-1));
+		
+		// the time of the frame at the entry is relative to the previous frame, so compute the time before it
+		uint64 framePos(entry.offset);
+		UnifiedTime::Value delta(0);
+		LogFrame frame;
+		if (!readFrame(framePos, delta, frame))
+		{
+			rewind();
+			return;
+		}
+		pos = entry.offset;
+		this->time = entry.time - delta;
+	}
+	
+	bool LogReader::readHeaderAndIndex(const std::string& fileName)
+	{
+		// header
+		if (size < LOG_HEADER_SIZE)
+			return false;
+		if (memcmp(data, logMagic, sizeof(logMagic)) != 0)
+			return false;
+		if (get(8, 2) != LOG_FORMAT_VERSION)
+			return false;
+		flags = uint32(get(12, 4));
+		startTime = get(16, 8);
+		rewind();
+		
+		// footer and index, if the recording was properly closed
+		if ((size >= LOG_HEADER_SIZE + LOG_FOOTER_SIZE) && (memcmp(data + size - sizeof(indexMagic), indexMagic, sizeof(indexMagic)) == 0))
+		{
+			const uint64 indexOffset(get(size - LOG_FOOTER_SIZE, 8));
+			const uint64 indexCount(get(size - LOG_FOOTER_SIZE + 8, 8));
+			if ((indexOffset >= LOG_HEADER_SIZE) &&
+				(indexOffset <= size - LOG_FOOTER_SIZE) &&
+				(indexCount == (size - LOG_FOOTER_SIZE - indexOffset) / 16) &&
+				(indexOffset + indexCount * 16 == size - LOG_FOOTER_SIZE)
+			)
+			{
+				framesEnd = indexOffset;
+				index.resize(indexCount);
+				for (size_t i = 0; i < index.size(); ++i)
+				{
+					index[i].time = get(indexOffset + i * 16, 8);
+					index[i].offset = get(indexOffset + i * 16 + 8, 8);
+				}
+				return true;
+			}
+		}
+		
+		// no valid index, use the cached one or rebuild it and cache it
+		if (!loadIndexCache(fileName))
+		{
+			rebuildIndex();
+			saveIndexCache(fileName);
+		}
+		return true;
+	}
+	
+	void LogReader::rebuildIndex()
+	{
+		// read all frames, and ignore any partially written frame
+		index.clear();
+		framesEnd = size;
+		uint64 framePos(LOG_HEADER_SIZE);
+		UnifiedTime::Value frameTime(startTime);
+		UnifiedTime::Value lastIndexTime(0);
+		unsigned framesSinceIndex(LOG_INDEX_FRAMES_INTERVAL);
+		LogFrame frame;
+		while (true)
+		{
+			const uint64 thisFramePos(framePos);
+			if (!readFrame(framePos, frameTime, frame))
+				break;
+			if ((framesSinceIndex >= LOG_INDEX_FRAMES_INTERVAL) || (frameTime - lastIndexTime >= LOG_INDEX_TIME_INTERVAL))
+			{
+				const LogIndexEntry entry = { frameTime, thisFramePos };
+				index.push_back(entry);
+				lastIndexTime = frameTime;
+				framesSinceIndex = 0;
+			}
+			++framesSinceIndex;
+		}
+		framesEnd = framePos;
+	}
+	
+	bool LogReader::loadIndexCache(const std::string& fileName)
+	{
+		FILE* file(fopen(indexCacheFileName(fileName).c_str(), "rb"));
+		if (!file)
+			return false;
+		
+		// header, the cache is only valid for a log of the same size
+		uint8 header[32];
+		bool ok(fread(header, 1, sizeof(header), file) == sizeof(header));
+		ok = ok && (memcmp(header, indexMagic, sizeof(indexMagic)) == 0);
+		uint64 values[3] = { 0, 0, 0 };
+		for (unsigned i = 0; i < 3; ++i)
+			for (unsigned j = 0; j < 8; ++j)
+				values[i] |= uint64(header[8 + i * 8 + j]) << (8 * j);
+		ok = ok && (values[0] == size) && (values[1] >= LOG_HEADER_SIZE) && (values[1] <= size);
+		
+		// the number of entries must match the size of the cache, which might be truncated or corrupted
+		if (ok)
+		{
+			ok = (fseek(file, 0, SEEK_END) == 0);
+			const long fileSize(ftell(file));
+			ok = ok && (fileSize >= long(sizeof(header))) && (values[2] == uint64(fileSize - sizeof(header)) / 16);
+			ok = ok && (fseek(file, sizeof(header), SEEK_SET) == 0);
+		}
+		
+		// entries
+		if (ok)
+		{
+			std::vector<uint8> entries(values[2] * 16);
+			ok = entries.empty() || (fread(&entries[0], 1, entries.size(), file) == entries.size());
+			if (ok)
+			{
+				framesEnd = values[1];
+				index.resize(values[2]);
+				for (size_t i = 0; i < index.size(); ++i)
+				{
+					index[i].time = 0;
+					index[i].offset = 0;
+					for (unsigned j = 0; j < 8; ++j)
+					{
+						index[i].time |= UnifiedTime::Value(entries[i * 16 + j]) << (8 * j);
+						index[i].offset |= uint64(entries[i * 16 + 8 + j]) << (8 * j);
+					}
+					ok = ok && (index[i].offset < framesEnd);
+				}
+			}
+		}
+		fclose(file);
+		
+		if (!ok)
+			index.clear();
+		return ok;
+	}
+	
+	void LogReader::saveIndexCache(const std::string& fileName) const
+	{
+		std::vector<uint8> buffer(indexMagic, indexMagic + sizeof(indexMagic));
+		appendLittleEndian(buffer, size, 8);
+		appendLittleEndian(buffer, framesEnd, 8);
+		appendLittleEndian(buffer, index.size(), 8);
+		for (LogIndex::const_iterator it = index.begin(); it != index.end(); ++it)
+		{
+			appendLittleEndian(buffer, it->time, 8);
+			appendLittleEndian(buffer, it->offset, 8);
+		}
+		
+		// the cache is an optimisation, so failing to write it, for instance in a read-only directory, is not an error
+		FILE* file(fopen(indexCacheFileName(fileName).c_str(), "wb"));
+		if (!file)
+			return;
+		fwrite(&buffer[0], 1, buffer.size(), file);
+		fclose(file);
+	}
+	
+	bool LogReader::readFrame(uint64& pos, UnifiedTime::Value& time, LogFrame& frame) const
+	{
+		// delta time as unsigned LEB128
+		uint64 p(pos);
+		UnifiedTime::Value delta(0);
+		unsigned shift(0);
+		while (true)
+		{
+			if ((p >= framesEnd) || (shift >= 64))
+				return false;
+			const uint8 byte(data[p++]);
+			delta |= UnifiedTime::Value(byte & 0x7f) << shift;
+			shift += 7;
+			if (!(byte & 0x80))
+				break;
+		}
+		
+		// raw message
+		if (p + 6 > framesEnd)
+			return false;
+		frame.len = uint16(get(p, 2));
+		if (p + 6 + frame.len > framesEnd)
+			return false;
+		frame.source = uint16(get(p + 2, 2));
+		frame.type = uint16(get(p + 4, 2));
+		frame.raw = data + p;
+		frame.payload = data + p + 6;
+		
+		time += delta;
+		frame.time = time;
+		pos = p + 6 + frame.len;
+		return true;
+	}
+	
+	uint64 LogReader::get(uint64 pos, unsigned bytesCount) const
+	{
+		uint64 value(0);
+		for (unsigned i = 0; i < bytesCount; ++i)
+			value |= uint64(data[pos + i]) << (8 * i);
+		return value;
+	}
+	
+	/*@}*/
+} // namespace Aseba
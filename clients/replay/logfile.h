@@ -0,0 +1,190 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEBA_LOGFILE_H
+#define ASEBA_LOGFILE_H
+
+#include "../../common/types.h"
+#include "../../common/utils/utils.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Aseba
+{
+	/**
+	\defgroup logfile Binary log of messages
+		
+		A log file starts with a header of 24 bytes:
+		the magic "ASEBALOG", the format version (uint16), the protocol version (uint16),
+		flags (uint32) and the time of the start of the recording in ms since 1970 (uint64).
+		
+		It is followed by frames, each being the time since the previous frame
+		(or since the start for the first frame) in ms as an unsigned LEB128 number,
+		followed by the Aseba message exactly as sent on the network (len, source, type, payload).
+		
+		When the recording is properly closed, the frames are followed by a seek index,
+		a list of (time, offset) pairs (uint64 each) pointing to frames,
+		and by a footer of 24 bytes: the offset of the index (uint64), the number
+		of entries in the index (uint64) and the magic "ASEBAIDX".
+		If the footer is missing, for instance because the recorder was killed,
+		the reader reads all valid frames and rebuilds the index.
+		It then caches it in a file of the same name with the ".idx" suffix,
+		made of the magic "ASEBAIDX", the size of the log (uint64), the offset of
+		the end of its valid frames (uint64), the number of entries (uint64) and the entries.
+		
+		All numbers are little endian.
+	*/
+	/*@{*/
+	
+	//! Version of the log file format
+	static const uint16 LOG_FORMAT_VERSION = 1;
+	//! Size of the header of log files
+	static const size_t LOG_HEADER_SIZE = 24;
+	//! Size of the footer of log files
+	static const size_t LOG_FOOTER_SIZE = 24;
+	//! Maximum number of frames between two entries of the seek index
+	static const unsigned LOG_INDEX_FRAMES_INTERVAL = 1024;
+	//! Maximum duration in ms between two entries of the seek index
+	static const UnifiedTime::Value LOG_INDEX_TIME_INTERVAL = 1000;
+	//! Flag of the header telling that all messages were recorded, not only user messages
+	static const uint32 LOG_FLAG_ALL_MESSAGES = 1;
+	
+	//! An entry of the seek index of a log file
+	struct LogIndexEntry
+	{
+		UnifiedTime::Value time; //!< absolute time of the frame, in ms since 1970
+		uint64 offset; //!< offset of the frame in the file
+	};
+	
+	//! A vector of index entries
+	typedef std::vector<LogIndexEntry> LogIndex;
+	
+	//! Write messages into a binary log file, through a memory buffer
+	class LogWriter
+	{
+	public:
+		//! Create a writer on file, which it does not close, and write the header with flags, the time of the first message is relative to startTime
+		LogWriter(FILE* file, uint32 flags = 0, const UnifiedTime& startTime = UnifiedTime());
+		//! Close the log if it was not done already
+		~LogWriter();
+		
+		//! Append a frame, the message as sent on the network, received at time
+		void write(const UnifiedTime& time, const uint8* frame, size_t size);
+		//! Write the buffer to the file
+		void flush();
+		//! Write the seek index and the footer, after which no more frames can be written
+		void close();
+		
+		//! Return whether an error occurred while writing to the file
+		bool hasError() const { return error; }
+	
+	protected:
+		//! Append value in little endian on bytesCount bytes to the buffer
+		void add(uint64 value, unsigned bytesCount);
+	
+	protected:
+		FILE* file; //!< file to write to
+		std::vector<uint8> buffer; //!< data not yet written to the file
+		uint64 fileOffset; //!< offset in the file of the beginning of the buffer
+		UnifiedTime::Value lastTime; //!< time of the last frame written
+		UnifiedTime::Value lastIndexTime; //!< time of the last entry of the seek index
+		unsigned framesSinceIndex; //!< number of frames since the last entry of the seek index
+		LogIndex index; //!< the seek index
+		bool closed; //!< whether the footer has been written
+		bool error; //!< whether an error occurred while writing
+	};
+	
+	//! A frame read from a log file, pointing to the mapped data
+	struct LogFrame
+	{
+		UnifiedTime::Value time; //!< absolute time of the frame, in ms since 1970
+		uint16 source; //!< source of the message
+		uint16 type; //!< type of the message
+		uint16 len; //!< length of the payload in bytes
+		const uint8* raw; //!< the message as sent on the network, of len + 6 bytes
+		const uint8* payload; //!< the payload of the message
+		
+		//! Return the size of the message as sent on the network
+		size_t rawSize() const { return size_t(len) + 6; }
+		//! Return the i-th word of the payload
+		sint16 word(size_t i) const { return sint16(uint16(payload[2*i]) | (uint16(payload[2*i+1]) << 8)); }
+	};
+	
+	//! Read a binary log file, mapping it in memory when the system allows it
+	class LogReader
+	{
+	public:
+		//! Open fileName, use isValid() to check whether this succeeded
+		LogReader(const std::string& fileName);
+		//! Unmap the file
+		~LogReader();
+		
+		//! Return whether fileName starts with the header of a binary log
+		static bool isLogFile(const std::string& fileName);
+		
+		//! Return whether the file is a valid binary log
+		bool isValid() const { return data != 0; }
+		//! Return the time of the start of the recording
+		UnifiedTime::Value getStartTime() const { return startTime; }
+		//! Return the flags of the header
+		uint32 getFlags() const { return flags; }
+		//! Return the seek index, read from the file or rebuilt
+		const LogIndex& getIndex() const { return index; }
+		
+		//! Read the next frame into frame, return false at the end of the log
+		bool next(LogFrame& frame);
+		//! Go back to the first frame
+		void rewind();
+		//! Go to the last indexed frame not later than time, the next frames might still be earlier than time
+		void seek(UnifiedTime::Value time);
+	
+	protected:
+		//! Release the content of the file
+		void unmap();
+		//! Read the header and the index, return false if the file is invalid
+		bool readHeaderAndIndex(const std::string& fileName);
+		//! Rebuild the index by reading all frames
+		void rebuildIndex();
+		//! Load the index from the cache of fileName, return false if it does not exist or does not match the log
+		bool loadIndexCache(const std::string& fileName);
+		//! Save the index to the cache of fileName
+		void saveIndexCache(const std::string& fileName) const;
+		//! Read a frame at pos and the time before it, return false if there is no valid frame there
+		bool readFrame(uint64& pos, UnifiedTime::Value& time, LogFrame& frame) const;
+		//! Return the value in little endian on bytesCount bytes at pos
+		uint64 get(uint64 pos, unsigned bytesCount) const;
+	
+	protected:
+		const uint8* data; //!< content of the file
+		uint64 size; //!< size of the file
+		uint64 framesEnd; //!< offset of the end of frames
+		bool mapped; //!< whether data is mapped or allocated
+		UnifiedTime::Value startTime; //!< time of the start of the recording
+		uint32 flags; //!< flags of the header
+		LogIndex index; //!< the seek index
+		uint64 pos; //!< position of the next frame
+		UnifiedTime::Value time; //!< time of the last frame read
+	};
+	
+	/*@}*/
+} // namespace Aseba
+
+#endif // ASEBA_LOGFILE_H
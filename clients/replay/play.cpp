@@ -23,11 +23,15 @@
 #include "../../common/msg/msg.h"
 #include "../../common/utils/utils.h"
 #include "../../transport/dashel_plugins/dashel-plugins.h"
+#include "logfile.h"
 #include <time.h>
 #include <iostream>
 #include <cstring>
 #include <string>
 #include <deque>
+#include <set>
+#include <limits>
+#include <cstdlib>
 
 namespace Aseba
 {
@@ -39,8 +43,115 @@ namespace Aseba
 	*/
 	/*@{*/
 	
+	//! Selection of the messages to replay
+	struct Filter
+	{
+		UnifiedTime::Value from; //!< time of the first message to replay
+		UnifiedTime::Value to; //!< time of the last message to replay
+		bool fromRelative; //!< whether from is relative to the start of the recording
+		bool toRelative; //!< whether to is relative to the start of the recording
+		set<uint16> sources; //!< sources of messages to replay, all if empty
+		set<uint16> events; //!< types of messages to replay, all if empty
+		bool allMessages; //!< whether to accept all messages, not only user messages
+		
+		Filter() :
+			from(0),
+			to(numeric_limits<UnifiedTime::Value>::max()),
+			fromRelative(false),
+			toRelative(false),
+			allMessages(false)
+		{}
+		
+		//! Make relative times absolute, given the time of the start of the recording
+		void setStartTime(UnifiedTime::Value startTime)
+		{
+			if (fromRelative)
+				from += startTime;
+			if (toRelative)
+				to += startTime;
+			fromRelative = toRelative = false;
+		}
+		
+		//! Return whether a message of this source and type must be replayed
+		bool accepts(uint16 source, uint16 type) const
+		{
+			return (allMessages || type < 0x8000) &&
+				(sources.empty() || sources.find(source) != sources.end()) &&
+				(events.empty() || events.find(type) != events.end());
+		}
+	};
+	
+	//! Parse a time in seconds, as an absolute time since 1970 or as "+seconds" relative to the start of the recording, return false if invalid
+	bool parseTime(const char* s, UnifiedTime::Value& time, bool& relative)
+	{
+		relative = (s[0] == '+');
+		if (relative)
+			++s;
+		char* end;
+		const double seconds(strtod(s, &end));
+		if ((end == s) || (*end != 0) || (seconds < 0))
+			return false;
+		time = UnifiedTime::Value(seconds * 1000. + 0.5);
+		return true;
+	}
+	
+	//! Jump to the first frame that filter might accept, using the seek index of the log
+	void seekToStart(LogReader& reader, Filter& filter)
+	{
+		filter.setStartTime(reader.getStartTime());
+		reader.seek(filter.from);
+	}
+	
+	//! Read into frame the next message accepted by filter, looking only at the header of frames, return false at the end of the log or after the end of the selected time range
+	bool nextFrame(LogReader& reader, const Filter& filter, LogFrame& frame)
+	{
+		while (reader.next(frame))
+		{
+			if (frame.time > filter.to)
+				return false;
+			if ((frame.time >= filter.from) && filter.accepts(frame.source, frame.type))
+				return true;
+		}
+		return false;
+	}
+	
+	//! Write the user messages of a binary log as text, in the format of asebarec --text
+	void exportText(LogReader& reader, Filter& filter, ostream& os)
+	{
+		seekToStart(reader, filter);
+		LogFrame frame;
+		while (nextFrame(reader, filter, frame))
+		{
+			os << UnifiedTime(frame.time).toRawTimeString() << " ";
+			os << frame.source << " ";
+			os << frame.type << " ";
+			os << frame.len / 2 << " ";
+			for (size_t i = 0; i < size_t(frame.len / 2); ++i)
+				os << frame.word(i) << " ";
+			os << "\n";
+		}
+		os.flush();
+	}
+	
+	//! Write the messages of a binary log in a human-readable form, including messages other than user messages if they were recorded
+	void dumpMessages(LogReader& reader, Filter& filter, wostream& os)
+	{
+		filter.allMessages = true;
+		seekToStart(reader, filter);
+		MessagePool messagePool;
+		LogFrame frame;
+		while (nextFrame(reader, filter, frame))
+		{
+			Message* message(messagePool.deserialize(frame.source, frame.type, frame.payload, frame.len));
+			os << UnifiedTime(frame.time).toHumanReadableStringFromEpoch().c_str() << " ";
+			message->dump(os);
+			os << "\n";
+		}
+		os.flush();
+	}
+	
 	//! A message player
-	//! This class replay saved user messages
+	//! This class replay saved user messages, from a binary log or from text
 	class Player : public Hub
 	{
 	private:
@@ -48,23 +159,95 @@ namespace Aseba
 		
 		bool respectTimings;
 		int speedFactor;
+		Filter filter;
 		Stream* in;
+		LogReader* reader;
 		string line;
 		UnifiedTime lastTimeStamp;
 		UnifiedTime lastEventTime;
 	
 	public:
-		Player(const char* inputFile, bool respectTimings, int speedFactor) :
+		Player(const char* inputFile, bool respectTimings, int speedFactor, const Filter& filter) :
 			respectTimings(respectTimings),
 			speedFactor(speedFactor),
+			filter(filter),
+			in(0),
+			reader(0),
 			lastTimeStamp(0)
 		{
-			if (inputFile)
+			if (inputFile && LogReader::isLogFile(inputFile))
+			{
+				reader = new LogReader(inputFile);
+				if (!reader->isValid())
+					throw DashelException(DashelException::ConnectionFailed, 0, "Invalid binary log file");
+			}
+			else if (inputFile)
 				in = connect("file:" + string(inputFile) + ";mode=read");
 			else
 				in = connect("stdin:");
 		}
 		
+		~Player()
+		{
+			delete reader;
+		}
+		
+		//! Replay all messages, then return
+		void play()
+		{
+			if (reader)
+				playLog();
+			else
+				run();
+		}
+		
+		//! Replay the frames of the binary log, written directly to the targets without deserializing them
+		void playLog()
+		{
+			seekToStart(*reader, filter);
+			LogFrame frame;
+			unsigned framesSinceStep(0);
+			while (nextFrame(*reader, filter, frame))
+			{
+				const UnifiedTime timeStamp(frame.time);
+				waitUntil(timeStamp);
+				
+				for (StreamsSet::iterator it = dataStreams.begin(); it != dataStreams.end();++it)
+				{
+					Stream* destStream(*it);
+					destStream->write(frame.raw, frame.rawSize());
+					destStream->flush();
+				}
+				
+				lastEventTime = UnifiedTime();
+				lastTimeStamp = timeStamp;
+				
+				// let Dashel process incoming data and closed connections from time to time
+				if (++framesSinceStep >= 256)
+				{
+					if (!step(0))
+						break;
+					framesSinceStep = 0;
+				}
+			}
+		}
+		
+		//! If timings must be respected, sleep until it is time to send a message recorded at timeStamp
+		void waitUntil(const UnifiedTime& timeStamp)
+		{
+			if ((respectTimings) && (lastTimeStamp.value != 0))
+			{
+				const UnifiedTime lostTime(UnifiedTime() - lastEventTime);
+				const UnifiedTime deltaTimeStamp(timeStamp - lastTimeStamp);
+				if (lostTime < deltaTimeStamp)
+				{
+					UnifiedTime waitTime(deltaTimeStamp - lostTime);
+					waitTime /= speedFactor;
+					waitTime.sleep();
+				}
+			}
+		}
+		
 		StringList tokenize(const string& input)
 		{
 			StringList list;
@@ -103,6 +286,20 @@ namespace Aseba
 			userMessage.type = atoi(tokenizedLine.front().c_str());
 			tokenizedLine.pop_front();
 			
+			// text has no index, so filter messages as they come, relative times starting at the first line
+			if (lastTimeStamp.value == 0)
+				filter.setStartTime(timeStamp.value);
+			if (timeStamp.value > filter.to)
+			{
+				stop();
+				return;
+			}
+			if ((timeStamp.value < filter.from) || !filter.accepts(userMessage.source, userMessage.type))
+			{
+				line.clear();
+				return;
+			}
+			
 			userMessage.data.reserve(size_t(atoi(tokenizedLine.front().c_str())));
 			tokenizedLine.pop_front();
 			
@@ -113,17 +310,7 @@ namespace Aseba
 			}
 			
 			// if required, sleep
-			if ((respectTimings) && (lastTimeStamp.value != 0))
-			{
-				const UnifiedTime lostTime(UnifiedTime() - lastEventTime);
-				const UnifiedTime deltaTimeStamp(timeStamp - lastTimeStamp);
-				if (lostTime < deltaTimeStamp)
-				{
-					UnifiedTime waitTime(deltaTimeStamp - lostTime);
-					waitTime /= speedFactor;
-					waitTime.sleep();
-				}
-			}
+			waitUntil(timeStamp);
 			
 			// write message on all connected streams
 			for (StreamsSet::iterator it = dataStreams.begin(); it != dataStreams.end();++it)
@@ -181,7 +368,13 @@ void dumpHelp(std::ostream &stream, const char *programName)
 	stream << "--fast          : replay messages twice the speed of real time\n";
 	stream << "--faster        : replay messages four times the speed of real time\n";
 	stream << "--fastest       : replay messages as fast as possible\n";
-	stream << "-f INPUT_FILE   : open INPUT_FILE instead of stdin\n";
+	stream << "-f INPUT_FILE   : open INPUT_FILE instead of stdin, either a binary log or text\n";
+	stream << "--export-text   : write the binary log INPUT_FILE as text to stdout instead of replaying it\n";
+	stream << "--dump          : write all messages of the binary log INPUT_FILE in a human-readable form to stdout\n";
+	stream << "--from TIME     : start at TIME, in seconds since 1970 or, if prefixed by +, since the start of the recording\n";
+	stream << "--to TIME       : stop after TIME, in the same format as --from\n";
+	stream << "--source ID     : only replay messages from node ID, can be repeated\n";
+	stream << "--event TYPE    : only replay events of TYPE, can be repeated\n";
 	stream << "-h, --help      : shows this help\n";
 	stream << "-V, --version   : shows the version number\n";
 	stream << "Targets are any valid Dashel targets." << std::endl;
@@ -203,6 +396,9 @@ int main(int argc, char *argv[])
 	int speedFactor = 1;
 	std::vector<std::string> targets;
 	const char* inputFile = 0;
+	bool exportText = false;
+	bool dumpMessages = false;
+	Aseba::Filter filter;
 	
 	int argCounter = 1;
 	
@@ -222,6 +418,41 @@ int main(int argc, char *argv[])
 		{
 			speedFactor = 4;
 		}
+		else if (strcmp(arg, "--export-text") == 0)
+		{
+			exportText = true;
+		}
+		else if (strcmp(arg, "--dump") == 0)
+		{
+			dumpMessages = true;
+		}
+		else if ((strcmp(arg, "--from") == 0) || (strcmp(arg, "--to") == 0))
+		{
+			const bool isFrom(strcmp(arg, "--from") == 0);
+			argCounter++;
+			if ((argCounter >= argc) ||
+				(isFrom && !Aseba::parseTime(argv[argCounter], filter.from, filter.fromRelative)) ||
+				(!isFrom && !Aseba::parseTime(argv[argCounter], filter.to, filter.toRelative))
+			)
+			{
+				dumpHelp(std::cout, argv[0]);
+				return 1;
+			}
+		}
+		else if ((strcmp(arg, "--source") == 0) || (strcmp(arg, "--event") == 0))
+		{
+			const bool isSource(strcmp(arg, "--source") == 0);
+			argCounter++;
+			if (argCounter >= argc)
+			{
+				dumpHelp(std::cout, argv[0]);
+				return 1;
+			}
+			if (isSource)
+				filter.sources.insert(atoi(argv[argCounter]));
+			else
+				filter.events.insert(atoi(argv[argCounter]));
+		}
 		else if ((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0))
 		{
 			dumpHelp(std::cout, argv[0]);
@@ -250,15 +481,35 @@ int main(int argc, char *argv[])
 		argCounter++;
 	}
 	
+	if (exportText || dumpMessages)
+	{
+		if (!inputFile)
+		{
+			dumpHelp(std::cout, argv[0]);
+			return 1;
+		}
+		Aseba::LogReader reader(inputFile);
+		if (!reader.isValid())
+		{
+			std::cerr << inputFile << " is not a valid binary log" << std::endl;
+			return 1;
+		}
+		if (dumpMessages)
+			Aseba::dumpMessages(reader, filter, std::wcout);
+		else
+			Aseba::exportText(reader, filter, std::cout);
+		return 0;
+	}
+	
 	if (targets.empty())
 		targets.push_back(ASEBA_DEFAULT_TARGET);
 	
 	try
 	{
-		Aseba::Player player(inputFile, respectTimings, speedFactor);
+		Aseba::Player player(inputFile, respectTimings, speedFactor, filter);
 		for (size_t i = 0; i < targets.size(); i++)
 			player.connect(targets[i]);
-		player.run();
+		player.play();
 	}
 	catch(Dashel::DashelException e)
 	{
@@ -23,9 +23,16 @@
 #include "../../common/msg/msg.h"
 #include "../../common/utils/utils.h"
 #include "../../transport/dashel_plugins/dashel-plugins.h"
+#include "logfile.h"
+#include "capture.h"
 #include <time.h>
 #include <iostream>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <memory>
+#include <csignal>
 
 namespace Aseba
 {
@@ -38,17 +45,138 @@ namespace Aseba
 	/*@{*/
 	
 	//! A message recorder.
-	//! This class saves user messages
+	//! This class saves user messages, or all messages, in the binary log format or as text.
+	//! In the binary log format, raw frames are copied into a ring in memory, which is either
+	//! written to the file by a background thread, or kept as a flight recorder and dumped on request.
 	class Recorder : public Hub
 	{
 	protected:
+		bool allMessages; //!< whether to record all messages, not only user messages
+		MessagePool messagePool; //!< reusable instances of received messages, when recording as text
+		CaptureRing* ring; //!< ring of received frames, 0 if recording as text
+		LogWriter* writer; //!< writer of the binary log, 0 if recording as text or as flight recorder
+		CaptureWriterThread* writerThread; //!< thread writing the ring to the log, 0 if recording as text or as flight recorder
+		std::string flightRecorderFileName; //!< base name of the flight recorder dumps
+		unsigned dumpsCount; //!< number of flight recorder dumps
+		unsigned droppedFrames; //!< frames dropped because the ring was full
+		std::vector<uint8> frame; //!< buffer to receive frames into
 		
+	public:
+		//! Record user messages as text to stdout
+		Recorder() :
+			allMessages(false),
+			ring(0),
+			writer(0),
+			writerThread(0),
+			dumpsCount(0),
+			droppedFrames(0)
+		{}
+		
+		//! Record to file in the binary log format, through a ring of ringSize bytes
+		Recorder(FILE* file, bool allMessages, size_t ringSize) :
+			allMessages(allMessages),
+			ring(new CaptureRing(ringSize)),
+			writer(new LogWriter(file, allMessages ? LOG_FLAG_ALL_MESSAGES : 0)),
+			writerThread(new CaptureWriterThread(*ring, *writer)),
+			dumpsCount(0),
+			droppedFrames(0)
+		{
+			frame.reserve(ASEBA_MAX_EVENT_ARG_SIZE + 6);
+		}
+		
+		//! Keep the last ringSize bytes of frames, and dump them to files named fileName.N when requested
+		Recorder(const std::string& fileName, bool allMessages, size_t ringSize) :
+			allMessages(allMessages),
+			ring(new CaptureRing(ringSize)),
+			writer(0),
+			writerThread(0),
+			flightRecorderFileName(fileName),
+			dumpsCount(0),
+			droppedFrames(0)
+		{
+			frame.reserve(ASEBA_MAX_EVENT_ARG_SIZE + 6);
+		}
+		
+		//! Write remaining frames and close the log
+		~Recorder()
+		{
+			// stopping the thread writes all frames still in the ring
+			delete writerThread;
+			delete writer;
+			delete ring;
+			if (droppedFrames)
+				cerr << droppedFrames << " messages were dropped because the disk was too slow" << endl;
+		}
+		
+		//! Write the content of the flight recorder to a new file, return false on error
+		bool dumpFlightRecorder()
+		{
+			if (!ring || writer)
+				return false;
+			
+			ostringstream oss;
+			oss << flightRecorderFileName << "." << ++dumpsCount;
+			FILE* file(fopen(oss.str().c_str(), "wb"));
+			if (!file)
+			{
+				cerr << "Cannot open flight recorder dump file " << oss.str() << endl;
+				return false;
+			}
+			
+			// the recording starts with the oldest frame still in the ring
+			size_t pos(ring->begin());
+			UnifiedTime::Value time;
+			const UnifiedTime startTime(ring->read(pos, time, frame) ? UnifiedTime(time) : UnifiedTime());
+			
+			LogWriter dumpWriter(file, allMessages ? LOG_FLAG_ALL_MESSAGES : 0, startTime);
+			pos = ring->begin();
+			while (ring->read(pos, time, frame))
+				dumpWriter.write(UnifiedTime(time), &frame[0], frame.size());
+			dumpWriter.close();
+			
+			const bool ok(!dumpWriter.hasError());
+			fclose(file);
+			cerr << "Flight recorder dumped to " << oss.str() << endl;
+			return ok;
+		}
+		
+	protected:
 		void incomingData(Stream *stream)
 		{
-			Message *message = Message::receive(stream);
-			UserMessage *userMessage = dynamic_cast<UserMessage *>(message);
-			if (userMessage)
+			if (!ring)
+			{
+				recordAsText(stream);
+				return;
+			}
+			
+			// copy the raw frame without constructing any message
+			frame.resize(6);
+			stream->read(&frame[0], 6);
+			const uint16 len(uint16(frame[0]) | (uint16(frame[1]) << 8));
+			const uint16 type(uint16(frame[4]) | (uint16(frame[5]) << 8));
+			frame.resize(6 + len);
+			if (len)
+				stream->read(&frame[6], len);
+			
+			if (!allMessages && type >= 0x8000)
+				return;
+			
+			if (writerThread)
+			{
+				// if the disk cannot keep up, drop the frame rather than blocking the reception
+				if (!ring->push(UnifiedTime().value, &frame[0], frame.size()))
+					++droppedFrames;
+			}
+			else
+				ring->pushOverwrite(UnifiedTime().value, &frame[0], frame.size());
+		}
+		
+		void recordAsText(Stream *stream)
+		{
+			Message *message = messagePool.receive(stream);
+			if (message->isUserMessage())
 			{
+				UserMessage *userMessage = static_cast<UserMessage *>(message);
 				dumpTime(cout, true);
 				cout << userMessage->source << " ";
 				cout << userMessage->type << " ";
@@ -63,6 +191,24 @@ namespace Aseba
 	/*@}*/
 }
 
+//! Set when the user requests the recorder to stop
+static volatile sig_atomic_t interrupted = 0;
+
+//! Set when the user requests the flight recorder to be dumped
+static volatile sig_atomic_t dumpRequested = 0;
+
+//! Request the recorder to stop, so that the log is properly closed
+static void interruptHandler(int)
+{
+	interrupted = 1;
+}
+
+//! Request the flight recorder to be dumped
+static void dumpHandler(int)
+{
+	dumpRequested = 1;
+}
+
 
 //! Show usage
 void dumpHelp(std::ostream &stream, const char *programName)
@@ -70,6 +216,13 @@ void dumpHelp(std::ostream &stream, const char *programName)
 	stream << "Aseba rec, record the user messages to stdout for later replay, usage:\n";
 	stream << programName << " [options] [targets]*\n";
 	stream << "Options:\n";
+	stream << "-f OUTPUT_FILE  : write to OUTPUT_FILE in the binary log format instead of to stdout as text\n";
+	stream << "--binary        : write the binary log format even to stdout\n";
+	stream << "--text          : record as text, even to OUTPUT_FILE\n";
+	stream << "--all           : record all messages, not only user messages, in the binary log format\n";
+	stream << "--ring SIZE     : buffer up to SIZE MB of messages in memory while writing them to disk (default: 16)\n";
+	stream << "--flight-recorder SIZE : only keep the last SIZE MB of messages in memory, and write them\n";
+	stream << "                  to OUTPUT_FILE.N on SIGUSR1 and when quitting\n";
 	stream << "-h, --help      : shows this help\n";
 	stream << "-V, --version   : shows the version number\n";
 	stream << "Targets are any valid Dashel targets." << std::endl;
@@ -88,6 +241,12 @@ int main(int argc, char *argv[])
 {
 	Dashel::initPlugins();
 	std::vector<std::string> targets;
+	const char* outputFile = 0;
+	bool text = false;
+	bool binary = false;
+	bool allMessages = false;
+	unsigned ringSize = 16;
+	unsigned flightRecorderSize = 0;
 	
 	int argCounter = 1;
 	
@@ -105,6 +264,43 @@ int main(int argc, char *argv[])
 			dumpVersion(std::cout);
 			return 0;
 		}
+		else if (strcmp(arg, "-f") == 0)
+		{
+			argCounter++;
+			if (argCounter >= argc)
+			{
+				dumpHelp(std::cout, argv[0]);
+				return 1;
+			}
+			else
+				outputFile = argv[argCounter];
+		}
+		else if (strcmp(arg, "--text") == 0)
+		{
+			text = true;
+		}
+		else if (strcmp(arg, "--binary") == 0)
+		{
+			binary = true;
+		}
+		else if (strcmp(arg, "--all") == 0)
+		{
+			allMessages = true;
+		}
+		else if ((strcmp(arg, "--ring") == 0) || (strcmp(arg, "--flight-recorder") == 0))
+		{
+			const bool isRing(strcmp(arg, "--ring") == 0);
+			argCounter++;
+			if ((argCounter >= argc) || (atoi(argv[argCounter]) <= 0))
+			{
+				dumpHelp(std::cout, argv[0]);
+				return 1;
+			}
+			if (isRing)
+				ringSize = atoi(argv[argCounter]);
+			else
+				flightRecorderSize = atoi(argv[argCounter]);
+		}
 		else
 		{
 			targets.push_back(argv[argCounter]);
@@ -115,17 +311,84 @@ int main(int argc, char *argv[])
 	if (targets.empty())
 		targets.push_back(ASEBA_DEFAULT_TARGET);
 	
+	if (text && binary)
+	{
+		std::cerr << "Cannot record both as text and in the binary log format" << std::endl;
+		return 1;
+	}
+	// stdout is read as text by asebaplay, so the binary log format is only used for files or when requested
+	if (!binary && !outputFile)
+		text = true;
+	if (text && (allMessages || flightRecorderSize))
+	{
+		std::cerr << "Only user messages can be recorded as text, and not as flight recorder; use -f or --binary" << std::endl;
+		return 1;
+	}
+	if (flightRecorderSize && !outputFile)
+	{
+		std::cerr << "The flight recorder needs an output file" << std::endl;
+		return 1;
+	}
+	
+	FILE* file = 0;
+	if (text)
+	{
+		// text is written through cout
+		if (outputFile && !freopen(outputFile, "w", stdout))
+		{
+			std::cerr << "Cannot open output file " << outputFile << std::endl;
+			return 1;
+		}
+	}
+	else if (!flightRecorderSize)
+	{
+		file = outputFile ? fopen(outputFile, "wb") : stdout;
+		if (!file)
+		{
+			std::cerr << "Cannot open output file " << outputFile << std::endl;
+			return 1;
+		}
+	}
+	
+	signal(SIGINT, interruptHandler);
+	signal(SIGTERM, interruptHandler);
+	#ifdef SIGUSR1
+	signal(SIGUSR1, dumpHandler);
+	#endif // SIGUSR1
+	
 	try
 	{
-		Aseba::Recorder recorder;
+		std::auto_ptr<Aseba::Recorder> recorder;
+		if (text)
+			recorder.reset(new Aseba::Recorder());
+		else if (flightRecorderSize)
+			recorder.reset(new Aseba::Recorder(outputFile, allMessages, size_t(flightRecorderSize) * 1024 * 1024));
+		else
+			recorder.reset(new Aseba::Recorder(file, allMessages, size_t(ringSize) * 1024 * 1024));
+		
 		for (size_t i = 0; i < targets.size(); i++)
-			recorder.connect(targets[i]);
-		recorder.run();
+			recorder->connect(targets[i]);
+		
+		// run until interrupted
+		while (!interrupted && recorder->step(100))
+		{
+			if (dumpRequested)
+			{
+				dumpRequested = 0;
+				recorder->dumpFlightRecorder();
+			}
+		}
+		
+		if (flightRecorderSize)
+			recorder->dumpFlightRecorder();
 	}
 	catch(Dashel::DashelException e)
 	{
 		std::cerr << e.what() << std::endl;
 	}
 	
+	if (file && file != stdout)
+		fclose(file);
+	
 	return 0;
 }
@@ -434,6 +434,60 @@ namespace Aseba
 		return breakpoint.width() + 2*borderSize;
 	}
 
+	AeslProfileSidebar::AeslProfileSidebar(AeslEditor *editor) :
+		AeslEditorSidebar(editor)
+	{
+	}
+
+	void AeslProfileSidebar::paintEvent(QPaintEvent *event)
+	{
+		AeslEditorSidebar::paintEvent(event);
+
+		// begin painting
+		QPainter painter(this);
+
+		// fill the background
+		painter.fillRect(event->rect(), QColor(210, 210, 210));
+
+		// get the editor's painting area
+		QRect editorRect = editor->contentsRect();
+
+		// enable clipping to match the vertical painting area of the editor
+		painter.setClipRect(QRect(0, editorRect.top(), width(), editorRect.bottom()), Qt::ReplaceClip );
+		painter.setClipping(true);
+
+		// get the first text block
+		QTextBlock block = editor->document()->firstBlock();
+
+		painter.setPen(Qt::darkBlue);
+		// iterate over all text blocks
+		while(block.isValid())
+		{
+			AeslEditorUserData *uData = polymorphic_downcast_or_null<AeslEditorUserData *>(block.userData());
+			if (block.isVisible() && uData && uData->properties.contains("profile"))
+			{
+				// paint the counters
+				int y = block.layout()->position().y() + editorRect.top() - verticalScroll;
+				painter.drawText(3, y, width() - 3, fontMetrics().height(), Qt::AlignLeft, uData->properties["profile"].toString());
+			}
+
+			block = block.next();
+		}
+	}
+
+	int AeslProfileSidebar::idealWidth() const
+	{
+		// as wide as the longest counters, hidden if there are none
+		int space = 0;
+		for (QTextBlock block = editor->document()->begin(); block != editor->document()->end(); block = block.next())
+		{
+			AeslEditorUserData *uData = polymorphic_downcast_or_null<AeslEditorUserData *>(block.userData());
+			if (uData && uData->properties.contains("profile"))
+				space = qMax(space, 6 + fontMetrics().width(uData->properties["profile"].toString()));
+		}
+		return space;
+	}
+
 	AeslEditor::AeslEditor() :
 		debugging(false),
 		completer(0),
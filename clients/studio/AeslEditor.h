@@ -139,6 +139,19 @@ namespace Aseba
 		QRect breakpoint;
 	};
 	
+	//! Show the counters of the profiler stored in the "profile" property of lines, typically the ones of onevent and sub
+	class AeslProfileSidebar : public AeslEditorSidebar
+	{
+		Q_OBJECT
+
+	public:
+		AeslProfileSidebar(AeslEditor* editor);
+
+	protected:
+		virtual void paintEvent(QPaintEvent *event);
+		virtual int idealWidth() const;
+	};
+	
 	enum LocalContext {
 		UnknownContext,
 		VarDefContext,
@@ -397,9 +397,17 @@ namespace Aseba
 		WAITING_LINE_CHANGE
 	};
 	
+	//! Time in ms without any chunk after which a snapshot is considered lost
+	static const int SNAPSHOT_TIMEOUT = 1000;
+	
 	DashelTarget::Node::Node()
 	{
 		executionMode = EXECUTION_UNKNOWN;
+		snapshotStart = 0;
+		snapshotLength = 0;
+		snapshotSequence = 0;
+		snapshotPending = false;
+		snapshotUnsupported = false;
 	}
 	
 	DashelTarget::DashelTarget(QVector<QTranslator*> translators, const QString& commandLineTarget) :
@@ -408,6 +416,7 @@ namespace Aseba
 	{
 		userEventsTimer.setSingleShot(true);
 		connect(&userEventsTimer, SIGNAL(timeout()), SLOT(updateUserEvents()));
+		connect(&snapshotsTimer, SIGNAL(timeout()), SLOT(checkSnapshots()));
 		
 		// we connect the events from the stream listening thread to slots living in our gui thread
 		connect(&dashelInterface, SIGNAL(messageAvailable(Message *)), SLOT(messageFromDashel(Message *)), Qt::QueuedConnection);
@@ -418,6 +427,8 @@ namespace Aseba
 		
 		messagesHandlersMap[ASEBA_MESSAGE_DISCONNECTED] = &Aseba::DashelTarget::receivedDisconnected;
 		messagesHandlersMap[ASEBA_MESSAGE_VARIABLES] = &Aseba::DashelTarget::receivedVariables;
+		messagesHandlersMap[ASEBA_MESSAGE_VARIABLES_SNAPSHOT_CHUNK] = &Aseba::DashelTarget::receivedVariablesSnapshotChunk;
+		messagesHandlersMap[ASEBA_MESSAGE_VARIABLES_SNAPSHOT_END] = &Aseba::DashelTarget::receivedVariablesSnapshotEnd;
 		messagesHandlersMap[ASEBA_MESSAGE_ARRAY_ACCESS_OUT_OF_BOUNDS] = &Aseba::DashelTarget::receivedArrayAccessOutOfBounds;
 		messagesHandlersMap[ASEBA_MESSAGE_DIVISION_BY_ZERO] = &Aseba::DashelTarget::receivedDivisionByZero;
 		messagesHandlersMap[ASEBA_MESSAGE_EVENT_EXECUTION_KILLED] = &Aseba::DashelTarget::receivedEventExecutionKilled;
@@ -425,6 +436,7 @@ namespace Aseba
 		messagesHandlersMap[ASEBA_MESSAGE_EXECUTION_STATE_CHANGED] = &Aseba::DashelTarget::receivedExecutionStateChanged;
 		messagesHandlersMap[ASEBA_MESSAGE_BREAKPOINT_SET_RESULT] = &Aseba::DashelTarget::receivedBreakpointSetResult;
 		messagesHandlersMap[ASEBA_MESSAGE_BOOTLOADER_ACK] = &Aseba::DashelTarget::receivedBootloaderAck;
+		messagesHandlersMap[ASEBA_MESSAGE_PROFILE] = &Aseba::DashelTarget::receivedProfile;
 
 		dashelInterface.start();
 	}
@@ -634,6 +646,51 @@ namespace Aseba
 			dashelInterface.unlock();
 	}
 	
+	void DashelTarget::getVariablesSnapshot(unsigned node, unsigned start, unsigned length)
+	{
+		// nodes with an older firmware only answer to GetVariables
+		NodesMap::iterator nodeIt = nodes.find(node);
+		if (nodeIt == nodes.end() || nodeIt->second.snapshotUnsupported)
+		{
+			getVariables(node, start, length);
+			return;
+		}
+		
+		// a snapshot is already on its way
+		Node& targetNode = nodeIt->second;
+		if (targetNode.snapshotPending)
+			return;
+		
+		dashelInterface.lock();
+		if (dashelInterface.stream && !writeBlocked)
+		{
+			try
+			{
+				GetVariablesSnapshot(node, start, length).serialize(dashelInterface.stream);
+				dashelInterface.stream->flush();
+				dashelInterface.unlock();
+			}
+			catch(Dashel::DashelException e)
+			{
+				dashelInterface.unlock();
+				handleDashelException(e);
+				return;
+			}
+			
+			targetNode.snapshot.clear();
+			targetNode.snapshot.reserve(length);
+			targetNode.snapshotStart = start;
+			targetNode.snapshotLength = length;
+			targetNode.snapshotSequence = 0;
+			targetNode.snapshotPending = true;
+			targetNode.snapshotActivity.start();
+			if (!snapshotsTimer.isActive())
+				snapshotsTimer.start(SNAPSHOT_TIMEOUT / 2);
+		}
+		else
+			dashelInterface.unlock();
+	}
+	
 	void DashelTarget::reset(unsigned node)
 	{
 		dashelInterface.lock();
@@ -834,6 +891,48 @@ namespace Aseba
 			dashelInterface.unlock();
 	}
 	
+	void DashelTarget::getProfile(unsigned node)
+	{
+		dashelInterface.lock();
+		if (dashelInterface.stream && !writeBlocked)
+		{
+			try
+			{
+				GetProfile(node).serialize(dashelInterface.stream);
+				dashelInterface.stream->flush();
+				dashelInterface.unlock();
+			}
+			catch(Dashel::DashelException e)
+			{
+				dashelInterface.unlock();
+				handleDashelException(e);
+			}
+		}
+		else
+			dashelInterface.unlock();
+	}
+	
+	void DashelTarget::resetProfile(unsigned node)
+	{
+		dashelInterface.lock();
+		if (dashelInterface.stream && !writeBlocked)
+		{
+			try
+			{
+				ResetProfile(node).serialize(dashelInterface.stream);
+				dashelInterface.stream->flush();
+				dashelInterface.unlock();
+			}
+			catch(Dashel::DashelException e)
+			{
+				dashelInterface.unlock();
+				handleDashelException(e);
+			}
+		}
+		else
+			dashelInterface.unlock();
+	}
+	
 	void DashelTarget::blockWrite()
 	{
 		writeBlocked = true;
@@ -951,15 +1050,84 @@ namespace Aseba
 		node.steppingInNext = NOT_IN_NEXT;
 		node.lineInNext = 0;
 		
+		// the node might have a new firmware
+		node.snapshotPending = false;
+		node.snapshotUnsupported = false;
+		
 		emit nodeConnected(nodeId);
 	}
 	
+	void DashelTarget::checkSnapshots()
+	{
+		bool pending = false;
+		for (NodesMap::iterator it = nodes.begin(); it != nodes.end(); ++it)
+		{
+			Node& node = it->second;
+			if (!node.snapshotPending)
+				continue;
+			if (node.snapshotActivity.elapsed() < SNAPSHOT_TIMEOUT)
+			{
+				pending = true;
+				continue;
+			}
+			
+			// the snapshot was lost, if the node did not answer at all it does not support snapshots
+			node.snapshotPending = false;
+			if (node.snapshotSequence == 0)
+				node.snapshotUnsupported = true;
+			getVariables(it->first, node.snapshotStart, node.snapshotLength);
+		}
+		if (!pending)
+			snapshotsTimer.stop();
+	}
+	
 	void DashelTarget::receivedVariables(Message *message)
 	{
 		Variables *variables = polymorphic_downcast<Variables *>(message);
 		emit variablesMemoryChanged(variables->source, variables->start, variables->variables);
 	}
 	
+	void DashelTarget::receivedVariablesSnapshotChunk(Message *message)
+	{
+		VariablesSnapshotChunk *chunk = polymorphic_downcast<VariablesSnapshotChunk *>(message);
+		NodesMap::iterator nodeIt = nodes.find(chunk->source);
+		if (nodeIt == nodes.end() || !nodeIt->second.snapshotPending)
+			return;
+		
+		Node& node = nodeIt->second;
+		node.snapshotActivity.start();
+		
+		// if a chunk was lost, read the variables the old way
+		if ((chunk->sequence != node.snapshotSequence) || (chunk->start != node.snapshotStart + node.snapshot.size()))
+		{
+			node.snapshotPending = false;
+			getVariables(chunk->source, node.snapshotStart, node.snapshotLength);
+			return;
+		}
+		
+		node.snapshot.insert(node.snapshot.end(), chunk->variables.begin(), chunk->variables.end());
+		node.snapshotSequence++;
+	}
+	
+	void DashelTarget::receivedVariablesSnapshotEnd(Message *message)
+	{
+		VariablesSnapshotEnd *end = polymorphic_downcast<VariablesSnapshotEnd *>(message);
+		NodesMap::iterator nodeIt = nodes.find(end->source);
+		if (nodeIt == nodes.end() || !nodeIt->second.snapshotPending)
+			return;
+		
+		Node& node = nodeIt->second;
+		node.snapshotPending = false;
+		if ((end->chunksCount != node.snapshotSequence) || (node.snapshot.size() != node.snapshotLength))
+		{
+			getVariables(end->source, node.snapshotStart, node.snapshotLength);
+			return;
+		}
+		
+		// notify the whole snapshot at once, so that views are refreshed only once
+		emit variablesMemoryChanged(end->source, node.snapshotStart, node.snapshot);
+	}
+	
 	void DashelTarget::receivedArrayAccessOutOfBounds(Message *message)
 	{
 		ArrayAccessOutOfBounds *aa = polymorphic_downcast<ArrayAccessOutOfBounds *>(message);
@@ -1135,6 +1303,18 @@ namespace Aseba
 		emit bootloaderAck(ack->errorCode, ack->errorAddress);
 	}
 	
+	void DashelTarget::receivedProfile(Message *message)
+	{
+		Profile *profile = polymorphic_downcast<Profile *>(message);
+		if (profile->entriesCount == 0)
+			return;
+		
+		// show the counters at the line of the first instruction of the event handler or subroutine
+		int line = getLineFromPC(profile->source, profile->address);
+		if (line >= 0)
+			emit profileEntryReceived(profile->source, line, profile->instructionsCount, profile->nativeCallsCount, profile->nativeTime);
+	}
+	
 	int DashelTarget::getPCFromLine(unsigned node, unsigned line)
 	{
 		// first lookup node
@@ -28,6 +28,7 @@
 #include <QDialog>
 #include <QQueue>
 #include <QTimer>
+#include <QTime>
 #include <QThread>
 #include <map>
 #include <dashel/dashel.h>
@@ -143,6 +144,14 @@ namespace Aseba
 			unsigned steppingInNext; //!< state of node when in next and stepping
 			unsigned lineInNext; //!< line of node to execute when in next and stepping
 			ExecutionMode executionMode; //!< last known execution mode if this node
+			
+			VariablesDataVector snapshot; //!< variables of the snapshot being received
+			unsigned snapshotStart; //!< start of the snapshot being received
+			unsigned snapshotLength; //!< number of variables of the snapshot being received
+			unsigned snapshotSequence; //!< sequence number of the next chunk of the snapshot
+			bool snapshotPending; //!< whether a snapshot is being received
+			bool snapshotUnsupported; //!< whether the node ignored a snapshot request, in which case getVariables is used instead
+			QTime snapshotActivity; //!< when the snapshot was requested or its last chunk received
 		};
 		
 		typedef void (DashelTarget::*MessageHandler)(Message *message);
@@ -157,6 +166,7 @@ namespace Aseba
 		SignalingDescriptionsManager descriptionManager;
 		NodesMap nodes;
 		QTimer userEventsTimer;
+		QTimer snapshotsTimer; //!< check for snapshots that are not answered
 		bool writeBlocked; //!< true if write is being blocked by invasive plugins, false if write is allowed
 		
 	public:
@@ -180,6 +190,7 @@ namespace Aseba
 		
 		virtual void setVariables(unsigned node, unsigned start, const VariablesDataVector &data);
 		virtual void getVariables(unsigned node, unsigned start, unsigned length);
+		virtual void getVariablesSnapshot(unsigned node, unsigned start, unsigned length);
 		
 		virtual void reset(unsigned node);
 		virtual void run(unsigned node);
@@ -190,6 +201,9 @@ namespace Aseba
 		virtual void setBreakpoint(unsigned node, unsigned line);
 		virtual void clearBreakpoint(unsigned node, unsigned line);
 		virtual void clearBreakpoints(unsigned node);
+		
+		virtual void getProfile(unsigned node);
+		virtual void resetProfile(unsigned node);
 	
 	protected:
 		virtual void blockWrite();
@@ -197,6 +211,7 @@ namespace Aseba
 	
 	protected slots:
 		void updateUserEvents();
+		void checkSnapshots();
 		void messageFromDashel(Message *message);
 		void disconnectionFromDashel();
 		void nodeDescriptionReceived(unsigned node);
@@ -207,6 +222,8 @@ namespace Aseba
 		void receivedNativeFunctionDescription(Message *message);
 		void receivedDisconnected(Message *message);
 		void receivedVariables(Message *message);
+		void receivedVariablesSnapshotChunk(Message *message);
+		void receivedVariablesSnapshotEnd(Message *message);
 		void receivedArrayAccessOutOfBounds(Message *message);
 		void receivedDivisionByZero(Message *message);
 		void receivedEventExecutionKilled(Message *message);
@@ -214,6 +231,7 @@ namespace Aseba
 		void receivedExecutionStateChanged(Message *message);
 		void receivedBreakpointSetResult(Message *message);
 		void receivedBootloaderAck(Message *message);
+		void receivedProfile(Message *message);
 		
 	protected:
 		bool emitNodeConnectedIfDescriptionComplete(unsigned id, const Node& node);
@@ -419,6 +419,8 @@ namespace Aseba
 		editorAreaLayout->addWidget(breakpoints);
 		editorAreaLayout->addWidget(linenumbers);
 		editorAreaLayout->addWidget(editor);
+		profileSidebar = new AeslProfileSidebar(editor);
+		editorAreaLayout->addWidget(profileSidebar);
 		
 		// keywords
 		keywordsToolbar = new QToolBar();
@@ -463,6 +465,9 @@ namespace Aseba
 		nextButton->setEnabled(false);
 		refreshMemoryButton = new QPushButton(QIcon(":/images/rescan.png"), tr("refresh"));
 		autoRefreshMemoryCheck = new QCheckBox(tr("auto"));
+		profileButton = new QPushButton(tr("Profile"));
+		profileButton->setToolTip(tr("Show the instructions and native calls executed by each event handler and subroutine, if the node has a profiler"));
+		resetProfileButton = new QPushButton(tr("Clear profile"));
 		
 		QGridLayout* buttonsLayout = new QGridLayout;
 		buttonsLayout->addWidget(new QLabel(tr("<b>Execution</b>")), 0, 0);
@@ -471,6 +476,8 @@ namespace Aseba
 		buttonsLayout->addWidget(runInterruptButton, 1, 1);
 		buttonsLayout->addWidget(resetButton, 2, 0);
 		buttonsLayout->addWidget(nextButton, 2, 1);
+		buttonsLayout->addWidget(profileButton, 3, 0);
+		buttonsLayout->addWidget(resetProfileButton, 3, 1);
 		
 		// memory
 		vmMemoryView = new QTreeView;
@@ -581,6 +588,8 @@ namespace Aseba
 		connect(nextButton, SIGNAL(clicked()), SLOT(nextClicked()));
 		connect(refreshMemoryButton, SIGNAL(clicked()), SLOT(refreshMemoryClicked()));
 		connect(autoRefreshMemoryCheck, SIGNAL(stateChanged(int)), SLOT(autoRefreshMemoryClicked(int)));
+		connect(profileButton, SIGNAL(clicked()), SLOT(profileClicked()));
+		connect(resetProfileButton, SIGNAL(clicked()), SLOT(resetProfileClicked()));
 		
 		// memory
 		connect(vmMemoryModel, SIGNAL(variableValuesChanged(unsigned, const VariablesDataVector &)), SLOT(setVariableValues(unsigned, const VariablesDataVector &)));
@@ -759,6 +768,9 @@ namespace Aseba
 		if (errorPos == -1)
 		{
 			clearEditorProperty("executionError");
+			// the node forgets its profile when receiving new bytecode
+			clearEditorProperty("profile");
+			profileSidebar->updateGeometry();
 			target->uploadBytecode(id, bytecode);
 			//target->getVariables(id, 0, allocatedVariablesCount);
 			editor->debugging = true;
@@ -786,7 +798,24 @@ namespace Aseba
 	void NodeTab::refreshMemoryClicked()
 	{
 		// as we explicitely clicked, refresh all variables
-		target->getVariables(id, 0, allocatedVariablesCount);
+		target->getVariablesSnapshot(id, 0, allocatedVariablesCount);
+	}
+	
+	void NodeTab::profileClicked()
+	{
+		// the counters are shown as they arrive
+		clearEditorProperty("profile");
+		profileSidebar->updateGeometry();
+		profileSidebar->update();
+		target->getProfile(id);
+	}
+	
+	void NodeTab::resetProfileClicked()
+	{
+		clearEditorProperty("profile");
+		profileSidebar->updateGeometry();
+		profileSidebar->update();
+		target->resetProfile(id);
 	}
 	
 	void NodeTab::autoRefreshMemoryClicked(int state)
@@ -1368,6 +1397,24 @@ namespace Aseba
 		rehighlight();
 	}
 	
+	void NodeTab::profileEntryReceived(unsigned line, unsigned instructionsCount, unsigned nativeCallsCount, unsigned nativeTime)
+	{
+		// show the counters next to the onevent or sub that contains line
+		QTextBlock block = editor->document()->findBlockByNumber(line);
+		const QRegExp headerRegexp("^\\s*(onevent|sub)\\b");
+		while (block.isValid() && (headerRegexp.indexIn(block.text()) == -1))
+			block = block.previous();
+		if (block.isValid())
+			line = block.blockNumber();
+		
+		QString counters(tr("%1 instructions, %2 native calls").arg(instructionsCount).arg(nativeCallsCount));
+		if (nativeTime)
+			counters += tr(", native time %1").arg(nativeTime);
+		setEditorProperty("profile", counters, line);
+		profileSidebar->updateGeometry();
+		profileSidebar->update();
+	}
+	
 	void NodeTab::closePlugins()
 	{
 		for (NodeToolInterfaces::const_iterator it(tools.begin()); it != tools.end(); ++it)
@@ -2852,6 +2899,15 @@ namespace Aseba
 		tab->breakpointSetResult(line, success);
 	}
 	
+	//! Counters of the profiler of a node were received
+	void MainWindow::profileEntryReceived(unsigned node, unsigned line, unsigned instructionsCount, unsigned nativeCallsCount, unsigned nativeTime)
+	{
+		NodeTab* tab = getTabFromId(node);
+		Q_ASSERT(tab);
+		
+		tab->profileEntryReceived(line, instructionsCount, nativeCallsCount, nativeTime);
+	}
+	
 	//! If any node was disconnected, send get description
 	void MainWindow::timerEvent ( QTimerEvent * event )
 	{
@@ -3212,6 +3268,7 @@ namespace Aseba
 		connect(target, SIGNAL(variablesMemoryChanged(unsigned, unsigned, const VariablesDataVector &)), SLOT(variablesMemoryChanged(unsigned, unsigned, const VariablesDataVector &)));
 		
 		connect(target, SIGNAL(breakpointSetResult(unsigned, unsigned, bool)), SLOT(breakpointSetResult(unsigned, unsigned, bool)));
+		connect(target, SIGNAL(profileEntryReceived(unsigned, unsigned, unsigned, unsigned, unsigned)), SLOT(profileEntryReceived(unsigned, unsigned, unsigned, unsigned, unsigned)));
 	}
 	
 	void MainWindow::regenerateOpenRecentMenu()
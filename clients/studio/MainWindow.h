@@ -244,6 +244,8 @@ namespace Aseba
 		void runInterruptClicked();
 		void nextClicked();
 		void refreshMemoryClicked();
+		void profileClicked();
+		void resetProfileClicked();
 		void autoRefreshMemoryClicked(int state);
 		
 		void writeBytecode();
@@ -274,6 +276,7 @@ namespace Aseba
 		void executionModeChanged(Target::ExecutionMode mode);
 		
 		void breakpointSetResult(unsigned line, bool success);
+		void profileEntryReceived(unsigned line, unsigned instructionsCount, unsigned nativeCallsCount, unsigned nativeTime);
 		
 		void closePlugins();
 		
@@ -315,6 +318,9 @@ namespace Aseba
 		QPushButton *nextButton;
 		QPushButton *refreshMemoryButton;
 		QCheckBox *autoRefreshMemoryCheck;
+		QPushButton *profileButton;
+		QPushButton *resetProfileButton;
+		AeslProfileSidebar *profileSidebar;
 		
 		// keywords
 		QToolButton *varButton;
@@ -475,6 +481,7 @@ namespace Aseba
 		void variablesMemoryChanged(unsigned node, unsigned start, const VariablesDataVector &variables);
 		
 		void breakpointSetResult(unsigned node, unsigned line, bool success);
+		void profileEntryReceived(unsigned node, unsigned line, unsigned instructionsCount, unsigned nativeCallsCount, unsigned nativeTime);
 	
 		void recompileAll();
 		void writeAllBytecodes();
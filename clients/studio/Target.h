@@ -86,6 +86,9 @@ namespace Aseba
 		//! The result of a set breakpoint call
 		void breakpointSetResult(unsigned node, unsigned line, bool success);
 		
+		//! The counters of the event handler or subroutine starting at line were received from the profiler of a node
+		void profileEntryReceived(unsigned node, unsigned line, unsigned instructionsCount, unsigned nativeCallsCount, unsigned nativeTime);
+		
 		//! We received an ack from the bootloader
 		void bootloaderAck(unsigned errorCode, unsigned errorAddress);
 		
@@ -130,6 +133,9 @@ namespace Aseba
 		//! Get part of variables memory
 		virtual void getVariables(unsigned node, unsigned start, unsigned length) = 0;
 		
+		//! Get part of variables memory at once, its content is notified by a single variablesMemoryChanged once all of it is received
+		virtual void getVariablesSnapshot(unsigned node, unsigned start, unsigned length) = 0;
+		
 		// execution
 		
 		//! Reset the execution of a node, do not clear bytecode nor breakpoints
@@ -157,6 +163,14 @@ namespace Aseba
 		
 		//! Remove all breakpoints in a node
 		virtual void clearBreakpoints(unsigned node) = 0;
+		
+		// profiler
+		
+		//! Request the counters of the profiler of a node, notified by profileEntryReceived; nodes without profiler do not answer
+		virtual void getProfile(unsigned node) = 0;
+		
+		//! Clear the counters of the profiler of a node
+		virtual void resetProfile(unsigned node) = 0;
 	
 	protected:
 		friend class ThymioBootloaderDialog;
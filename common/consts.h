@@ -115,6 +115,15 @@ typedef enum
 /*! Bit inside if opcode that indicates that the last evaluation was true */
 #define ASEBA_IF_WAS_TRUE_BIT 9
 
+/*! Bit inside native call opcode that indicates that the arguments are not on the stack but follow the call in bytecode, in the order natives read them; no node advertises its support yet */
+#define ASEBA_NATIVE_CALL_ARGS_BLOCK_BIT 11
+/*! Position of the number of arguments inside native call opcode with arguments following it */
+#define ASEBA_NATIVE_CALL_ARGS_COUNT_SHIFT 7
+/*! Mask of the number of arguments inside native call opcode with arguments following it, once shifted */
+#define ASEBA_NATIVE_CALL_ARGS_COUNT_MASK 0xf
+/*! Mask of the native function identifier inside native call opcode with arguments following it */
+#define ASEBA_NATIVE_CALL_ARGS_ID_MASK 0x7f
+
 /*! List of masks for flags in AsebaVMState */
 typedef enum
 {
@@ -150,6 +159,13 @@ typedef enum
 	ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_READ,
 	ASEBA_MESSAGE_BOOTLOADER_ACK,
 	
+	/* from bootloader control program to a specific node, if advertised in the bootloader description */
+	ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK = 0x8007,
+	ASEBA_MESSAGE_BOOTLOADER_GET_PAGES_HASH,
+	
+	/* from node to bootloader control program, if advertised in the bootloader description */
+	ASEBA_MESSAGE_BOOTLOADER_PAGES_HASH,
+	
 	/* from a specific node */
 	ASEBA_MESSAGE_DESCRIPTION = 0x9000,
 	ASEBA_MESSAGE_NAMED_VARIABLE_DESCRIPTION,
@@ -163,6 +179,10 @@ typedef enum
 	ASEBA_MESSAGE_NODE_SPECIFIC_ERROR,
 	ASEBA_MESSAGE_EXECUTION_STATE_CHANGED,
 	ASEBA_MESSAGE_BREAKPOINT_SET_RESULT,
+	ASEBA_MESSAGE_DESCRIPTION_HASH,
+	ASEBA_MESSAGE_VARIABLES_SNAPSHOT_CHUNK,
+	ASEBA_MESSAGE_VARIABLES_SNAPSHOT_END,
+	ASEBA_MESSAGE_PROFILE,
 	
 	/* from IDE to all nodes */
 	ASEBA_MESSAGE_GET_DESCRIPTION = 0xA000,
@@ -184,6 +204,15 @@ typedef enum
 	ASEBA_MESSAGE_REBOOT,
 	ASEBA_MESSAGE_SUSPEND_TO_RAM,
 	
+	/* from IDE to all nodes */
+	ASEBA_MESSAGE_GET_DESCRIPTION_HASH,
+	
+	/* from IDE to a specific node */
+	ASEBA_MESSAGE_GET_NODE_DESCRIPTION,
+	ASEBA_MESSAGE_GET_VARIABLES_SNAPSHOT,
+	ASEBA_MESSAGE_GET_PROFILE,
+	ASEBA_MESSAGE_RESET_PROFILE,
+	
 	ASEBA_MESSAGE_INVALID = 0xFFFF
 } AsebaSystemMessagesTypes;
 
@@ -209,6 +238,9 @@ typedef enum
 /*! Maximum size of an event (in bytes), including its type plus the source and the length */
 #define ASEBA_MAX_OUTER_PACKET_SIZE (ASEBA_MAX_INNER_PACKET_SIZE+4) 
 
+/*! Maximum number of variables in a chunk of a variables snapshot, leaving room for its sequence number and start */
+#define ASEBA_VARIABLES_SNAPSHOT_CHUNK_SIZE (ASEBA_MAX_EVENT_ARG_COUNT-2)
+
 /*! *DEPRECATED*, please use one of the more explicit defines above */
 #define ASEBA_MAX_PACKET_SIZE ASEBA_MAX_INNER_PACKET_SIZE
 
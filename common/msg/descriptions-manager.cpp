@@ -20,7 +20,9 @@
 
 #include "descriptions-manager.h"
 #include "msg.h"
+#include "../utils/utils.h"
 #include <iostream>
+#include <fstream>
 
 using namespace std;
 
@@ -29,7 +31,9 @@ namespace Aseba
 	DescriptionsManager::NodeDescription::NodeDescription() :
 		namedVariablesReceptionCounter(0),
 		localEventsReceptionCounter(0),
-		nativeFunctionReceptionCounter(0)
+		nativeFunctionReceptionCounter(0),
+		crcKnown(false),
+		crc(0)
 	{
 	}
 	
@@ -37,116 +41,208 @@ namespace Aseba
 		TargetDescription(targetDescription),
 		namedVariablesReceptionCounter(0),
 		localEventsReceptionCounter(0),
-		nativeFunctionReceptionCounter(0)
+		nativeFunctionReceptionCounter(0),
+		crcKnown(false),
+		crc(0)
 	{
 	}
 	
 	void DescriptionsManager::processMessage(const Message* message)
 	{
-		// if we have a disconnection message
+		// dispatch on the message type, which identifies the class of the message, without using RTTI
+		switch (message->type)
 		{
-			const Disconnected *disconnected = dynamic_cast<const Disconnected *>(message);
-			if (disconnected)
+			case ASEBA_MESSAGE_DISCONNECTED:
+			processDisconnected(static_cast<const Disconnected *>(message));
+			break;
+			
+			case ASEBA_MESSAGE_DESCRIPTION_HASH:
+			processDescriptionHash(static_cast<const DescriptionHash *>(message));
+			break;
+			
+			case ASEBA_MESSAGE_DESCRIPTION:
+			processDescription(static_cast<const Description *>(message));
+			break;
+			
+			case ASEBA_MESSAGE_NAMED_VARIABLE_DESCRIPTION:
+			processNamedVariableDescription(static_cast<const NamedVariableDescription *>(message));
+			break;
+			
+			case ASEBA_MESSAGE_LOCAL_EVENT_DESCRIPTION:
+			processLocalEventDescription(static_cast<const LocalEventDescription *>(message));
+			break;
+			
+			case ASEBA_MESSAGE_NATIVE_FUNCTION_DESCRIPTION:
+			processNativeFunctionDescription(static_cast<const NativeFunctionDescription *>(message));
+			break;
+			
+			default:
+			break;
+		}
+	}
+	
+	void DescriptionsManager::processDisconnected(const Disconnected *disconnected)
+	{
+		NodesDescriptionsMap::iterator it = nodesDescriptions.find(disconnected->source);
+		if (it != nodesDescriptions.end())
+			nodesDescriptions.erase(it);
+		pendingCacheKeys.erase(disconnected->source);
+	}
+	
+	void DescriptionsManager::processDescriptionHash(const DescriptionHash *descriptionHash)
+	{
+		// We might already know this node, for instance if there is another IDE connected,
+		// but if it was reflashed with another firmware, its description must be received again
+		NodesDescriptionsMap::iterator known = nodesDescriptions.find(descriptionHash->source);
+		if (known != nodesDescriptions.end())
+		{
+			NodeDescription& description(known->second);
+			if (description.crcKnown && description.crc == descriptionHash->crc)
+				return;
+			
+			// the description was received without its hash, for instance through GetDescription, learn it
+			if (!description.crcKnown && description.name == descriptionHash->name)
 			{
-				NodesDescriptionsMap::iterator it = nodesDescriptions.find(disconnected->source);
-				if (it != nodesDescriptions.end())
-					nodesDescriptions.erase(it);
+				description.crcKnown = true;
+				description.crc = descriptionHash->crc;
+				const DescriptionsCacheKey key(descriptionHash->name, descriptionHash->crc);
+				if (isNodeDescriptionComplete(description))
+					descriptionsCache[key] = description;
+				else
+					pendingCacheKeys[descriptionHash->source] = key;
+				return;
 			}
+			
+			nodesDescriptions.erase(known);
 		}
+		pendingCacheKeys.erase(descriptionHash->source);
 		
-		// if we have an initial description
+		// Call a user function when a node protocol version mismatches
+		if (descriptionHash->protocolVersion != ASEBA_PROTOCOL_VERSION)
 		{
-			const Description *description = dynamic_cast<const Description *>(message);
-			if (description)
-			{
-				NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
-				
-				// We can receive a description twice, for instance if there is another IDE connected
-				if (it != nodesDescriptions.end())
-					return;
-				
-				// Call a user function when a node protocol version mismatches
-				if (description->protocolVersion != ASEBA_PROTOCOL_VERSION)
-				{
-					nodeProtocolVersionMismatch(description->name, description->protocolVersion);
-					return;
-				}
-				
-				// create node and copy description into it
-				nodesDescriptions[description->source] = NodeDescription(*description);
-				checkIfNodeDescriptionComplete(description->source, nodesDescriptions[description->source]);
-			}
+			nodeProtocolVersionMismatch(descriptionHash->name, descriptionHash->protocolVersion);
+			return;
 		}
 		
-		// if we have a named variabledescription
+		const DescriptionsCacheKey key(descriptionHash->name, descriptionHash->crc);
+		DescriptionsCache::const_iterator it = descriptionsCache.find(key);
+		if (it != descriptionsCache.end())
 		{
-			const NamedVariableDescription *description = dynamic_cast<const NamedVariableDescription *>(message);
-			if (description)
-			{
-				NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
-				
-				// we must have received a description first
-				if (it == nodesDescriptions.end())
-					return;
-				
-				// copy description into array if array is empty
-				if (it->second.namedVariablesReceptionCounter < it->second.namedVariables.size())
-				{
-					it->second.namedVariables[it->second.namedVariablesReceptionCounter++] = *description;
-					checkIfNodeDescriptionComplete(it->first, it->second);
-				}
-			}
+			// cache hit, the description is complete right away
+			NodeDescription& description(nodesDescriptions[descriptionHash->source]);
+			description = NodeDescription(it->second);
+			description.namedVariablesReceptionCounter = description.namedVariables.size();
+			description.localEventsReceptionCounter = description.localEvents.size();
+			description.nativeFunctionReceptionCounter = description.nativeFunctions.size();
+			description.crcKnown = true;
+			description.crc = descriptionHash->crc;
+			checkIfNodeDescriptionComplete(descriptionHash->source, description);
 		}
+		else
+		{
+			// cache miss, remember the key to fill the cache once the description is received
+			pendingCacheKeys[descriptionHash->source] = key;
+			nodeDescriptionHashUnknown(descriptionHash->source);
+		}
+	}
+	
+	void DescriptionsManager::processDescription(const Description *description)
+	{
+		NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
+		
+		// We can receive a description twice, for instance if there is another IDE connected
+		if (it != nodesDescriptions.end())
+			return;
 		
-		// if we have a local event description
+		// Call a user function when a node protocol version mismatches
+		if (description->protocolVersion != ASEBA_PROTOCOL_VERSION)
 		{
-			const LocalEventDescription *description = dynamic_cast<const LocalEventDescription *>(message);
-			if (description)
-			{
-				NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
-				
-				// we must have received a description first
-				if (it == nodesDescriptions.end())
-					return;
-				
-				// copy description into array if array is empty
-				if (it->second.localEventsReceptionCounter < it->second.localEvents.size())
-				{
-					it->second.localEvents[it->second.localEventsReceptionCounter++] = *description;
-					checkIfNodeDescriptionComplete(it->first, it->second);
-				}
-			}
+			nodeProtocolVersionMismatch(description->name, description->protocolVersion);
+			return;
 		}
 		
-		// if we have a native function description
+		// create node and copy description into it
+		NodeDescription& nodeDescription(nodesDescriptions[description->source]);
+		nodeDescription = NodeDescription(*description);
+		
+		// if the node announced its hash, remember it to detect a change of firmware
+		PendingCacheKeysMap::const_iterator pending = pendingCacheKeys.find(description->source);
+		if (pending != pendingCacheKeys.end())
 		{
-			const NativeFunctionDescription *description = dynamic_cast<const NativeFunctionDescription *>(message);
-			if (description)
-			{
-				NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
-				
-				// we must have received a description first
-				if (it == nodesDescriptions.end())
-					return;
-				
-				// copy description into array
-				if (it->second.nativeFunctionReceptionCounter < it->second.nativeFunctions.size())
-				{
-					it->second.nativeFunctions[it->second.nativeFunctionReceptionCounter++] = *description;
-					checkIfNodeDescriptionComplete(it->first, it->second);
-				}
-			}
+			nodeDescription.crcKnown = true;
+			nodeDescription.crc = pending->second.second;
+		}
+		checkIfNodeDescriptionComplete(description->source, nodesDescriptions[description->source]);
+	}
+	
+	void DescriptionsManager::processNamedVariableDescription(const NamedVariableDescription *description)
+	{
+		NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
+		
+		// we must have received a description first
+		if (it == nodesDescriptions.end())
+			return;
+		
+		// copy description into array if array is empty
+		if (it->second.namedVariablesReceptionCounter < it->second.namedVariables.size())
+		{
+			it->second.namedVariables[it->second.namedVariablesReceptionCounter++] = *description;
+			checkIfNodeDescriptionComplete(it->first, it->second);
+		}
+	}
+	
+	void DescriptionsManager::processLocalEventDescription(const LocalEventDescription *description)
+	{
+		NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
+		
+		// we must have received a description first
+		if (it == nodesDescriptions.end())
+			return;
+		
+		// copy description into array if array is empty
+		if (it->second.localEventsReceptionCounter < it->second.localEvents.size())
+		{
+			it->second.localEvents[it->second.localEventsReceptionCounter++] = *description;
+			checkIfNodeDescriptionComplete(it->first, it->second);
+		}
+	}
+	
+	void DescriptionsManager::processNativeFunctionDescription(const NativeFunctionDescription *description)
+	{
+		NodesDescriptionsMap::iterator it = nodesDescriptions.find(description->source);
+		
+		// we must have received a description first
+		if (it == nodesDescriptions.end())
+			return;
+		
+		// copy description into array
+		if (it->second.nativeFunctionReceptionCounter < it->second.nativeFunctions.size())
+		{
+			it->second.nativeFunctions[it->second.nativeFunctionReceptionCounter++] = *description;
+			checkIfNodeDescriptionComplete(it->first, it->second);
 		}
 	}
 
+	bool DescriptionsManager::isNodeDescriptionComplete(const NodeDescription& description)
+	{
+		return (description.namedVariablesReceptionCounter == description.namedVariables.size()) &&
+			(description.localEventsReceptionCounter == description.localEvents.size()) &&
+			(description.nativeFunctionReceptionCounter == description.nativeFunctions.size());
+	}
+	
 	void DescriptionsManager::checkIfNodeDescriptionComplete(unsigned id, const NodeDescription& description)
 	{
 		// we will call the virtual function only when we have received all local events and native functions
-		if ((description.namedVariablesReceptionCounter == description.namedVariables.size()) &&
-			(description.localEventsReceptionCounter == description.localEvents.size()) &&
-			(description.nativeFunctionReceptionCounter == description.nativeFunctions.size())
-		)
+		if (isNodeDescriptionComplete(description))
 		{
+			// if the node announced its hash, keep its description for next time
+			PendingCacheKeysMap::iterator it = pendingCacheKeys.find(id);
+			if (it != pendingCacheKeys.end())
+			{
+				descriptionsCache[it->second] = description;
+				pendingCacheKeys.erase(it);
+			}
+			
 			nodeDescriptionReceived(id);
 		}
 	}
@@ -265,5 +361,150 @@ namespace Aseba
 	void DescriptionsManager::reset()
 	{
 		nodesDescriptions.clear();
+		pendingCacheKeys.clear();
+	}
+	
+	// The cache file is a sequence of little-endian 16-bit words and of strings,
+	// each string being stored as its UTF-8 length in a word followed by its bytes
+	
+	static const uint16 descriptionsCacheFileVersion = 0;
+	
+	static void writeCacheUint16(ofstream& file, const uint16 v)
+	{
+		const uint8 data[2] = { uint8(v & 0xff), uint8(v >> 8) };
+		file.write(reinterpret_cast<const char*>(data), 2);
+	}
+	
+	static void writeCacheString(ofstream& file, const wstring& s)
+	{
+		const string utf8(WStringToUTF8(s));
+		writeCacheUint16(file, uint16(utf8.size()));
+		file.write(utf8.c_str(), utf8.size());
+	}
+	
+	static uint16 readCacheUint16(ifstream& file)
+	{
+		uint8 data[2] = { 0, 0 };
+		file.read(reinterpret_cast<char*>(data), 2);
+		return uint16(data[0]) | (uint16(data[1]) << 8);
+	}
+	
+	static wstring readCacheString(ifstream& file)
+	{
+		const uint16 size(readCacheUint16(file));
+		string utf8(size, '\0');
+		if (size)
+			file.read(&utf8[0], size);
+		return UTF8ToWString(utf8);
+	}
+	
+	bool DescriptionsManager::loadDescriptionsCache(const std::string& fileName)
+	{
+		ifstream file(fileName.c_str(), ios::in | ios::binary);
+		if (!file.good())
+			return false;
+		
+		if (readCacheUint16(file) != descriptionsCacheFileVersion)
+			return false;
+		if (readCacheUint16(file) != ASEBA_PROTOCOL_VERSION)
+			return false;
+		
+		// read into a temporary cache so that a truncated file leaves the current one untouched
+		DescriptionsCache cache;
+		const uint16 count(readCacheUint16(file));
+		for (unsigned i = 0; i < count && file.good(); ++i)
+		{
+			TargetDescription description;
+			const uint16 crc(readCacheUint16(file));
+			description.name = readCacheString(file);
+			description.protocolVersion = ASEBA_PROTOCOL_VERSION;
+			description.bytecodeSize = readCacheUint16(file);
+			description.variablesSize = readCacheUint16(file);
+			description.stackSize = readCacheUint16(file);
+			
+			description.namedVariables.resize(readCacheUint16(file));
+			for (size_t j = 0; j < description.namedVariables.size(); ++j)
+			{
+				description.namedVariables[j].size = readCacheUint16(file);
+				description.namedVariables[j].name = readCacheString(file);
+			}
+			
+			description.localEvents.resize(readCacheUint16(file));
+			for (size_t j = 0; j < description.localEvents.size(); ++j)
+			{
+				description.localEvents[j].name = readCacheString(file);
+				description.localEvents[j].description = readCacheString(file);
+			}
+			
+			description.nativeFunctions.resize(readCacheUint16(file));
+			for (size_t j = 0; j < description.nativeFunctions.size(); ++j)
+			{
+				TargetDescription::NativeFunction& nativeFunction(description.nativeFunctions[j]);
+				nativeFunction.name = readCacheString(file);
+				nativeFunction.description = readCacheString(file);
+				nativeFunction.parameters.resize(readCacheUint16(file));
+				for (size_t k = 0; k < nativeFunction.parameters.size(); ++k)
+				{
+					nativeFunction.parameters[k].size = sint16(readCacheUint16(file));
+					nativeFunction.parameters[k].name = readCacheString(file);
+				}
+			}
+			
+			cache[DescriptionsCacheKey(description.name, crc)] = description;
+		}
+		if (!file.good())
+			return false;
+		
+		descriptionsCache.insert(cache.begin(), cache.end());
+		return true;
+	}
+	
+	bool DescriptionsManager::saveDescriptionsCache(const std::string& fileName) const
+	{
+		ofstream file(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+		if (!file.good())
+			return false;
+		
+		writeCacheUint16(file, descriptionsCacheFileVersion);
+		writeCacheUint16(file, ASEBA_PROTOCOL_VERSION);
+		writeCacheUint16(file, uint16(descriptionsCache.size()));
+		for (DescriptionsCache::const_iterator it = descriptionsCache.begin(); it != descriptionsCache.end(); ++it)
+		{
+			const TargetDescription& description(it->second);
+			writeCacheUint16(file, it->first.second);
+			writeCacheString(file, description.name);
+			writeCacheUint16(file, description.bytecodeSize);
+			writeCacheUint16(file, description.variablesSize);
+			writeCacheUint16(file, description.stackSize);
+			
+			writeCacheUint16(file, uint16(description.namedVariables.size()));
+			for (size_t j = 0; j < description.namedVariables.size(); ++j)
+			{
+				writeCacheUint16(file, description.namedVariables[j].size);
+				writeCacheString(file, description.namedVariables[j].name);
+			}
+			
+			writeCacheUint16(file, uint16(description.localEvents.size()));
+			for (size_t j = 0; j < description.localEvents.size(); ++j)
+			{
+				writeCacheString(file, description.localEvents[j].name);
+				writeCacheString(file, description.localEvents[j].description);
+			}
+			
+			writeCacheUint16(file, uint16(description.nativeFunctions.size()));
+			for (size_t j = 0; j < description.nativeFunctions.size(); ++j)
+			{
+				const TargetDescription::NativeFunction& nativeFunction(description.nativeFunctions[j]);
+				writeCacheString(file, nativeFunction.name);
+				writeCacheString(file, nativeFunction.description);
+				writeCacheUint16(file, uint16(nativeFunction.parameters.size()));
+				for (size_t k = 0; k < nativeFunction.parameters.size(); ++k)
+				{
+					writeCacheUint16(file, uint16(sint16(nativeFunction.parameters[k].size)));
+					writeCacheString(file, nativeFunction.parameters[k].name);
+				}
+			}
+		}
+		return file.good();
 	}
 } // namespace Aseba
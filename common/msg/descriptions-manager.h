@@ -43,11 +43,22 @@ namespace Aseba
 			unsigned namedVariablesReceptionCounter; //!< what is the status of the reception of named variables
 			unsigned localEventsReceptionCounter; //!< what is the status of the reception of local events
 			unsigned nativeFunctionReceptionCounter; //!< what is the status of the reception of native functions
+			bool crcKnown; //!< whether the node announced the CRC of this description
+			uint16 crc; //!< CRC announced by the node, if crcKnown is true
 		};
 		//! Map from nodes id to nodes descriptions
 		typedef std::map<unsigned, NodeDescription> NodesDescriptionsMap;
 		NodesDescriptionsMap nodesDescriptions; //!< all known nodes descriptions
 		
+		//! Key of a description in the cache: the node name and the CRC of its description
+		typedef std::pair<std::wstring, uint16> DescriptionsCacheKey;
+		//! Map from name and CRC to complete descriptions, to avoid receiving the same description again
+		typedef std::map<DescriptionsCacheKey, TargetDescription> DescriptionsCache;
+		DescriptionsCache descriptionsCache; //!< complete descriptions already received, by name and CRC
+		//! Map from nodes id to the cache key they announced but which we did not know yet
+		typedef std::map<unsigned, DescriptionsCacheKey> PendingCacheKeysMap;
+		PendingCacheKeysMap pendingCacheKeys; //!< nodes whose description must be put in cache once received
+		
 	public:
 		//! Virtual destructor
 		virtual ~DescriptionsManager() {}
@@ -65,13 +76,33 @@ namespace Aseba
 		unsigned getVariablePos(unsigned nodeId, const std::wstring& name, bool *ok = 0) const;
 		//! Return the length of a variable and set ok to true, if provided; if invalid, return 0xFFFFFFFF and set ok to false
 		unsigned getVariableSize(unsigned nodeId, const std::wstring& name, bool *ok = 0) const;
-		//! Reset all descriptions, for instance when a network was disconnected and is reconnected
+		//! Reset all descriptions, for instance when a network was disconnected and is reconnected; the cache of descriptions is kept
 		void reset();
 		
+		//! Load the cache of descriptions from fileName, return false if the file cannot be read or is invalid
+		bool loadDescriptionsCache(const std::string& fileName);
+		//! Save the cache of descriptions to fileName, return false if the file cannot be written
+		bool saveDescriptionsCache(const std::string& fileName) const;
+		
 		// TODO: reverse lookup?
 		// TODO: move bytecode sender manager here, rename class?
 		
 	protected:
+		//! Remove the description of a disconnected node
+		void processDisconnected(const Disconnected *disconnected);
+		//! Use the cached description of a node if its hash is known, learn the hash of a description received without it, drop a known description whose hash changed
+		void processDescriptionHash(const DescriptionHash *descriptionHash);
+		//! Start the reception of the description of a node
+		void processDescription(const Description *description);
+		//! Add a named variable to the description of a node
+		void processNamedVariableDescription(const NamedVariableDescription *description);
+		//! Add a local event to the description of a node
+		void processLocalEventDescription(const LocalEventDescription *description);
+		//! Add a native function to the description of a node
+		void processNativeFunctionDescription(const NativeFunctionDescription *description);
+		
+		//! Return whether all the parts of description have been received
+		static bool isNodeDescriptionComplete(const NodeDescription& description);
 		//! Check if a node description has been fully received, and if so, call the nodeDescriptionReceived() virtual function
 		void checkIfNodeDescriptionComplete(unsigned id, const NodeDescription& description);
 		
@@ -80,6 +111,9 @@ namespace Aseba
 		
 		//! Virtual function that is called when a node description has been fully received
 		virtual void nodeDescriptionReceived(unsigned nodeId) { }
+		
+		//! Virtual function that is called when the description hash of a node is not in cache, typically to send GetNodeDescription to this node
+		virtual void nodeDescriptionHashUnknown(unsigned nodeId) { }
 	};
 	
 	/*@}*/
@@ -21,6 +21,8 @@
 #ifndef ASEBA_ENDIAN
 #define ASEBA_ENDIAN
 
+#include <algorithm>
+
 namespace Aseba
 {
 	/** \addtogroup msg */
@@ -105,6 +107,15 @@ namespace Aseba
 	T swapEndianCopy(const T& v) { return ByteSwapper::swap<T>(v); }
 	template<typename T>
 	void swapEndian(T& v) { ByteSwapper::swap<T>(v); }
+	//! Swap count elements of type T stored at data, which might not be aligned
+	template<typename T>
+	void swapEndianArray(void* data, size_t count)
+	{
+		uint8* ptr(reinterpret_cast<uint8*>(data));
+		for (size_t i = 0; i < count; ++i, ptr += sizeof(T))
+			for (size_t j = 0; j < sizeof(T) / 2; ++j)
+				std::swap(ptr[j], ptr[sizeof(T)-1-j]);
+	}
 	
 	#else
 	
@@ -112,6 +123,8 @@ namespace Aseba
 	T swapEndianCopy(const T& v) { return v; }
 	template<typename T>
 	void swapEndian(T& v) { /* do nothing */ }
+	template<typename T>
+	void swapEndianArray(void* data, size_t count) { /* do nothing */ }
 	
 	#endif
 	
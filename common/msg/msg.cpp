@@ -25,6 +25,7 @@
 #include <iostream>
 #include <iomanip>
 #include <map>
+#include <cstring>
 #include <dashel/dashel.h>
 
 using namespace std;
@@ -43,6 +44,7 @@ namespace Aseba
 			registerMessageType<BootloaderDescription>(ASEBA_MESSAGE_BOOTLOADER_DESCRIPTION);
 			registerMessageType<BootloaderDataRead>(ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_READ);
 			registerMessageType<BootloaderAck>(ASEBA_MESSAGE_BOOTLOADER_ACK);
+			registerMessageType<BootloaderPagesHash>(ASEBA_MESSAGE_BOOTLOADER_PAGES_HASH);
 			
 			registerMessageType<Description>(ASEBA_MESSAGE_DESCRIPTION);
 			registerMessageType<NamedVariableDescription>(ASEBA_MESSAGE_NAMED_VARIABLE_DESCRIPTION);
@@ -56,13 +58,20 @@ namespace Aseba
 			registerMessageType<NodeSpecificError>(ASEBA_MESSAGE_NODE_SPECIFIC_ERROR);
 			registerMessageType<ExecutionStateChanged>(ASEBA_MESSAGE_EXECUTION_STATE_CHANGED);
 			registerMessageType<BreakpointSetResult>(ASEBA_MESSAGE_BREAKPOINT_SET_RESULT);
+			registerMessageType<DescriptionHash>(ASEBA_MESSAGE_DESCRIPTION_HASH);
+			registerMessageType<VariablesSnapshotChunk>(ASEBA_MESSAGE_VARIABLES_SNAPSHOT_CHUNK);
+			registerMessageType<VariablesSnapshotEnd>(ASEBA_MESSAGE_VARIABLES_SNAPSHOT_END);
+			registerMessageType<Profile>(ASEBA_MESSAGE_PROFILE);
 			
 			registerMessageType<GetDescription>(ASEBA_MESSAGE_GET_DESCRIPTION);
+			registerMessageType<GetDescriptionHash>(ASEBA_MESSAGE_GET_DESCRIPTION_HASH);
 			
 			registerMessageType<BootloaderReset>(ASEBA_MESSAGE_BOOTLOADER_RESET);
 			registerMessageType<BootloaderReadPage>(ASEBA_MESSAGE_BOOTLOADER_READ_PAGE);
 			registerMessageType<BootloaderWritePage>(ASEBA_MESSAGE_BOOTLOADER_WRITE_PAGE);
 			registerMessageType<BootloaderPageDataWrite>(ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE);
+			registerMessageType<BootloaderPageDataWriteChunk>(ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK);
+			registerMessageType<BootloaderGetPagesHash>(ASEBA_MESSAGE_BOOTLOADER_GET_PAGES_HASH);
 			
 			//registerMessageType<AttachDebugger>(ASEBA_MESSAGE_ATTACH_DEBUGGER);
 			//registerMessageType<DetachDebugger>(ASEBA_MESSAGE_DETACH_DEBUGGER);
@@ -81,6 +90,10 @@ namespace Aseba
 			registerMessageType<WriteBytecode>(ASEBA_MESSAGE_WRITE_BYTECODE);
 			registerMessageType<Reboot>(ASEBA_MESSAGE_REBOOT);
 			registerMessageType<Sleep>(ASEBA_MESSAGE_SUSPEND_TO_RAM);
+			registerMessageType<GetNodeDescription>(ASEBA_MESSAGE_GET_NODE_DESCRIPTION);
+			registerMessageType<GetVariablesSnapshot>(ASEBA_MESSAGE_GET_VARIABLES_SNAPSHOT);
+			registerMessageType<GetProfile>(ASEBA_MESSAGE_GET_PROFILE);
+			registerMessageType<ResetProfile>(ASEBA_MESSAGE_RESET_PROFILE);
 		}
 		
 		//! Register a message type by storing a pointer to its constructor
@@ -137,7 +150,29 @@ namespace Aseba
 	
 	void Message::serialize(Stream* stream)
 	{
+		uint16 header[3];
+		serializePayload(header);
+		stream->write(header, sizeof(header));
+		if(rawData.size())
+			stream->write(&rawData[0], rawData.size());
+	}
+	
+	//! Append the message as it would be written to a stream, header included, to data
+	void Message::serialize(std::vector<uint8>& data)
+	{
+		uint16 header[3];
+		serializePayload(header);
+		const uint8* headerBytes(reinterpret_cast<const uint8*>(header));
+		data.insert(data.end(), headerBytes, headerBytes + sizeof(header));
+		data.insert(data.end(), rawData.begin(), rawData.end());
+	}
+	
+	//! Serialize the payload into rawData and fill the header, ready to be written
+	void Message::serializePayload(uint16 header[3])
+	{
+		// payload is bounded, so a single reservation avoids any reallocation while serializing
 		rawData.resize(0);
+		rawData.reserve(ASEBA_MAX_EVENT_ARG_SIZE);
 		serializeSpecific();
 		uint16 len = static_cast<uint16>(rawData.size());
 		
@@ -148,51 +183,60 @@ namespace Aseba
 			cerr << endl;
 			abort();
 		}
-		uint16 t;
-		swapEndian(len);
-		stream->write(&len, 2);
-		t = swapEndianCopy(source);
-		stream->write(&t, 2);
-		t = swapEndianCopy(type);
-		stream->write(&t, 2);
-		if(rawData.size())
-			stream->write(&rawData[0], rawData.size());
+		header[0] = swapEndianCopy(len);
+		header[1] = swapEndianCopy(source);
+		header[2] = swapEndianCopy(type);
 	}
 	
 	Message *Message::receive(Stream* stream)
 	{
 		// read header
 		uint16 len, source, type;
-		stream->read(&len, 2);
-		swapEndian(len);
-		stream->read(&source, 2);
-		swapEndian(source);
-		stream->read(&type, 2);
-		swapEndian(type);
+		receiveHeader(stream, len, source, type);
 		
 		// create message
 		Message *message = messageTypesInitializer.createMessage(type);
 		
+		// read and deserialize it
+		message->receivePayload(stream, len, source, type);
+		
+		return message;
+	}
+	
+	void Message::receiveHeader(Stream* stream, uint16& len, uint16& source, uint16& type)
+	{
+		uint16 header[3];
+		stream->read(header, sizeof(header));
+		swapEndianArray<uint16>(header, 3);
+		len = header[0];
+		source = header[1];
+		type = header[2];
+	}
+	
+	void Message::receivePayload(Stream* stream, uint16 len, uint16 source, uint16 type)
+	{
 		// preapare message
-		message->source = source;
-		message->type = type;
-		message->rawData.resize(len);
+		this->source = source;
+		this->type = type;
+		rawData.resize(len);
 		if (len)
-			stream->read(&message->rawData[0], len);
-		message->readPos = 0;
+			stream->read(&rawData[0], len);
 		
-		// deserialize it
-		message->deserializeSpecific();
+		deserializeRawData();
+	}
+	
+	void Message::deserializeRawData()
+	{
+		readPos = 0;
+		deserializeSpecific();
 		
-		if (message->readPos != message->rawData.size())
+		if (readPos != rawData.size())
 		{
 			cerr << "Message::receive() : fatal error: message not fully read.\n";
-			cerr << "type: " << type << ", readPos: " << message->readPos << ", rawData size: " << message->rawData.size() << endl;
-			message->dumpBuffer(wcerr);
+			cerr << "type: " << type << ", readPos: " << readPos << ", rawData size: " << rawData.size() << endl;
+			dumpBuffer(wcerr);
 			abort();
 		}
-		
-		return message;
 	}
 	
 	void Message::dump(wostream &stream) const
@@ -210,16 +254,77 @@ namespace Aseba
 		stream << endl;
 	}
 	
+	//
+	
+	MessagePool::~MessagePool()
+	{
+		for (MessagesMap::iterator it = messages.begin(); it != messages.end(); ++it)
+			delete it->second;
+	}
+	
+	Message *MessagePool::receive(Stream* stream)
+	{
+		// read header
+		uint16 len, source, type;
+		Message::receiveHeader(stream, len, source, type);
+		
+		// read and deserialize it
+		Message *message(getMessage(type));
+		message->receivePayload(stream, len, source, type);
+		
+		return message;
+	}
+	
+	Message *MessagePool::deserialize(uint16 source, uint16 type, const uint8* payload, uint16 len)
+	{
+		Message *message(getMessage(type));
+		message->source = source;
+		message->type = type;
+		message->rawData.assign(payload, payload + len);
+		message->deserializeRawData();
+		
+		return message;
+	}
+	
+	Message *MessagePool::getMessage(uint16 type)
+	{
+		// find the instance for this type, user messages all share the same one
+		const uint16 key(type < 0x8000 ? uint16(ASEBA_MESSAGE_INVALID) : type);
+		MessagesMap::iterator it(messages.find(key));
+		if (it == messages.end())
+		{
+			Message *message(messageTypesInitializer.createMessage(type));
+			// the buffer will be kept across receptions, allocate it once with the maximum size
+			message->rawData.reserve(ASEBA_MAX_EVENT_ARG_SIZE);
+			it = messages.insert(MessagesMap::value_type(key, message)).first;
+		}
+		return it->second;
+	}
+	
+	//
+	
 	template<typename T>
 	void Message::add(const T& val)
 	{
 		size_t pos = rawData.size();
-		rawData.reserve(pos + sizeof(T));
+		rawData.resize(pos + sizeof(T));
 		
 		const T swappedVal(swapEndianCopy(val));
-		const uint8 *ptr = reinterpret_cast<const uint8 *>(&swappedVal);
-
-		copy(ptr, ptr + sizeof(T), back_inserter(rawData));
+		memcpy(&rawData[pos], &swappedVal, sizeof(T));
+	}
+	
+	template<typename T>
+	void Message::addArray(const T* vals, size_t count)
+	{
+		if (count == 0)
+			return;
+		
+		size_t pos = rawData.size();
+		rawData.resize(pos + count * sizeof(T));
+		
+		// copy all words at once, then swap them in place if the host is not little-endian
+		memcpy(&rawData[pos], vals, count * sizeof(T));
+		swapEndianArray<T>(&rawData[pos], count);
 	}
 	
 	template<>
@@ -235,8 +340,7 @@ namespace Aseba
 		}
 		
 		add(static_cast<uint8>(val.length()));
-		for (size_t i = 0; i < val.length(); i++)
-			add(val[i]);
+		addArray(val.data(), val.length());
 	}
 	
 	template<typename T>
@@ -254,20 +358,39 @@ namespace Aseba
 		size_t pos = readPos;
 		readPos += sizeof(T);
 		T val;
-		uint8 *ptr = reinterpret_cast<uint8 *>(&val);
-		copy(rawData.begin() + pos, rawData.begin() + pos + sizeof(T), ptr);
+		memcpy(&val, &rawData[pos], sizeof(T));
 		swapEndian(val);
 		return val;
 	}
 	
+	template<typename T>
+	void Message::getArray(T* vals, size_t count)
+	{
+		if (readPos + count * sizeof(T) > rawData.size())
+		{
+			cerr << "Message<" << typeid(T).name() << ">::getArray() : fatal error: attempt to overread.\n";
+			cerr << "type: " << type << ", readPos: " << readPos << ", rawData size: " << rawData.size() << ", element size: " << sizeof(T) << ", element count: " << count;
+			cerr << endl;
+			dumpBuffer(wcerr);
+			abort();
+		}
+		if (count == 0)
+			return;
+		
+		// decode directly from the payload, with one bound check for the whole array
+		memcpy(vals, &rawData[readPos], count * sizeof(T));
+		swapEndianArray<T>(vals, count);
+		readPos += count * sizeof(T);
+	}
+	
 	template<>
 	string Message::get()
 	{
 		string s;
 		size_t len = get<uint8>();
 		s.resize(len);
-		for (size_t i = 0; i < len; i++)
-			s[i] = get<uint8>();
+		if (len)
+			getArray(&s[0], len);
 		return s;
 	}
 	
@@ -282,8 +405,8 @@ namespace Aseba
 	
 	void UserMessage::serializeSpecific()
 	{
-		for (size_t i = 0; i < data.size(); i++)
-			add(data[i]);
+		if (!data.empty())
+			addArray(&data[0], data.size());
 	}
 	
 	void UserMessage::deserializeSpecific()
@@ -297,8 +420,8 @@ namespace Aseba
 		}
 		data.resize(rawData.size() / 2);
 		
-		for (size_t i = 0; i < data.size(); i++)
-			data[i] = get<sint16>();
+		if (!data.empty())
+			getArray(&data[0], data.size());
 	}
 	
 	void UserMessage::dumpSpecific(wostream &stream) const
@@ -316,6 +439,13 @@ namespace Aseba
 		add(pageSize);
 		add(pagesStart);
 		add(pagesCount);
+		// bootloaders supporting only the original protocol send the short form
+		if (dataChunkSize || flags)
+		{
+			add(dataChunkSize);
+			add(pagesInFlight);
+			add(flags);
+		}
 	}
 	
 	void BootloaderDescription::deserializeSpecific()
@@ -323,11 +453,29 @@ namespace Aseba
 		pageSize = get<uint16>();
 		pagesStart = get<uint16>();
 		pagesCount = get<uint16>();
+		if (readPos + 4 <= rawData.size())
+		{
+			dataChunkSize = get<uint16>();
+			pagesInFlight = get<uint16>();
+		}
+		else
+		{
+			dataChunkSize = 0;
+			pagesInFlight = 0;
+		}
+		if (readPos + 2 <= rawData.size())
+			flags = get<uint16>();
+		else
+			flags = 0;
 	}
 	
 	void BootloaderDescription::dumpSpecific(wostream &stream) const
 	{
 		stream << pagesCount << " pages of size " << pageSize << " starting at page " << pagesStart;
+		if (dataChunkSize)
+			stream << ", chunks of " << dataChunkSize << " bytes, " << pagesInFlight << " pages in flight";
+		if (flags & CAN_HASH_PAGES)
+			stream << ", can hash pages";
 	}
 	
 	
@@ -335,14 +483,12 @@ namespace Aseba
 	
 	void BootloaderDataRead::serializeSpecific()
 	{
-		for (size_t i = 0 ; i < sizeof(data); i++)
-			add(data[i]);
+		addArray(data, sizeof(data));
 	}
 	
 	void BootloaderDataRead::deserializeSpecific()
 	{
-		for (size_t i = 0 ; i < sizeof(data); i++)
-			data[i] = get<uint8>();
+		getArray(data, sizeof(data));
 	}
 	
 	void BootloaderDataRead::dumpSpecific(wostream &stream) const
@@ -355,6 +501,39 @@ namespace Aseba
 	
 	//
 	
+	void BootloaderPagesHash::serializeSpecific()
+	{
+		add(firstPage);
+		// hashes are sent as pairs of words, low word first
+		for (size_t i = 0; i < hashes.size(); ++i)
+		{
+			add(uint16(hashes[i] & 0xffff));
+			add(uint16((hashes[i] >> 16) & 0xffff));
+		}
+	}
+	
+	void BootloaderPagesHash::deserializeSpecific()
+	{
+		firstPage = get<uint16>();
+		hashes.resize((rawData.size() - readPos) / 4);
+		for (size_t i = 0; i < hashes.size(); ++i)
+		{
+			const uint32 low(get<uint16>());
+			const uint32 high(get<uint16>());
+			hashes[i] = low | (high << 16);
+		}
+	}
+	
+	void BootloaderPagesHash::dumpSpecific(wostream &stream) const
+	{
+		stream << hashes.size() << " pages starting at page " << firstPage << ":" << hex << setfill(wchar_t('0'));
+		for (size_t i = 0; i < hashes.size(); ++i)
+			stream << " " << setw(8) << hashes[i];
+		stream << dec << setfill(wchar_t(' '));
+	}
+	
+	//
+	
 	void BootloaderAck::serializeSpecific()
 	{
 		add(errorCode);
@@ -401,6 +580,46 @@ namespace Aseba
 	
 	//
 	
+	void GetDescriptionHash::serializeSpecific()
+	{
+		add(version);
+	}
+	
+	void GetDescriptionHash::deserializeSpecific()
+	{
+		version = get<uint16>();
+	}
+	
+	void GetDescriptionHash::dumpSpecific(std::wostream  &stream) const
+	{
+		stream << "protocol version " << version;
+	}
+	
+	//
+	
+	void DescriptionHash::serializeSpecific()
+	{
+		add(WStringToUTF8(name));
+		add(protocolVersion);
+		add(crc);
+	}
+	
+	void DescriptionHash::deserializeSpecific()
+	{
+		name = UTF8ToWString(get<string>());
+		protocolVersion = get<uint16>();
+		crc = get<uint16>();
+	}
+	
+	void DescriptionHash::dumpSpecific(wostream &stream) const
+	{
+		stream << "Node " << name << " using protocol version " << protocolVersion << ", description crc ";
+		stream << hex << showbase << setw(4) << crc;
+		stream << dec << noshowbase;
+	}
+	
+	//
+	
 	void Description::serializeSpecific()
 	{
 		add(WStringToUTF8(name));
@@ -538,16 +757,16 @@ namespace Aseba
 	void Variables::serializeSpecific()
 	{
 		add(start);
-		for (size_t i = 0; i < variables.size(); i++)
-			add(variables[i]);
+		if (!variables.empty())
+			addArray(&variables[0], variables.size());
 	}
 	
 	void Variables::deserializeSpecific()
 	{
 		start = get<uint16>();
 		variables.resize((rawData.size() - readPos) / 2);
-		for (size_t i = 0; i < variables.size(); i++)
-			variables[i] = get<sint16>();
+		if (!variables.empty())
+			getArray(&variables[0], variables.size());
 	}
 	
 	void Variables::dumpSpecific(wostream &stream) const
@@ -560,6 +779,91 @@ namespace Aseba
 	
 	//
 	
+	void VariablesSnapshotChunk::serializeSpecific()
+	{
+		add(sequence);
+		add(start);
+		if (!variables.empty())
+			addArray(&variables[0], variables.size());
+	}
+	
+	void VariablesSnapshotChunk::deserializeSpecific()
+	{
+		sequence = get<uint16>();
+		start = get<uint16>();
+		variables.resize((rawData.size() - readPos) / 2);
+		if (!variables.empty())
+			getArray(&variables[0], variables.size());
+	}
+	
+	void VariablesSnapshotChunk::dumpSpecific(wostream &stream) const
+	{
+		stream << "chunk " << sequence << ", start " << start << ", variables vector of size " << variables.size();
+	}
+	
+	//
+	
+	void VariablesSnapshotEnd::serializeSpecific()
+	{
+		add(start);
+		add(length);
+		add(chunksCount);
+	}
+	
+	void VariablesSnapshotEnd::deserializeSpecific()
+	{
+		start = get<uint16>();
+		length = get<uint16>();
+		chunksCount = get<uint16>();
+	}
+	
+	void VariablesSnapshotEnd::dumpSpecific(wostream &stream) const
+	{
+		stream << "start " << start << ", length " << length << ", in " << chunksCount << " chunks";
+	}
+	
+	//
+	
+	void Profile::serializeSpecific()
+	{
+		add(entriesCount);
+		add(index);
+		add(address);
+		// counters are sent as pairs of words, low word first
+		add(uint16(instructionsCount & 0xffff));
+		add(uint16((instructionsCount >> 16) & 0xffff));
+		add(uint16(nativeCallsCount & 0xffff));
+		add(uint16((nativeCallsCount >> 16) & 0xffff));
+		add(uint16(nativeTime & 0xffff));
+		add(uint16((nativeTime >> 16) & 0xffff));
+	}
+	
+	void Profile::deserializeSpecific()
+	{
+		entriesCount = get<uint16>();
+		index = get<uint16>();
+		address = get<uint16>();
+		const uint32 instructionsLow(get<uint16>());
+		instructionsCount = instructionsLow | (uint32(get<uint16>()) << 16);
+		const uint32 nativeCallsLow(get<uint16>());
+		nativeCallsCount = nativeCallsLow | (uint32(get<uint16>()) << 16);
+		const uint32 nativeTimeLow(get<uint16>());
+		nativeTime = nativeTimeLow | (uint32(get<uint16>()) << 16);
+	}
+	
+	void Profile::dumpSpecific(wostream &stream) const
+	{
+		if (entriesCount == 0)
+		{
+			stream << "empty";
+			return;
+		}
+		stream << "entry " << index << " of " << entriesCount << ", address " << address << ": ";
+		stream << instructionsCount << " instructions, " << nativeCallsCount << " native calls, native time " << nativeTime;
+	}
+	
+	//
+	
 	void ArrayAccessOutOfBounds::serializeSpecific()
 	{
 		add(pc);
@@ -741,16 +1045,14 @@ namespace Aseba
 	{
 		CmdMessage::serializeSpecific();
 		
-		for (size_t i = 0 ; i < sizeof(data); i++)
-			add(data[i]);
+		addArray(data, sizeof(data));
 	}
 	
 	void BootloaderPageDataWrite::deserializeSpecific()
 	{
 		CmdMessage::deserializeSpecific();
 		
-		for (size_t i = 0 ; i < sizeof(data); i++)
-			data[i] = get<uint8>();
+		getArray(data, sizeof(data));
 	}
 	
 	void BootloaderPageDataWrite::dumpSpecific(wostream &stream) const
@@ -765,13 +1067,67 @@ namespace Aseba
 	
 	//
 	
+	void BootloaderPageDataWriteChunk::serializeSpecific()
+	{
+		CmdMessage::serializeSpecific();
+		
+		add(pageNumber);
+		add(offset);
+		addArray(data.empty() ? 0 : &data[0], data.size());
+	}
+	
+	void BootloaderPageDataWriteChunk::deserializeSpecific()
+	{
+		CmdMessage::deserializeSpecific();
+		
+		pageNumber = get<uint16>();
+		offset = get<uint16>();
+		data.resize(rawData.size() - readPos);
+		if (!data.empty())
+			getArray(&data[0], data.size());
+	}
+	
+	void BootloaderPageDataWriteChunk::dumpSpecific(wostream &stream) const
+	{
+		CmdMessage::dumpSpecific(stream);
+		
+		stream << "page " << pageNumber << " offset " << offset << ", " << data.size() << " bytes";
+	}
+	
+	//
+	
+	void BootloaderGetPagesHash::serializeSpecific()
+	{
+		CmdMessage::serializeSpecific();
+		
+		add(firstPage);
+		add(pagesCount);
+	}
+	
+	void BootloaderGetPagesHash::deserializeSpecific()
+	{
+		CmdMessage::deserializeSpecific();
+		
+		firstPage = get<uint16>();
+		pagesCount = get<uint16>();
+	}
+	
+	void BootloaderGetPagesHash::dumpSpecific(wostream &stream) const
+	{
+		CmdMessage::dumpSpecific(stream);
+		
+		stream << pagesCount << " pages starting at page " << firstPage;
+	}
+	
+	//
+	
 	void SetBytecode::serializeSpecific()
 	{
 		CmdMessage::serializeSpecific();
 		
 		add(start);
-		for (size_t i = 0; i < bytecode.size(); i++)
-			add(bytecode[i]);
+		if (!bytecode.empty())
+			addArray(&bytecode[0], bytecode.size());
 	}
 	
 	void SetBytecode::deserializeSpecific()
@@ -780,8 +1136,8 @@ namespace Aseba
 		
 		start = get<uint16>();
 		bytecode.resize((rawData.size() - readPos) / 2);
-		for (size_t i = 0; i < bytecode.size(); i++)
-			bytecode[i] = get<uint16>();
+		if (!bytecode.empty())
+			getArray(&bytecode[0], bytecode.size());
 	}
 	
 	void SetBytecode::dumpSpecific(wostream &stream) const
@@ -843,6 +1199,29 @@ namespace Aseba
 	
 	//
 	
+	void GetNodeDescription::serializeSpecific()
+	{
+		CmdMessage::serializeSpecific();
+		
+		add(version);
+	}
+	
+	void GetNodeDescription::deserializeSpecific()
+	{
+		CmdMessage::deserializeSpecific();
+		
+		version = get<uint16>();
+	}
+	
+	void GetNodeDescription::dumpSpecific(wostream &stream) const
+	{
+		CmdMessage::dumpSpecific(stream);
+		
+		stream << "protocol version " << version;
+	}
+	
+	//
+	
 	void BreakpointSet::serializeSpecific()
 	{
 		CmdMessage::serializeSpecific();
@@ -921,6 +1300,38 @@ namespace Aseba
 	
 	//
 	
+	GetVariablesSnapshot::GetVariablesSnapshot(uint16 dest, uint16 start, uint16 length) :
+		CmdMessage(ASEBA_MESSAGE_GET_VARIABLES_SNAPSHOT, dest),
+		start(start),
+		length(length)
+	{
+	}
+	
+	void GetVariablesSnapshot::serializeSpecific()
+	{
+		CmdMessage::serializeSpecific();
+		
+		add(start);
+		add(length);
+	}
+	
+	void GetVariablesSnapshot::deserializeSpecific()
+	{
+		CmdMessage::deserializeSpecific();
+		
+		start = get<uint16>();
+		length = get<uint16>();
+	}
+	
+	void GetVariablesSnapshot::dumpSpecific(wostream &stream) const
+	{
+		CmdMessage::dumpSpecific(stream);
+		
+		stream << "start " << start << ", length " << length;
+	}
+	
+	//
+	
 	SetVariables::SetVariables(uint16 dest, uint16 start, const VariablesVector& variables) :
 		CmdMessage(ASEBA_MESSAGE_SET_VARIABLES, dest),
 		start(start),
@@ -933,8 +1344,8 @@ namespace Aseba
 		CmdMessage::serializeSpecific();
 		
 		add(start);
-		for (size_t i = 0; i < variables.size(); i++)
-			add(variables[i]);
+		if (!variables.empty())
+			addArray(&variables[0], variables.size());
 	}
 	
 	void SetVariables::deserializeSpecific()
@@ -943,8 +1354,8 @@ namespace Aseba
 		
 		start = get<uint16>();
 		variables.resize((rawData.size() - readPos) / 2);
-		for (size_t i = 0; i < variables.size(); i++)
-			variables[i] = get<sint16>();
+		if (!variables.empty())
+			getArray(&variables[0], variables.size());
 	}
 	
 	void SetVariables::dumpSpecific(wostream &stream) const
@@ -26,6 +26,7 @@
 #include "../../compiler/compiler.h"
 #include <vector>
 #include <string>
+#include <map>
 
 namespace Dashel
 {
@@ -54,11 +55,21 @@ namespace Aseba
 		virtual ~Message();
 		
 		void serialize(Dashel::Stream* stream);
+		void serialize(std::vector<uint8>& data);
 		static Message *receive(Dashel::Stream* stream);
 		void dump(std::wostream &stream) const;
 		void dumpBuffer(std::wostream &stream) const;
 		
+		//! Return true if the type of this message is in the range of user messages, in which case it is an instance of UserMessage
+		bool isUserMessage() const { return type < 0x8000; }
+		
 	protected:
+		friend class MessagePool;
+		static void receiveHeader(Dashel::Stream* stream, uint16& len, uint16& source, uint16& type);
+		void receivePayload(Dashel::Stream* stream, uint16 len, uint16 source, uint16 type);
+		void deserializeRawData();
+		void serializePayload(uint16 header[3]);
+		
 		virtual void serializeSpecific() = 0;
 		virtual void deserializeSpecific() = 0;
 		virtual void dumpSpecific(std::wostream &stream) const = 0;
@@ -66,13 +77,38 @@ namespace Aseba
 	
 	protected:
 		template<typename T> void add(const T& val);
+		template<typename T> void addArray(const T* vals, size_t count);
 		template<typename T> T get();
+		template<typename T> void getArray(T* vals, size_t count);
 		
 	protected:
 		std::vector<uint8> rawData;
 		size_t readPos;
 	};
 	
+	//! Receive messages into reusable instances, one per message type, so that once every type has been seen, receiving does not allocate memory any more
+	class MessagePool
+	{
+	public:
+		~MessagePool();
+		
+		/*! Read a message from stream and return it. The message is owned by the pool and
+			is valid until the next message of the same type is received, so it must not be deleted.
+			All user messages share the same instance. */
+		Message *receive(Dashel::Stream* stream);
+		
+		/*! Deserialize a message from its payload of len bytes, for instance read from a file, as if it was received by receive(). */
+		Message *deserialize(uint16 source, uint16 type, const uint8* payload, uint16 len);
+		
+	protected:
+		//! Return the instance for messages of this type, creating it if needed
+		Message *getMessage(uint16 type);
+		
+	protected:
+		typedef std::map<uint16, Message*> MessagesMap;
+		MessagesMap messages; //!< one message instance per type
+	};
+	
 	//! Any message sent by a script on a node
 	class UserMessage : public Message
 	{
@@ -99,9 +135,21 @@ namespace Aseba
 		uint16 pageSize;
 		uint16 pagesStart;
 		uint16 pagesCount;
+		//! maximum size of data in a BootloaderPageDataWriteChunk, 0 if the bootloader only supports the original protocol
+		uint16 dataChunkSize;
+		//! number of pages that can be sent before the first one is acknowledged, when using BootloaderPageDataWriteChunk
+		uint16 pagesInFlight;
+		//! optional features of the bootloader, see Flags
+		uint16 flags;
+		
+		//! Optional features of the bootloader
+		enum Flags
+		{
+			CAN_HASH_PAGES = 1 //!< the bootloader answers BootloaderGetPagesHash
+		};
 		
 	public:
-		BootloaderDescription() : Message(ASEBA_MESSAGE_BOOTLOADER_DESCRIPTION) { }
+		BootloaderDescription() : Message(ASEBA_MESSAGE_BOOTLOADER_DESCRIPTION), dataChunkSize(0), pagesInFlight(0), flags(0) { }
 	
 	protected:
 		virtual void serializeSpecific();
@@ -126,6 +174,23 @@ namespace Aseba
 		virtual operator const char * () const { return "bootloader page data read"; }
 	};
 	
+	//! Message for bootloader: CRC-32 (IEEE 802.3) of the content of consecutive pages, starting at firstPage
+	class BootloaderPagesHash : public Message
+	{
+	public:
+		uint16 firstPage;
+		std::vector<uint32> hashes;
+		
+	public:
+		BootloaderPagesHash() : Message(ASEBA_MESSAGE_BOOTLOADER_PAGES_HASH), firstPage(0) { }
+	
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "bootloader pages hash"; }
+	};
+	
 	//! Message for bootloader: acknowledge, with optional error code
 	class BootloaderAck : public Message
 	{
@@ -168,6 +233,40 @@ namespace Aseba
 		virtual operator const char * () const { return "presence"; }
 	};
 	
+	//! Request nodes to send the hash of their description, nodes not supporting it will not answer
+	class GetDescriptionHash : public Message
+	{
+	public:
+		uint16 version;
+		
+	public:
+		GetDescriptionHash() : Message(ASEBA_MESSAGE_GET_DESCRIPTION_HASH), version(ASEBA_PROTOCOL_VERSION) { }
+		
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &) const;
+		virtual operator const char * () const { return "get description hash"; }
+	};
+	
+	//! Name, protocol version and CRC of the description of a node, allowing to use a cached copy of the description instead of receiving it
+	class DescriptionHash : public Message
+	{
+	public:
+		std::wstring name;
+		uint16 protocolVersion;
+		uint16 crc;
+		
+	public:
+		DescriptionHash() : Message(ASEBA_MESSAGE_DESCRIPTION_HASH) { }
+		
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "description hash"; }
+	};
+	
 	//! Description of a node, local events and native functions are omitted and further received by other messages
 	class Description : public Message, public TargetDescription
 	{
@@ -250,6 +349,63 @@ namespace Aseba
 		virtual operator const char * () const { return "variables"; }
 	};
 	
+	//! Content of some variables, as one of the chunks answering a GetVariablesSnapshot
+	class VariablesSnapshotChunk : public Message
+	{
+	public:
+		uint16 sequence; //!< number of this chunk in the snapshot, starting at 0
+		uint16 start;
+		std::vector<sint16> variables;
+		
+	public:
+		VariablesSnapshotChunk() : Message(ASEBA_MESSAGE_VARIABLES_SNAPSHOT_CHUNK) { }
+		
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "variables snapshot chunk"; }
+	};
+	
+	//! End of the chunks answering a GetVariablesSnapshot
+	class VariablesSnapshotEnd : public Message
+	{
+	public:
+		uint16 start;
+		uint16 length;
+		uint16 chunksCount; //!< number of chunks sent for this snapshot
+		
+	public:
+		VariablesSnapshotEnd() : Message(ASEBA_MESSAGE_VARIABLES_SNAPSHOT_END) { }
+		
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "variables snapshot end"; }
+	};
+	
+	//! Counters of an event handler or a subroutine, as one of the messages answering a GetProfile
+	class Profile : public Message
+	{
+	public:
+		uint16 entriesCount; //!< number of entries of the profile, 0 if it is empty, in which case the other fields are meaningless
+		uint16 index; //!< number of this entry, starting at 0
+		uint16 address; //!< address of the first instruction of the event handler or subroutine
+		uint32 instructionsCount; //!< instructions executed, not counting the ones of called subroutines
+		uint32 nativeCallsCount; //!< native functions called
+		uint32 nativeTime; //!< time spent in native functions, in units of the clock of the node, 0 if it has none
+		
+	public:
+		Profile() : Message(ASEBA_MESSAGE_PROFILE) { }
+		
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "profile"; }
+	};
+	
 	//! Exception: an array acces attempted to read past memory
 	class ArrayAccessOutOfBounds : public Message
 	{
@@ -429,6 +585,43 @@ namespace Aseba
 		virtual operator const char * () const { return "bootloader page data write"; }
 	};
 	
+	//! Message for bootloader: data for flash at offset in a page, the page being written once all its data are received, then acknowledged
+	class BootloaderPageDataWriteChunk : public CmdMessage
+	{
+	public:
+		uint16 pageNumber;
+		uint16 offset;
+		std::vector<uint8> data;
+		
+	public:
+		BootloaderPageDataWriteChunk() : CmdMessage(ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK, ASEBA_DEST_INVALID) { }
+		BootloaderPageDataWriteChunk(uint16 dest, uint16 pageNumber, uint16 offset) : CmdMessage(ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK, dest), pageNumber(pageNumber), offset(offset) { }
+	
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "bootloader page data write chunk"; }
+	};
+	
+	//! Message for bootloader: request the hash of pagesCount pages starting at firstPage, answered by BootloaderPagesHash
+	class BootloaderGetPagesHash : public CmdMessage
+	{
+	public:
+		uint16 firstPage;
+		uint16 pagesCount;
+		
+	public:
+		BootloaderGetPagesHash() : CmdMessage(ASEBA_MESSAGE_BOOTLOADER_GET_PAGES_HASH, ASEBA_DEST_INVALID) { }
+		BootloaderGetPagesHash(uint16 dest, uint16 firstPage, uint16 pagesCount) : CmdMessage(ASEBA_MESSAGE_BOOTLOADER_GET_PAGES_HASH, dest), firstPage(firstPage), pagesCount(pagesCount) { }
+	
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "bootloader get pages hash"; }
+	};
+	
 	//! Upload bytecode to a node
 	class SetBytecode : public CmdMessage
 	{
@@ -518,6 +711,23 @@ namespace Aseba
 		virtual operator const char * () const { return "get execution state"; }
 	};
 	
+	//! Request a specific node to send its description, for instance if its description hash is not in cache
+	class GetNodeDescription : public CmdMessage
+	{
+	public:
+		uint16 version;
+		
+	public:
+		GetNodeDescription() : CmdMessage(ASEBA_MESSAGE_GET_NODE_DESCRIPTION, ASEBA_DEST_INVALID), version(ASEBA_PROTOCOL_VERSION) { }
+		GetNodeDescription(uint16 dest) : CmdMessage(ASEBA_MESSAGE_GET_NODE_DESCRIPTION, dest), version(ASEBA_PROTOCOL_VERSION) { }
+		
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "get node description"; }
+	};
+	
 	//! Set a breakpoint on a node
 	class BreakpointSet : public CmdMessage
 	{
@@ -581,6 +791,46 @@ namespace Aseba
 		virtual operator const char * () const { return "get variables"; }
 	};
 	
+	//! Read some variables from a node at once, whatever their number, the node answers with sequence-numbered VariablesSnapshotChunk followed by a VariablesSnapshotEnd
+	class GetVariablesSnapshot : public CmdMessage
+	{
+	public:
+		uint16 start;
+		uint16 length;
+		
+	public:
+		GetVariablesSnapshot() : CmdMessage(ASEBA_MESSAGE_GET_VARIABLES_SNAPSHOT, ASEBA_DEST_INVALID) { }
+		GetVariablesSnapshot(uint16 dest, uint16 start, uint16 length);
+		
+	protected:
+		virtual void serializeSpecific();
+		virtual void deserializeSpecific();
+		virtual void dumpSpecific(std::wostream &stream) const;
+		virtual operator const char * () const { return "get variables snapshot"; }
+	};
+	
+	//! Request the counters of the profiler of a node, the node answers with one Profile per entry, or does not answer if it has no profiler
+	class GetProfile : public CmdMessage
+	{
+	public:
+		GetProfile() : CmdMessage(ASEBA_MESSAGE_GET_PROFILE, ASEBA_DEST_INVALID) { }
+		GetProfile(uint16 dest) : CmdMessage(ASEBA_MESSAGE_GET_PROFILE, dest) { }
+		
+	protected:
+		virtual operator const char * () const { return "get profile"; }
+	};
+	
+	//! Clear the counters of the profiler of a node
+	class ResetProfile : public CmdMessage
+	{
+	public:
+		ResetProfile() : CmdMessage(ASEBA_MESSAGE_RESET_PROFILE, ASEBA_DEST_INVALID) { }
+		ResetProfile(uint16 dest) : CmdMessage(ASEBA_MESSAGE_RESET_PROFILE, dest) { }
+		
+	protected:
+		virtual operator const char * () const { return "reset profile"; }
+	};
+	
 	//! Set some variables on a node
 	class SetVariables : public CmdMessage
 	{
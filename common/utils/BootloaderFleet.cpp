@@ -0,0 +1,355 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BootloaderFleet.h"
+#include "../consts.h"
+#include "../msg/msg.h"
+#include <memory>
+#include <algorithm>
+
+namespace Aseba
+{
+	using namespace Dashel;
+	using namespace std;
+	
+	BootloaderFleet::BootloaderFleet(const std::string& hexFileName, unsigned maxRetries, UnifiedTime::Value timeout) :
+		maxRetries(maxRetries),
+		timeout(timeout),
+		activeCount(0),
+		duration(0)
+	{
+		hexFile.read(hexFileName);
+	}
+	
+	void BootloaderFleet::addNode(const std::string& target, uint16 dest)
+	{
+		// nodes on the same target share its stream, for instance through a switch
+		Stream* stream;
+		map<string, Stream*>::const_iterator it(targets.find(target));
+		if (it == targets.end())
+		{
+			stream = connect(target);
+			targets[target] = stream;
+		}
+		else
+			stream = it->second;
+		
+		addNode(stream, target, dest);
+	}
+	
+	void BootloaderFleet::addNode(Dashel::Stream* stream, const std::string& target, uint16 dest)
+	{
+		Node node;
+		node.stream = stream;
+		node.target = target;
+		node.dest = dest;
+		node.state = Node::WAITING_DESCRIPTION;
+		node.pageSize = 0;
+		node.dataChunkSize = 0;
+		node.pagesInFlight = 0;
+		node.sentCount = 0;
+		node.ackedCount = 0;
+		node.ignoredAcks = 0;
+		node.retries = 0;
+		node.duration = 0;
+		nodesIndex[make_pair(stream, dest)] = nodes.size();
+		nodes.push_back(node);
+	}
+	
+	unsigned BootloaderFleet::upgrade()
+	{
+		const UnifiedTime startTime;
+		
+		// ask all nodes to enter their bootloader
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			Node& node(nodes[i]);
+			node.startTime = UnifiedTime();
+			node.lastActivity = node.startTime;
+			Reboot message(node.dest);
+			message.serialize(node.stream);
+			++activeCount;
+			nodeStarted(node);
+		}
+		for (map<string, Stream*>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+			it->second->flush();
+		
+		while (activeCount > 0)
+		{
+			step(10);
+			checkTimeouts(UnifiedTime());
+		}
+		
+		duration = (UnifiedTime() - startTime).value;
+		
+		unsigned failuresCount(0);
+		for (size_t i = 0; i < nodes.size(); ++i)
+			if (nodes[i].state == Node::FAILED)
+				++failuresCount;
+		return failuresCount;
+	}
+	
+	void BootloaderFleet::checkTimeouts(const UnifiedTime& now)
+	{
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			Node& node(nodes[i]);
+			if ((node.state != Node::DONE) && (node.state != Node::FAILED) && ((now - node.lastActivity).value > timeout))
+			{
+				// acks do not tell which page they are for, and ours might be late or lost,
+				// so reboot the node and wait for its description to write its pages again from a known state
+				node.state = Node::WAITING_DESCRIPTION;
+				node.ignoredAcks = 0;
+				retry(node, "timeout");
+			}
+		}
+	}
+	
+	void BootloaderFleet::dumpReport(std::ostream& stream) const
+	{
+		unsigned successesCount(0);
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			const Node& node(nodes[i]);
+			stream << node.target << " node " << node.dest << ": ";
+			if (node.state == Node::DONE)
+			{
+				stream << "upgraded, " << node.pages.size() << " pages";
+				++successesCount;
+			}
+			else
+				stream << "failed after " << node.ackedCount << " of " << node.pages.size() << " pages, " << node.error;
+			stream << ", " << node.retries << " retries, " << double(node.duration) / 1000. << " s\n";
+		}
+		stream << successesCount << " of " << nodes.size() << " nodes upgraded in " << double(duration) / 1000. << " s" << endl;
+	}
+	
+	void BootloaderFleet::incomingData(Stream *stream)
+	{
+		auto_ptr<Message> message(Message::receive(stream));
+		
+		NodesIndex::const_iterator it(nodesIndex.find(make_pair(stream, message->source)));
+		if (it == nodesIndex.end())
+			return;
+		
+		Node& node(nodes[it->second]);
+		if ((node.state == Node::DONE) || (node.state == Node::FAILED))
+			return;
+		
+		node.lastActivity = UnifiedTime();
+		processMessage(node, message.get());
+	}
+	
+	void BootloaderFleet::connectionClosed(Stream *stream, bool abnormal)
+	{
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			Node& node(nodes[i]);
+			if (node.stream != stream)
+				continue;
+			node.stream = 0;
+			if ((node.state != Node::DONE) && (node.state != Node::FAILED))
+				fail(node, abnormal ? "connection lost: " + stream->getFailReason() : "connection closed");
+		}
+		for (map<string, Stream*>::iterator it = targets.begin(); it != targets.end(); ++it)
+			if (it->second == stream)
+			{
+				targets.erase(it);
+				break;
+			}
+	}
+	
+	void BootloaderFleet::processMessage(Node& node, const Message* message)
+	{
+		if (message->type == ASEBA_MESSAGE_BOOTLOADER_DESCRIPTION)
+		{
+			// the node (re)entered its bootloader, (re)start writing all pages
+			const BootloaderDescription* description(static_cast<const BootloaderDescription*>(message));
+			if ((description->pageSize == 0) || (description->pageSize % 4 != 0))
+			{
+				// pages are written by words of 4 bytes
+				fail(node, "invalid page size");
+				return;
+			}
+			node.pageSize = description->pageSize;
+			node.dataChunkSize = description->dataChunkSize;
+			node.pagesInFlight = description->pagesInFlight;
+			node.pages.clear();
+			const BootloaderInterface::PageMap& pageMap(getPageMap(node.pageSize));
+			for (BootloaderInterface::PageMap::const_iterator it = pageMap.begin(); it != pageMap.end(); ++it)
+				if ((it->first >= description->pagesStart) && (it->first < unsigned(description->pagesStart) + description->pagesCount))
+					node.pages.push_back(&(*it));
+			node.sentCount = 0;
+			node.ackedCount = 0;
+			node.ignoredAcks = 0;
+			node.state = node.dataChunkSize ? Node::WRITING_PIPELINED : Node::WAITING_PAGE_ACK;
+			sendPages(node);
+			return;
+		}
+		
+		if ((message->type != ASEBA_MESSAGE_BOOTLOADER_ACK) || (node.state == Node::WAITING_DESCRIPTION))
+			return;
+		
+		const BootloaderAck* ack(static_cast<const BootloaderAck*>(message));
+		if (node.ignoredAcks)
+		{
+			--node.ignoredAcks;
+			return;
+		}
+		if (ack->errorCode != BootloaderAck::SUCCESS)
+		{
+			// pages sent after the failed one will still be acknowledged
+			node.ignoredAcks = node.sentCount - node.ackedCount - 1;
+			retry(node, "bootloader error");
+			return;
+		}
+		
+		switch (node.state)
+		{
+			case Node::WAITING_PAGE_ACK:
+			{
+				// the bootloader is ready to receive the data of the page
+				const vector<uint8>& data(node.pages[node.ackedCount]->second);
+				for (unsigned dataWritten = 0; dataWritten < node.pageSize; dataWritten += 4)
+				{
+					BootloaderPageDataWrite pageData(node.dest);
+					copy(data.begin() + dataWritten, data.begin() + dataWritten + sizeof(pageData.data), pageData.data);
+					pageData.serialize(node.stream);
+				}
+				node.stream->flush();
+				node.state = Node::WAITING_DATA_ACK;
+			}
+			break;
+			
+			case Node::WAITING_DATA_ACK:
+				++node.ackedCount;
+				nodeProgress(node);
+				node.state = Node::WAITING_PAGE_ACK;
+				sendPages(node);
+			break;
+			
+			case Node::WRITING_PIPELINED:
+				++node.ackedCount;
+				nodeProgress(node);
+				sendPages(node);
+			break;
+			
+			default:
+			break;
+		}
+	}
+	
+	void BootloaderFleet::sendPages(Node& node)
+	{
+		if (node.ackedCount == node.pages.size())
+		{
+			finish(node);
+			return;
+		}
+		
+		if (node.state == Node::WRITING_PIPELINED)
+		{
+			// chunks must fit in a message along with dest, page number and offset
+			const unsigned chunkSize(min<unsigned>(node.dataChunkSize, ASEBA_MAX_EVENT_ARG_SIZE - 6));
+			const size_t window(max<unsigned>(node.pagesInFlight, 1));
+			while ((node.sentCount < node.pages.size()) && (node.sentCount - node.ackedCount < window))
+			{
+				const unsigned pageNumber(node.pages[node.sentCount]->first);
+				const vector<uint8>& data(node.pages[node.sentCount]->second);
+				for (unsigned offset = 0; offset < node.pageSize; offset += chunkSize)
+				{
+					BootloaderPageDataWriteChunk chunk(node.dest, pageNumber, offset);
+					chunk.data.assign(data.begin() + offset, data.begin() + min(offset + chunkSize, node.pageSize));
+					chunk.serialize(node.stream);
+				}
+				++node.sentCount;
+			}
+		}
+		else
+		{
+			// original protocol, one page at a time
+			BootloaderWritePage writePage(node.dest);
+			writePage.pageNumber = node.pages[node.ackedCount]->first;
+			writePage.serialize(node.stream);
+			node.sentCount = node.ackedCount + 1;
+			node.state = Node::WAITING_PAGE_ACK;
+		}
+		node.stream->flush();
+	}
+	
+	void BootloaderFleet::retry(Node& node, const std::string& reason)
+	{
+		if (node.retries >= maxRetries)
+		{
+			fail(node, reason);
+			return;
+		}
+		++node.retries;
+		node.lastActivity = UnifiedTime();
+		nodeRetry(node, reason);
+		
+		if (node.state == Node::WAITING_DESCRIPTION)
+		{
+			Reboot message(node.dest);
+			message.serialize(node.stream);
+			node.stream->flush();
+		}
+		else
+		{
+			// send again the pages that were not acknowledged, chunks and pages can be written several times
+			node.sentCount = node.ackedCount;
+			if (node.state != Node::WRITING_PIPELINED)
+				node.state = Node::WAITING_PAGE_ACK;
+			sendPages(node);
+		}
+	}
+	
+	void BootloaderFleet::finish(Node& node)
+	{
+		BootloaderReset message(node.dest);
+		message.serialize(node.stream);
+		node.stream->flush();
+		
+		node.state = Node::DONE;
+		node.duration = (UnifiedTime() - node.startTime).value;
+		--activeCount;
+		nodeFinished(node);
+	}
+	
+	void BootloaderFleet::fail(Node& node, const std::string& reason)
+	{
+		node.state = Node::FAILED;
+		node.error = reason;
+		node.duration = (UnifiedTime() - node.startTime).value;
+		--activeCount;
+		nodeFinished(node);
+	}
+	
+	const BootloaderInterface::PageMap& BootloaderFleet::getPageMap(unsigned pageSize)
+	{
+		map<unsigned, BootloaderInterface::PageMap>::iterator it(pageMaps.find(pageSize));
+		if (it == pageMaps.end())
+		{
+			it = pageMaps.insert(make_pair(pageSize, BootloaderInterface::PageMap())).first;
+			BootloaderInterface::buildPageMap(hexFile, pageSize, it->second);
+		}
+		return it->second;
+	}
+} // namespace Aseba
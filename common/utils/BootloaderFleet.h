@@ -0,0 +1,139 @@
+/*
+	Aseba - an event-based framework for distributed robot control
+	Copyright (C) 2007--2013:
+		Stephane Magnenat <stephane at magnenat dot net>
+		(http://stephane.magnenat.net)
+		and other contributors, see authors.txt for details
+	
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published
+	by the Free Software Foundation, version 3 of the License.
+	
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+	
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEBA_BOOTLOADER_FLEET_H
+#define ASEBA_BOOTLOADER_FLEET_H
+
+#include <dashel/dashel.h>
+#include "BootloaderInterface.h"
+#include "HexFile.h"
+#include "utils.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace Aseba
+{
+	class Message;
+	
+	//! Write an hex file to many nodes at once
+	/**
+		Unlike BootloaderInterface, which blocks on each acknowledgement of a single node,
+		this class runs one state machine per node, driven by the messages it receives,
+		so that all nodes are written concurrently, on different targets or on the same one.
+		The hex file is read once and split into pages once per page size.
+		After a bootloader error, unacknowledged pages are sent again; after a timeout, as acknowledgements
+		do not tell which page they are for, the node is rebooted and all its pages are written again.
+		Both are retried a limited number of times.
+		Only the complete bootloader protocol is supported, pipelined if the bootloader advertises it.
+	*/
+	class BootloaderFleet: public Dashel::Hub
+	{
+	public:
+		//! The upgrade of a node
+		struct Node
+		{
+			//! Where the node is in the upgrade
+			enum State
+			{
+				WAITING_DESCRIPTION, //!< reboot requested, at start or after a timeout, waiting for the bootloader description
+				WAITING_PAGE_ACK, //!< original protocol, write page command sent
+				WAITING_DATA_ACK, //!< original protocol, data of the page sent
+				WRITING_PIPELINED, //!< pages being sent in chunks
+				DONE, //!< all pages written
+				FAILED //!< too many retries or connection lost
+			};
+			
+			Dashel::Stream* stream; //!< stream to the node, 0 once closed
+			std::string target; //!< Dashel target of the node
+			uint16 dest; //!< identifier of the node
+			State state; //!< current state
+			unsigned pageSize; //!< from the bootloader description
+			unsigned dataChunkSize; //!< from the bootloader description, 0 for the original protocol
+			unsigned pagesInFlight; //!< from the bootloader description
+			std::vector<const BootloaderInterface::PageMap::value_type*> pages; //!< pages to write
+			size_t sentCount; //!< number of pages sent
+			size_t ackedCount; //!< number of pages acknowledged
+			unsigned ignoredAcks; //!< acknowledgements of pages sent after a page that failed, to ignore
+			unsigned retries; //!< number of retries so far
+			UnifiedTime startTime; //!< when the upgrade started
+			UnifiedTime lastActivity; //!< when the node last answered, for timeouts
+			UnifiedTime::Value duration; //!< duration of the upgrade in ms, once finished
+			std::string error; //!< reason of the failure
+		};
+	
+	public:
+		//! Read the hex file, throw HexFile::Error if it is invalid
+		BootloaderFleet(const std::string& hexFileName, unsigned maxRetries = 5, UnifiedTime::Value timeout = 3000);
+		
+		//! Add node dest on target, connecting to target if it is not already, throw a Dashel::DashelException on error
+		void addNode(const std::string& target, uint16 dest);
+		//! Upgrade all nodes, return the number of failures
+		unsigned upgrade();
+		//! Write a line per node and a summary to stream
+		void dumpReport(std::ostream& stream) const;
+	
+	protected:
+		// reporting function
+		
+		virtual void nodeStarted(const Node& node) {}
+		virtual void nodeProgress(const Node& node) {}
+		virtual void nodeRetry(const Node& node, const std::string& reason) {}
+		virtual void nodeFinished(const Node& node) {}
+	
+	protected:
+		virtual void incomingData(Dashel::Stream *stream);
+		virtual void connectionClosed(Dashel::Stream *stream, bool abnormal);
+		
+		//! Add node dest reachable through stream, connected to target
+		void addNode(Dashel::Stream* stream, const std::string& target, uint16 dest);
+		//! Retry the nodes that did not answer since more than the timeout at time now
+		void checkTimeouts(const UnifiedTime& now);
+		//! Process message from node
+		void processMessage(Node& node, const Message* message);
+		//! Send pages to node, up to the window for the pipelined protocol
+		void sendPages(Node& node);
+		//! Retry the unacknowledged pages of node, or fail if it was tried too often
+		void retry(Node& node, const std::string& reason);
+		//! Exit the bootloader of node and mark it as done
+		void finish(Node& node);
+		//! Mark node as failed
+		void fail(Node& node, const std::string& reason);
+		//! Return the pages of size pageSize, building them if needed
+		const BootloaderInterface::PageMap& getPageMap(unsigned pageSize);
+	
+	protected:
+		//! Nodes by stream and identifier
+		typedef std::map<std::pair<Dashel::Stream*, uint16>, size_t> NodesIndex;
+		
+		HexFile hexFile; //!< the content to write
+		std::map<unsigned, BootloaderInterface::PageMap> pageMaps; //!< content split into pages, for each page size
+		std::map<std::string, Dashel::Stream*> targets; //!< streams for each target
+		std::vector<Node> nodes; //!< the nodes to upgrade
+		NodesIndex nodesIndex; //!< index of nodes in nodes
+		unsigned maxRetries; //!< number of retries before failing a node
+		UnifiedTime::Value timeout; //!< time without answer before retrying, in ms
+		unsigned activeCount; //!< number of nodes neither done nor failed
+		UnifiedTime::Value duration; //!< duration of the whole upgrade in ms
+	};
+} // namespace Aseba
+
+#endif // ASEBA_BOOTLOADER_FLEET_H
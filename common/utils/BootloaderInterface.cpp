@@ -33,12 +33,28 @@ namespace Aseba
 	using namespace Dashel;
 	using namespace std;
 	
+	//! Return the CRC-32 (IEEE 802.3) of len bytes of data, as computed by bootloaders to hash pages
+	static uint32 crc32(const uint8* data, size_t len)
+	{
+		uint32 crc(0xffffffff);
+		for (size_t i = 0; i < len; ++i)
+		{
+			crc ^= data[i];
+			for (unsigned bit = 0; bit < 8; ++bit)
+				crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+		}
+		return (~crc) & 0xffffffff;
+	}
+	
 	BootloaderInterface::BootloaderInterface(Stream* stream, int dest) :
 		stream(stream),
 		dest(dest),
 		pageSize(0),
 		pagesStart(0),
-		pagesCount(0)
+		pagesCount(0),
+		dataChunkSize(0),
+		pagesInFlight(0),
+		flags(0)
 	{
 		
 	}
@@ -64,9 +80,9 @@ namespace Aseba
 			auto_ptr<Message> message(Message::receive(stream));
 			
 			// handle ack
-			BootloaderAck *ackMessage = dynamic_cast<BootloaderAck *>(message.get());
-			if (ackMessage && (ackMessage->source == dest))
+			if ((message->type == ASEBA_MESSAGE_BOOTLOADER_ACK) && (message->source == dest))
 			{
+				BootloaderAck *ackMessage = static_cast<BootloaderAck *>(message.get());
 				uint16 errorCode = ackMessage->errorCode;
 				if (errorCode == BootloaderAck::SUCCESS)
 				{
@@ -79,15 +95,14 @@ namespace Aseba
 			}
 			
 			// handle data
-			BootloaderDataRead *dataMessage = dynamic_cast<BootloaderDataRead *>(message.get());
-			if (dataMessage && (dataMessage->source == dest))
+			if ((message->type == ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_READ) && (message->source == dest))
 			{
+				BootloaderDataRead *dataMessage = static_cast<BootloaderDataRead *>(message.get());
 				if (dataRead >= pageSize)
 					cerr << "Warning, reading oversized page (" << dataRead << "/" << pageSize << ") bytes.\n";
 				copy(dataMessage->data, dataMessage->data + sizeof(dataMessage->data), data);
 				data += sizeof(dataMessage->data);
 				dataRead += sizeof(dataMessage->data);
-				cout << "Page read so far (" << dataRead << "/" << pageSize << ") bytes.\n";
 			}
 		}
 		
@@ -132,9 +147,9 @@ namespace Aseba
 				auto_ptr<Message> message(Message::receive(stream));
 				
 				// handle ack
-				BootloaderAck *ackMessage = dynamic_cast<BootloaderAck *>(message.get());
-				if (ackMessage && (ackMessage->source == dest))
+				if ((message->type == ASEBA_MESSAGE_BOOTLOADER_ACK) && (message->source == dest))
 				{
+					BootloaderAck *ackMessage = static_cast<BootloaderAck *>(message.get());
 					uint16 errorCode = ackMessage->errorCode;
 					if(errorCode == BootloaderAck::SUCCESS)
 						break;
@@ -183,9 +198,9 @@ namespace Aseba
 			auto_ptr<Message> message(Message::receive(stream));
 			
 			// handle ack
-			BootloaderAck *ackMessage = dynamic_cast<BootloaderAck *>(message.get());
-			if (ackMessage && (ackMessage->source == dest))
+			if ((message->type == ASEBA_MESSAGE_BOOTLOADER_ACK) && (message->source == dest))
 			{
+				BootloaderAck *ackMessage = static_cast<BootloaderAck *>(message.get());
 				uint16 errorCode = ackMessage->errorCode;
 				if(errorCode == BootloaderAck::SUCCESS)
 				{
@@ -204,7 +219,140 @@ namespace Aseba
 		return true;
 	}
 	
-	void BootloaderInterface::writeHex(const string &fileName, bool reset, bool simple)
+	void BootloaderInterface::writePagesPipelined(const PageMap& pageMap)
+	{
+		// pages within the range of the bootloader
+		vector<PageMap::const_iterator> pages;
+		for (PageMap::const_iterator it = pageMap.begin(); it != pageMap.end(); ++it)
+			if ((it->first >= pagesStart) && (it->first < pagesStart + pagesCount))
+				pages.push_back(it);
+		
+		// chunks must fit in a message along with dest, page number and offset
+		const unsigned chunkSize(min<unsigned>(dataChunkSize, ASEBA_MAX_EVENT_ARG_SIZE - 6));
+		const size_t window(max<unsigned>(pagesInFlight, 1));
+		
+		size_t sentCount(0);
+		size_t ackedCount(0);
+		while (ackedCount < pages.size())
+		{
+			// send pages until the window is full
+			while ((sentCount < pages.size()) && (sentCount - ackedCount < window))
+			{
+				const unsigned pageNumber(pages[sentCount]->first);
+				const uint8* data(&pages[sentCount]->second[0]);
+				writePageStart(pageNumber, data, false);
+				for (unsigned offset = 0; offset < pageSize; offset += chunkSize)
+				{
+					BootloaderPageDataWriteChunk chunk(dest, pageNumber, offset);
+					chunk.data.assign(data + offset, data + min(offset + chunkSize, pageSize));
+					chunk.serialize(stream);
+				}
+				++sentCount;
+			}
+			// flush only here to save bandwidth
+			stream->flush();
+			
+			// pages are acknowledged in the order they were sent
+			writePageWaitAck();
+			if (!waitAck())
+			{
+				writePageFailure();
+				throw Error(FormatableString("Error while writing page %0").arg(pages[ackedCount]->first));
+			}
+			writePageSuccess();
+			++ackedCount;
+		}
+	}
+	
+	void BootloaderInterface::removeUnchangedPages(PageMap& pageMap)
+	{
+		unsigned unchangedCount(0);
+		unsigned changedCount(0);
+		
+		PageMap::iterator it(pageMap.begin());
+		while (it != pageMap.end())
+		{
+			// pages outside the range of the bootloader are not written anyway
+			if ((it->first < pagesStart) || (it->first >= pagesStart + pagesCount))
+			{
+				++it;
+				continue;
+			}
+			
+			// compare runs of consecutive pages, as many as fit in a hash message
+			const unsigned maxRunLength((ASEBA_MAX_EVENT_ARG_SIZE - 2) / 4);
+			vector<PageMap::iterator> run(1, it);
+			for (++it; (it != pageMap.end()) && (it->first == run.back()->first + 1) && (it->first < pagesStart + pagesCount) && (run.size() < maxRunLength); ++it)
+				run.push_back(it);
+			
+			vector<uint32> hashes;
+			if (flags & BootloaderDescription::CAN_HASH_PAGES)
+				getPagesHash(run.front()->first, run.size(), hashes);
+			
+			vector<uint8> flashContent(pageSize);
+			for (size_t i = 0; i < run.size(); ++i)
+			{
+				const vector<uint8>& content(run[i]->second);
+				bool unchanged;
+				if (flags & BootloaderDescription::CAN_HASH_PAGES)
+					unchanged = (i < hashes.size()) && (hashes[i] == crc32(&content[0], content.size()));
+				else
+					unchanged = readPage(run[i]->first, &flashContent[0]) && (flashContent == content);
+				
+				if (unchanged)
+				{
+					pageMap.erase(run[i]);
+					++unchangedCount;
+				}
+				else
+					++changedCount;
+			}
+		}
+		
+		writeHexPagesCompared(unchangedCount, changedCount);
+	}
+	
+	void BootloaderInterface::getPagesHash(unsigned firstPage, unsigned pagesCount, vector<uint32>& hashes)
+	{
+		BootloaderGetPagesHash request(dest, firstPage, pagesCount);
+		request.serialize(stream);
+		stream->flush();
+		
+		while (true)
+		{
+			auto_ptr<Message> message(Message::receive(stream));
+			if ((message->type == ASEBA_MESSAGE_BOOTLOADER_PAGES_HASH) && (message->source == dest))
+			{
+				BootloaderPagesHash *hashMessage = static_cast<BootloaderPagesHash *>(message.get());
+				if (hashMessage->firstPage == firstPage)
+				{
+					hashes = hashMessage->hashes;
+					return;
+				}
+			}
+		}
+	}
+	
+	bool BootloaderInterface::waitAck()
+	{
+		while (true)
+		{
+			auto_ptr<Message> message(Message::receive(stream));
+			if ((message->type == ASEBA_MESSAGE_BOOTLOADER_ACK) && (message->source == dest))
+			{
+				BootloaderAck *ackMessage = static_cast<BootloaderAck *>(message.get());
+				return ackMessage->errorCode == BootloaderAck::SUCCESS;
+			}
+		}
+	}
+	
+	void BootloaderInterface::buildPageMap(const HexFile& hexFile, unsigned pageSize, PageMap& pageMap)
+	{
+		// bytes without data are written as 0
+		hexFile.buildPages(pageSize, pageMap, 0);
+	}
+	
+	void BootloaderInterface::writeHex(const string &fileName, bool reset, bool simple, bool diff)
 	{
 		// Load hex file
 		HexFile hexFile;
@@ -245,52 +393,27 @@ namespace Aseba
 			while (true)
 			{
 				auto_ptr<Message> message(Message::receive(stream));
-				BootloaderDescription *bDescMessage = dynamic_cast<BootloaderDescription *>(message.get());
-				if (bDescMessage && (bDescMessage->source == dest))
+				if ((message->type == ASEBA_MESSAGE_BOOTLOADER_DESCRIPTION) && (message->source == dest))
 				{
+					BootloaderDescription *bDescMessage = static_cast<BootloaderDescription *>(message.get());
 					pageSize = bDescMessage->pageSize;
 					pagesStart = bDescMessage->pagesStart;
 					pagesCount = bDescMessage->pagesCount;
+					dataChunkSize = bDescMessage->dataChunkSize;
+					pagesInFlight = bDescMessage->pagesInFlight;
+					flags = bDescMessage->flags;
 					break;
 				}
 			}
 		}
 		
 		// Build a map of pages out of the map of addresses
-		typedef map<uint32, vector<uint8> > PageMap;
 		PageMap pageMap;
-		for (HexFile::ChunkMap::iterator it = hexFile.data.begin(); it != hexFile.data.end(); it ++)
-		{
-			// get page number
-			unsigned chunkAddress = it->first;
-			// index inside data chunk
-			unsigned chunkDataIndex = 0;
-			// size of chunk in bytes
-			unsigned chunkSize = it->second.size();
-			
-			// copy data from chunk to page
-			do
-			{
-				// get page number
-				unsigned pageIndex = (chunkAddress + chunkDataIndex) / pageSize;
-				// get address inside page
-				unsigned byteIndex = (chunkAddress + chunkDataIndex) % pageSize;
-			
-				// if page does not exists, create it
-				if (pageMap.find(pageIndex) == pageMap.end())
-				{
-				//	std::cout << "New page N° " << pageIndex << " for address 0x" << std::hex << chunkAddress << endl;
-					pageMap[pageIndex] = vector<uint8>(pageSize, (uint8)0);
-				}
-				// copy data
-				unsigned amountToCopy = min(pageSize - byteIndex, chunkSize - chunkDataIndex);
-				copy(it->second.begin() + chunkDataIndex, it->second.begin() + chunkDataIndex + amountToCopy, pageMap[pageIndex].begin() + byteIndex);
-				
-				// increment chunk data pointer
-				chunkDataIndex += amountToCopy;
-			}
-			while (chunkDataIndex < chunkSize);
-		}
+		buildPageMap(hexFile, pageSize, pageMap);
+		
+		// skip the pages already in flash
+		if (diff && !simple)
+			removeUnchangedPages(pageMap);
 		
 		writeHexGotDescription(pageMap.size());
 		
@@ -313,6 +436,11 @@ namespace Aseba
 						errorWritePageNonFatal(pageIndex);
 			}
 		}
+		else if (dataChunkSize)
+		{
+			// Write pages without waiting for each of them
+			writePagesPipelined(pageMap);
+		}
 		else
 		{
 			// Write pages
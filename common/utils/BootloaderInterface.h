@@ -23,6 +23,8 @@
 
 #include <string>
 #include <stdexcept>
+#include <map>
+#include <vector>
 #include "../types.h"
 
 
@@ -33,6 +35,8 @@ namespace Dashel
 
 namespace Aseba 
 {
+	class HexFile;
+	
 	// TODO: change API to use HexFile instead of file names
 	
 	//! Manage interactions with an aseba-compatible bootloader
@@ -42,6 +46,11 @@ namespace Aseba
 		as it transmits all data using the Aseba message protocol.
 		The simple version requires direct access to the device to be flashed,
 		because it breaks the Aseba message protocol for page transmission.
+		If the bootloader advertises it in its description, the complete version
+		sends pages in large chunks and keeps several pages in flight,
+		otherwise it waits for each page to be acknowledged before sending the next one.
+		In diff mode, only the pages that differ from the content of the flash are written,
+		using hashes computed by the bootloader if it supports it, or by reading the pages back.
 	*/
 	class BootloaderInterface
 	{
@@ -70,13 +79,31 @@ namespace Aseba
 		//! Write a page, if simple is true, use simplified protocol, otherwise use complete protocol
 		bool writePage(unsigned pageNumber, const uint8 *data, bool simple);
 		
-		//! Write an hex file
-		void writeHex(const std::string &fileName, bool reset, bool simple);
+		//! Pages of an hex file, by page number
+		typedef std::map<uint32, std::vector<uint8> > PageMap;
+		
+		//! Split the content of hexFile into pages of pageSize bytes, padded with 0
+		static void buildPageMap(const HexFile& hexFile, unsigned pageSize, PageMap& pageMap);
+		
+		//! Write pages using chunks, keeping up to pagesInFlight pages unacknowledged, throw an Error on failure
+		void writePagesPipelined(const PageMap& pageMap);
+		
+		//! Remove from pageMap the pages that are identical in flash
+		void removeUnchangedPages(PageMap& pageMap);
+		
+		//! Write an hex file, if diff is true, only write the pages that changed (not available with the simplified protocol)
+		void writeHex(const std::string &fileName, bool reset, bool simple, bool diff = false);
 		
 		//! Read an hex file and write it to fileName
 		void readHex(const std::string &fileName);
 		
 	protected:
+		//! Wait for an acknowledgement from the bootloader, return whether it reports a success
+		bool waitAck();
+		
+		//! Get the hashes of pagesCount pages starting at firstPage from the bootloader
+		void getPagesHash(unsigned firstPage, unsigned pagesCount, std::vector<uint32>& hashes);
+		
 		// reporting function
 		
 		// progress
@@ -88,6 +115,7 @@ namespace Aseba
 		virtual void writeHexStart(const std::string &fileName, bool reset, bool simple) {}
 		virtual void writeHexEnteringBootloader() {}
 		virtual void writeHexGotDescription(unsigned pagesCount) {}
+		virtual void writeHexPagesCompared(unsigned unchangedCount, unsigned changedCount) {}
 		virtual void writeHexWritten() {}
 		virtual void writeHexExitingBootloader() {}
 		
@@ -103,6 +131,9 @@ namespace Aseba
 		unsigned pageSize;
 		unsigned pagesStart;
 		unsigned pagesCount;
+		unsigned dataChunkSize; //!< maximum size of data in chunks, 0 if the bootloader does not support them
+		unsigned pagesInFlight; //!< number of pages the bootloader accepts before acknowledging the first one
+		unsigned flags; //!< optional features of the bootloader, see BootloaderDescription::Flags
 	};
 } // namespace Aseba
 
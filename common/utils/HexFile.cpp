@@ -26,7 +26,7 @@
 #include <iomanip>
 #include <cassert>
 #include <algorithm>
-#include <valarray>
+#include <cctype>
 
 namespace Aseba
 {
@@ -55,169 +55,132 @@ namespace Aseba
 		return FormatableString("Can't open file %0").arg(fileName);
 	}
 	
-	unsigned HexFile::getUint4(std::istream &stream)
+	//! Value of hexadecimal digits, or 0xff for other characters
+	static uint8 hexDigitValues[256];
+	
+	//! Fill hexDigitValues before main() runs
+	static struct HexDigitValuesInitializer
 	{
-		int c = stream.get();
-		if (c <= '9')
-			return c - '0';
-		else if (c <= 'F')
-			return c - 'A' + 10;
-		else
-			return c - 'a' + 10;
-	}
+		HexDigitValuesInitializer()
+		{
+			for (unsigned i = 0; i < 256; ++i)
+				hexDigitValues[i] = 0xff;
+			for (unsigned i = 0; i < 10; ++i)
+				hexDigitValues['0' + i] = i;
+			for (unsigned i = 0; i < 6; ++i)
+			{
+				hexDigitValues['A' + i] = 10 + i;
+				hexDigitValues['a' + i] = 10 + i;
+			}
+		}
+	} hexDigitValuesInitializer;
+	
+	static const char hexDigits[] = "0123456789ABCDEF";
 	
-	unsigned HexFile::getUint8(std::istream &stream)
+	//! Decode count bytes from pairs of hexadecimal digits at text to bytes, return false if a character is not an hexadecimal digit
+	static bool decodeHex(const char *text, size_t count, uint8 *bytes)
 	{
-		return (getUint4(stream) << 4) | getUint4(stream);
+		uint8 invalid(0);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint8 high(hexDigitValues[uint8(text[2*i])]);
+			const uint8 low(hexDigitValues[uint8(text[2*i+1])]);
+			invalid |= high | low;
+			bytes[i] = (high << 4) | low;
+		}
+		return (invalid & 0xf0) == 0;
 	}
 	
-	unsigned HexFile::getUint16(std::istream &stream)
+	//! Append value as two hexadecimal digits to buffer
+	static void appendHex(std::string &buffer, uint8 value)
 	{
-		return (getUint8(stream) << 8) | getUint8(stream);
+		buffer += hexDigits[value >> 4];
+		buffer += hexDigits[value & 0xf];
 	}
 	
 	void HexFile::read(const std::string &fileName)
 	{
-		std::ifstream ifs(fileName.c_str());
-		
-		if (ifs.bad())
+		// read the whole file at once, then parse it in memory
+		std::ifstream ifs(fileName.c_str(), std::ios::binary);
+		if (!ifs)
 			throw FileOpeningError(fileName);
+		std::vector<char> text;
+		ifs.seekg(0, std::ios::end);
+		const std::streamoff fileSize(ifs.tellg());
+		ifs.seekg(0, std::ios::beg);
+		if (fileSize > 0)
+		{
+			text.resize(size_t(fileSize));
+			ifs.read(&text[0], text.size());
+			text.resize(size_t(ifs.gcount()));
+		}
 		
+		const char *pos(text.empty() ? 0 : &text[0]);
+		const char *const end(pos + text.size());
 		int lineCounter = 0;
 		uint32 baseAddress = 0;
+		uint8 record[5 + 255];
 		
-		while (ifs.good())
+		while (true)
 		{
+			// skip line ends and spaces between records
+			while ((pos != end) && isspace(uint8(*pos)))
+				++pos;
+			if (pos == end)
+				break;
+			
 			// leading ":" character
-			char c;
-			ifs >> c;
-			if (c != ':')
+			if (*pos != ':')
 				throw InvalidRecord(lineCounter);
+			++pos;
 			
-			uint8 computedCheckSum = 0;
-			
-			// record data length
-			uint8 dataLength = getUint8(ifs);
-			computedCheckSum += dataLength;
+			// record data length, then short address, record type, data and checksum
+			if ((end - pos < 2) || !decodeHex(pos, 1, record))
+				throw InvalidRecord(lineCounter);
+			const uint8 dataLength(record[0]);
+			const size_t recordLength(5 + dataLength);
+			if (size_t(end - pos) < 2 * recordLength)
+				throw EarlyEOF(lineCounter);
+			if (!decodeHex(pos, recordLength, record))
+				throw InvalidRecord(lineCounter);
+			pos += 2 * recordLength;
 			
-			// short address
-			uint16 lowAddress = getUint16(ifs);
-			computedCheckSum += lowAddress;
-			computedCheckSum += lowAddress >> 8;
+			// verify checksum
+			uint8 computedCheckSum = 0;
+			for (size_t i = 0; i < recordLength - 1; ++i)
+				computedCheckSum += record[i];
+			computedCheckSum = 1 + ~computedCheckSum;
+			const uint8 checkSum(record[recordLength - 1]);
+			if (checkSum != computedCheckSum)
+				throw WrongCheckSum(lineCounter, checkSum, computedCheckSum);
 			
-			// record type
-			uint8 recordType = getUint8(ifs);
-			computedCheckSum += recordType;
+			const uint16 lowAddress((uint16(record[1]) << 8) | record[2]);
+			const uint8 recordType(record[3]);
+			const uint8 *recordData(record + 4);
 			
 			switch (recordType)
 			{
 				case 0:
 				// data record
-				{
-					// read data
-					std::vector<uint8> recordData;
-					for (int i = 0; i != dataLength; i++)
-					{
-						uint8 d = getUint8(ifs);
-						computedCheckSum += d;
-						recordData.push_back(d);
-						//std::cout << "data " << std::hex << (unsigned)d << "\n";
-					}
-					
-					// verify checksum
-					uint8 checkSum = getUint8(ifs);
-					computedCheckSum = 1 + ~computedCheckSum;
-					if (checkSum != computedCheckSum)
-						throw WrongCheckSum(lineCounter, checkSum, computedCheckSum);
-					
-					// compute address
-					uint32 address = lowAddress;
-					address += baseAddress;
-					//std::cout << "data record at address 0x" << std::hex << address << "\n";
-					
-					// is some place to add
-					bool found = false;
-					for (ChunkMap::iterator it = data.begin(); it != data.end(); ++it)
-					{
-						size_t chunkSize = it->second.size();
-						if (address == it->first + chunkSize)
-						{
-							// copy new
-							std::copy(recordData.begin(), recordData.end(), std::back_inserter(it->second));
-							found = true;
-							//std::cout << "tail fusable chunk found\n";
-							break;
-						}
-						else if (address + recordData.size() == it->first)
-						{
-							// resize
-							it->second.resize(chunkSize + recordData.size());
-							// move
-							std::copy_backward(it->second.begin(), it->second.begin() + chunkSize, it->second.end());
-							// copy new
-							std::copy(recordData.begin(), recordData.end(), it->second.begin());
-							found = true;
-							//std::cout << "head fusable chunk found\n";
-							break;
-						}
-					}
-					if (!found)
-						data[address] = recordData;
-				}
+				addData(baseAddress + lowAddress, recordData, dataLength);
 				break;
 				
 				case 1:
 				// end of file record
-				for (ChunkMap::iterator it = data.begin(); it != data.end(); ++it)
-				{
-					//std::cout << "End of file found. Address " << it->first << " size " << it->second.size() << "\n";
-				}
-				ifs.close();
 				return;
-				break;
 				
 				case 2:
 				// extended segment address record
-				{
-					if (dataLength != 2)
-						throw InvalidRecord(lineCounter);
-					
-					// read data
-					uint16 highAddress = getUint16(ifs);
-					computedCheckSum += highAddress;
-					computedCheckSum += highAddress >> 8;
-					baseAddress = highAddress;
-					baseAddress <<= 4;
-					//std::cout << "Extended segment address record (?!): 0x" << std::hex << baseAddress << "\n";
-					
-					// verify checksum
-					uint8 checkSum = getUint8(ifs);
-					computedCheckSum = 1 + ~computedCheckSum;
-					if (checkSum != computedCheckSum)
-						throw WrongCheckSum(lineCounter, checkSum, computedCheckSum);
-				}
+				if (dataLength != 2)
+					throw InvalidRecord(lineCounter);
+				baseAddress = ((uint32(recordData[0]) << 8) | recordData[1]) << 4;
 				break;
 				
 				case 4:
 				// extended linear address record
-				{
-					if (dataLength != 2)
-						throw InvalidRecord(lineCounter);
-					
-					// read data
-					uint16 highAddress = getUint16(ifs);
-					computedCheckSum += highAddress;
-					computedCheckSum += highAddress >> 8;
-					baseAddress = highAddress;
-					baseAddress <<= 16;
-					//std::cout << "Linear address record: 0x" << std::hex << baseAddress << "\n";
-					
-					// verify checksum
-					uint8 checkSum = getUint8(ifs);
-					computedCheckSum = 1 + ~computedCheckSum;
-					if (checkSum != computedCheckSum)
-						throw WrongCheckSum(lineCounter, checkSum, computedCheckSum);
-				}
+				if (dataLength != 2)
+					throw InvalidRecord(lineCounter);
+				baseAddress = ((uint32(recordData[0]) << 8) | recordData[1]) << 16;
 				break;
 				
 				default:
@@ -231,108 +194,126 @@ namespace Aseba
 		throw EarlyEOF(lineCounter);
 	}
 	
-	void HexFile::writeExtendedLinearAddressRecord(std::ofstream &stream, unsigned addr16) const
+	void HexFile::addData(uint32 address, const uint8 *bytes, size_t count)
+	{
+		if (count == 0)
+			return;
+		
+		// find the chunk containing or ending at address, or create one
+		ChunkMap::iterator chunk(data.upper_bound(address));
+		if (chunk != data.begin())
+		{
+			ChunkMap::iterator previous(chunk);
+			--previous;
+			if (previous->first + previous->second.size() >= address)
+				chunk = previous;
+			else
+				chunk = data.insert(chunk, std::make_pair(address, std::vector<uint8>()));
+		}
+		else
+			chunk = data.insert(chunk, std::make_pair(address, std::vector<uint8>()));
+		
+		// write the bytes into it
+		std::vector<uint8> &chunkData(chunk->second);
+		const size_t offset(address - chunk->first);
+		if (chunkData.size() < offset + count)
+			chunkData.resize(offset + count);
+		std::copy(bytes, bytes + count, chunkData.begin() + offset);
+		
+		// absorb the following chunks that it now overlaps or touches, keeping the new bytes
+		ChunkMap::iterator next(chunk);
+		++next;
+		while ((next != data.end()) && (next->first <= chunk->first + chunkData.size()))
+		{
+			const size_t nextOffset(next->first - chunk->first);
+			if (nextOffset + next->second.size() > chunkData.size())
+				chunkData.insert(chunkData.end(), next->second.begin() + (chunkData.size() - nextOffset), next->second.end());
+			data.erase(next++);
+		}
+	}
+	
+	void HexFile::buildPages(unsigned pageSize, PageMap &pages, uint8 fill) const
+	{
+		for (ChunkMap::const_iterator it = data.begin(); it != data.end(); ++it)
+		{
+			uint32 address(it->first);
+			std::vector<uint8>::const_iterator source(it->second.begin());
+			const std::vector<uint8>::const_iterator sourceEnd(it->second.end());
+			
+			// copy page by page, pages come in increasing order so they are appended at the end of the map
+			while (source != sourceEnd)
+			{
+				const uint32 pageIndex(address / pageSize);
+				const unsigned byteIndex(address % pageSize);
+				PageMap::iterator page(pages.end());
+				if (pages.empty() || ((--page)->first != pageIndex))
+					page = pages.insert(pages.end(), std::make_pair(pageIndex, std::vector<uint8>(pageSize, fill)));
+				
+				const unsigned amountToCopy(std::min<size_t>(pageSize - byteIndex, sourceEnd - source));
+				std::copy(source, source + amountToCopy, page->second.begin() + byteIndex);
+				source += amountToCopy;
+				address += amountToCopy;
+			}
+		}
+	}
+	
+	void HexFile::writeExtendedLinearAddressRecord(std::string &buffer, unsigned addr16) const
 	{
 		assert(addr16 <= 65535);
 		
-		uint8 checkSum = 0;
+		uint8 checkSum = 0x02 + 0x04;
 		
-		stream << ":02000004";
-		checkSum += 0x02;
-		checkSum += 0x00;
-		checkSum += 0x00;
-		checkSum += 0x04;
+		buffer += ":02000004";
 		
-		stream << std::setw(2);
-		stream << (addr16 >> 8);
+		appendHex(buffer, addr16 >> 8);
 		checkSum += (addr16 >> 8);
 		
-		stream << std::setw(2);
-		stream << (addr16 & 0xFF);
+		appendHex(buffer, addr16 & 0xFF);
 		checkSum += (addr16 & 0xFF);
 		
 		checkSum = (~checkSum) + 1;
-		stream << std::setw(2);
-		stream << (unsigned)checkSum;
+		appendHex(buffer, checkSum);
 		
-		stream << "\n";
+		buffer += '\n';
 	}
 	
-	void HexFile::writeData(std::ofstream &stream, unsigned addr16, unsigned count8, uint8 *data) const
+	void HexFile::writeData(std::string &buffer, unsigned addr16, unsigned count8, const uint8 *data) const
 	{
 		assert(addr16 <= 65535);
 		assert(count8 <= 255);
 		
 		uint8 checkSum = 0;
 		
-		stream << ":";
+		buffer += ':';
 		
-		stream << std::setw(2);
-		stream << count8;
+		appendHex(buffer, count8);
 		checkSum += count8;
 		
-		stream << std::setw(2);
-		stream << (addr16 >> 8);
+		appendHex(buffer, addr16 >> 8);
 		checkSum += (addr16 >> 8);
 		
-		stream << std::setw(2);
-		stream << (addr16 & 0xFF);
+		appendHex(buffer, addr16 & 0xFF);
 		checkSum += (addr16 & 0xFF);
 		
-		stream << "00";
-		checkSum += 0x00;
+		buffer += "00";
 		
 		for (unsigned i = 0; i < count8; i++)
 		{
-			stream << std::setw(2);
-			stream << (unsigned)data[i];
+			appendHex(buffer, data[i]);
 			checkSum += data[i];
 		}
 		
 		checkSum = (~checkSum) + 1;
-		stream << std::setw(2);
-		stream << (unsigned)checkSum;
+		appendHex(buffer, checkSum);
 		
-		stream << "\n";
+		buffer += '\n';
 	}
-
+	
 	void HexFile::strip(unsigned pageSize)
 	{
-		// Build a page map.
-		typedef std::map<uint32, std::vector<uint8> > PageMap;
+		// Build a page map, new pages are uninitialized
 		PageMap pageMap;
-		for (ChunkMap::iterator it = data.begin(); it != data.end(); it ++)
-		{
-			// get page number
-			unsigned chunkAddress = it->first;
-			// index inside data chunk
-			unsigned chunkDataIndex = 0;
-			// size of chunk in bytes
-			unsigned chunkSize = it->second.size();
-
-			// copy data from chunk to page
-			do
-			{
-				// get page number
-				unsigned pageIndex = (chunkAddress + chunkDataIndex) / pageSize;
-				// get address inside page
-				unsigned byteIndex = (chunkAddress + chunkDataIndex) % pageSize;
-
-				// if page does not exists, create it
-				if (pageMap.find(pageIndex) == pageMap.end())
-				{
-				//      std::cout << "New page N° " << pageIndex << " for address 0x" << std::hex << chunkAddress << endl;
-					pageMap[pageIndex] = std::vector<uint8>(pageSize, (uint8)0xFF); // New page is created uninitialized
-				}
-				// copy data
-				unsigned amountToCopy = std::min(pageSize - byteIndex, chunkSize - chunkDataIndex);
-				copy(it->second.begin() + chunkDataIndex, it->second.begin() + chunkDataIndex + amountToCopy, pageMap[pageIndex].begin() + byteIndex);
-
-				// increment chunk data pointer
-				chunkDataIndex += amountToCopy;
-			}
-			while (chunkDataIndex < chunkSize);
-		}
+		buildPages(pageSize, pageMap, 0xFF);
 		
 		// Now, for each page, drop it if empty
 		data.clear();
@@ -347,24 +328,23 @@ namespace Aseba
 					break;
 				}
 			if(!isempty)
-				data[it->first * pageSize] = it->second;
+				data.insert(data.end(), std::make_pair(it->first * pageSize, it->second));
 		}
-
-
+		
+		
 	}
 	
 	void HexFile::write(const std::string &fileName) const
 	{
 		int first = 1;
 		unsigned highAddress = 0;
-		std::ofstream ofs(fileName.c_str());
+		std::ofstream ofs(fileName.c_str(), std::ios::binary);
 		
 		if (ofs.bad())
 			throw FileOpeningError(fileName);
 		
-		// set format
-		ofs.flags(std::ios::hex | std::ios::uppercase);
-		ofs.fill('0');
+		// format all records in memory, then write them at once
+		std::string buffer;
 		
 		// for each chunk
 		for (ChunkMap::const_iterator it = data.begin(); it != data.end(); it++)
@@ -372,22 +352,21 @@ namespace Aseba
 			// split address
 			unsigned address = it->first;
 			unsigned amount = it->second.size();
+			buffer.reserve(buffer.size() + (amount / 16 + 1) * 44);
 			
 			for (unsigned count = 0; count < amount;)
 			{
 				// check if we have changed 64 K boundary, if so, write new high address
 				unsigned newHighAddress = (address + count) >> 16;
 				if (newHighAddress != highAddress || first)
-					writeExtendedLinearAddressRecord(ofs, newHighAddress);
+					writeExtendedLinearAddressRecord(buffer, newHighAddress);
 				first = 0;
 				highAddress = newHighAddress;
 				
 				// write data
 				unsigned rowCount = std::min(amount - count, (unsigned)16);
 				unsigned lowAddress = (address + count) & 0xFFFF;
-				std::valarray<uint8> buffer(rowCount);
-				std::copy(it->second.begin() + count, it->second.begin() + count + rowCount, &buffer[0]);
-				writeData(ofs, lowAddress, rowCount , &buffer[0]);
+				writeData(buffer, lowAddress, rowCount, &it->second[count]);
 				
 				// increment counters
 				count += rowCount;
@@ -395,7 +374,7 @@ namespace Aseba
 		}
 		
 		// write EOF
-		ofs << ":00000001FF";
+		buffer += ":00000001FF";
+		ofs.write(buffer.data(), buffer.size());
 	}
 }
-
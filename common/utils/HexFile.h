@@ -86,20 +86,26 @@ namespace Aseba
 		};
 		
 	public:
+		//! Contiguous data by start address, chunks added through addData neither overlap nor touch, so that merging is O(log n)
 		typedef std::map<uint32, std::vector<uint8> > ChunkMap;
 		ChunkMap data;
+		
+		//! Pages of data by page number
+		typedef std::map<uint32, std::vector<uint8> > PageMap;
 
 	public:
 		void read(const std::string &fileName);
 		void write(const std::string &fileName) const;
 		void strip(unsigned pageSize);
+		
+		//! Add count bytes at address, overwriting existing data and merging with neighbouring chunks
+		void addData(uint32 address, const uint8 *bytes, size_t count);
+		//! Split data into pages of pageSize bytes, the bytes without data being set to fill
+		void buildPages(unsigned pageSize, PageMap &pages, uint8 fill) const;
 	
 	protected:
-		unsigned getUint4(std::istream &stream);
-		unsigned getUint8(std::istream &stream);
-		unsigned getUint16(std::istream &stream);
-		void writeExtendedLinearAddressRecord(std::ofstream &stream, unsigned addr16) const;
-		void writeData(std::ofstream &stream, unsigned addr16, unsigned count8, uint8 *data) const;
+		void writeExtendedLinearAddressRecord(std::string &buffer, unsigned addr16) const;
+		void writeData(std::string &buffer, unsigned addr16, unsigned count8, const uint8 *data) const;
 	};
 }
 
@@ -125,6 +125,26 @@ namespace Aseba
 		stream << " ";
 	}
 	
+	uint32 monotonicMicroseconds()
+	{
+		#ifndef WIN32
+		#ifdef CLOCK_MONOTONIC
+		struct timespec ts;
+		if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+			return uint32(uint64(ts.tv_sec) * 1000000 + uint64(ts.tv_nsec) / 1000);
+		#endif // CLOCK_MONOTONIC
+		// no monotonic clock, fall back to the time of the day
+		struct timeval tv;
+		gettimeofday(&tv, NULL);
+		return uint32(uint64(tv.tv_sec) * 1000000 + uint64(tv.tv_usec));
+		#else // WIN32
+		LARGE_INTEGER counter, frequency;
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+		return uint32((counter.QuadPart / frequency.QuadPart) * 1000000 + ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+		#endif // WIN32
+	}
+	
 	std::string WStringToUTF8(const std::wstring& s)
 	{
 		std::string os;
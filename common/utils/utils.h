@@ -110,6 +110,9 @@ namespace Aseba
 	//! Dump the current time to a stream
 	void dumpTime(std::ostream &stream, bool raw = false);
 	
+	//! Return a monotonic time in microseconds, wrapping around every 71 minutes, to measure short durations
+	uint32 monotonicMicroseconds();
+	
 	//! Transform a wstring into an UTF8 string, this function is thread-safe
 	std::string WStringToUTF8(const std::wstring& s);
 	
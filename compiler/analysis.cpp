@@ -63,6 +63,10 @@ namespace Aseba
 						pc += 3;
 					break;
 					
+					case ASEBA_BYTECODE_NATIVE_CALL:
+						pc += bytecode[pc].getWordSize();
+					break;
+					
 					default:
 						pc += 1;
 					break;
@@ -113,6 +117,10 @@ namespace Aseba
 							pc += 3;
 						break;
 						
+						case ASEBA_BYTECODE_NATIVE_CALL:
+							pc += bytecode[pc].getWordSize();
+						break;
+						
 						default:
 							pc += 1;
 						break;
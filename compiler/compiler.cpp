@@ -105,6 +105,12 @@ namespace Aseba
 			case ASEBA_BYTECODE_EMIT:
 			return 3;
 			
+			case ASEBA_BYTECODE_NATIVE_CALL:
+			if (bytecode & (1 << ASEBA_NATIVE_CALL_ARGS_BLOCK_BIT))
+				return 1 + ((bytecode >> ASEBA_NATIVE_CALL_ARGS_COUNT_SHIFT) & ASEBA_NATIVE_CALL_ARGS_COUNT_MASK);
+			else
+				return 1;
+			
 			default:
 			return 1;
 		}
@@ -565,8 +571,20 @@ namespace Aseba
 				break;
 				
 				case ASEBA_BYTECODE_NATIVE_CALL:
-				dump << "CALL " << (bytecode[pc] & 0x0fff) << "\n";
-				pc++;
+				if (bytecode[pc] & (1 << ASEBA_NATIVE_CALL_ARGS_BLOCK_BIT))
+				{
+					const unsigned argsCount = bytecode[pc].getWordSize() - 1;
+					dump << "CALL " << (bytecode[pc] & ASEBA_NATIVE_CALL_ARGS_ID_MASK) << " args";
+					for (unsigned i = 1; i <= argsCount; i++)
+						dump << " " << bytecode[pc+i].bytecode;
+					dump << "\n";
+					pc += 1 + argsCount;
+				}
+				else
+				{
+					dump << "CALL " << (bytecode[pc] & 0x0fff) << "\n";
+					pc++;
+				}
 				break;
 				
 				case ASEBA_BYTECODE_SUB_CALL:
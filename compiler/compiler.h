@@ -101,12 +101,13 @@ namespace Aseba
 		unsigned bytecodeSize; //!< total amount of bytecode space
 		unsigned variablesSize; //!< total amount of variables space
 		unsigned stackSize; //!< depth of execution stack
+		bool nativeCallArgsBlocks; //!< whether the VM reads constant arguments of native calls following the call in bytecode, see ASEBA_NATIVE_CALL_ARGS_BLOCK_BIT; groundwork: not part of the description messages until a protocol version can advertise it, so no host sets it and it is only exercised by asebatest
 		
 		std::vector<NamedVariable> namedVariables; //!< named variables
 		std::vector<LocalEvent> localEvents; //!< events available locally on target
 		std::vector<NativeFunction> nativeFunctions; //!< native functions
 		
-		TargetDescription() { variablesSize = bytecodeSize = stackSize = 0; }
+		TargetDescription() { variablesSize = bytecodeSize = stackSize = 0; nativeCallArgsBlocks = false; }
 		uint16 crc() const;
 		VariablesMap getVariablesMap(unsigned& freeVariableIndex) const;
 		FunctionsMap getFunctionsMap() const;
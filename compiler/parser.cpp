@@ -1370,7 +1370,7 @@ namespace Aseba
 		FunctionsMap::const_iterator funcIt(findFunction(funcName, pos));
 		
 		const TargetDescription::NativeFunction &function = targetDescription->nativeFunctions[funcIt->second];
-		std::auto_ptr<CallNode> callNode(new CallNode(pos, funcIt->second));
+		std::auto_ptr<CallNode> callNode(new CallNode(pos, funcIt->second, targetDescription->nativeCallArgsBlocks));
 		
 		tokens.pop_front();
 		
@@ -217,9 +217,10 @@ namespace Aseba
 	}
 	
 	//! Constructor
-	CallNode::CallNode(const SourcePos& sourcePos, unsigned funcId) :
+	CallNode::CallNode(const SourcePos& sourcePos, unsigned funcId, bool argsBlock) :
 		Node(sourcePos),
-		funcId(funcId)
+		funcId(funcId),
+		argsBlock(argsBlock)
 	{
 	
 	}
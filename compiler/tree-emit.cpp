@@ -466,8 +466,45 @@ namespace Aseba
 	}
 	
 	
+	//! Return the node giving the address of a native argument if it is known at compile time, 0 otherwise
+	static const ImmediateNode* getConstantNativeArg(const Node* node)
+	{
+		// tuples are evaluated into a temporary variable by a block ending with its address
+		const BlockNode* block = dynamic_cast<const BlockNode*>(node);
+		if (block && !block->children.empty())
+			node = block->children.back();
+		return dynamic_cast<const ImmediateNode*>(node);
+	}
+	
 	void CallNode::emit(PreLinkBytecode& bytecodes) const
 	{
+		// if all arguments are known, put them after the call, in the order natives read them, instead of pushing them
+		const size_t argsCount(children.size() + templateArgs.size());
+		bool constantArgs(argsBlock && (funcId <= ASEBA_NATIVE_CALL_ARGS_ID_MASK) && (argsCount <= ASEBA_NATIVE_CALL_ARGS_COUNT_MASK));
+		for (size_t i = 0; constantArgs && i < children.size(); i++)
+			constantArgs = getConstantNativeArg(children[i]) != 0;
+		if (constantArgs)
+		{
+			// evaluate tuples
+			for (NodesVector::const_reverse_iterator it(children.rbegin()); it != children.rend(); ++it)
+			{
+				const BlockNode* block = dynamic_cast<const BlockNode*>(*it);
+				if (block)
+					for (size_t i = 0; i + 1 < block->children.size(); i++)
+						block->children[i]->emit(bytecodes);
+			}
+			
+			// generate call followed by the arguments
+			unsigned short bytecode = AsebaBytecodeFromId(ASEBA_BYTECODE_NATIVE_CALL) | (1 << ASEBA_NATIVE_CALL_ARGS_BLOCK_BIT);
+			bytecode |= (argsCount << ASEBA_NATIVE_CALL_ARGS_COUNT_SHIFT) | funcId;
+			bytecodes.current->push_back(BytecodeElement(bytecode, sourcePos.row));
+			for (size_t i = 0; i < children.size(); i++)
+				bytecodes.current->push_back(BytecodeElement(getConstantNativeArg(children[i])->value, sourcePos.row));
+			for (size_t i = 0; i < templateArgs.size(); i++)
+				bytecodes.current->push_back(BytecodeElement(templateArgs[i], sourcePos.row));
+			return;
+		}
+		
 		// generate load for template parameters in reverse order
 		int i = (int)templateArgs.size() - 1;
 		while (i >= 0)
@@ -471,8 +471,9 @@ namespace Aseba
 	{
 		unsigned funcId; //!< identifier of the function to be called
 		std::vector<unsigned> templateArgs; //!< sizes of templated arguments
+		bool argsBlock; //!< whether the target can read constant arguments following the call in bytecode
 		
-		CallNode(const SourcePos& sourcePos, unsigned funcId);
+		CallNode(const SourcePos& sourcePos, unsigned funcId, bool argsBlock);
 		virtual CallNode* shallowCopy() { return new CallNode(*this); }
 
 		virtual ReturnType typeCheck() const { return TYPE_UNIT; }
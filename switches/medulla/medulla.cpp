@@ -127,16 +127,16 @@ namespace Aseba
 		DescriptionsManager::processMessage(message);
 		
 		// if user message, send to D-Bus as well
-		UserMessage *userMessage = dynamic_cast<UserMessage *>(message);
-		if (userMessage)
+		if (message->isUserMessage())
 		{
+			UserMessage *userMessage = static_cast<UserMessage *>(message);
 			sendEventOnDBus(userMessage->type, fromAsebaVector(userMessage->data));
 		}
 		
 		// if variables, check for pending answers
-		Variables *variables = dynamic_cast<Variables *>(message);
-		if (variables)
+		if (message->type == ASEBA_MESSAGE_VARIABLES)
 		{
+			Variables *variables = static_cast<Variables *>(message);
 			const unsigned nodeId(variables->source);
 			const unsigned pos(variables->start);
 			for (RequestsList::iterator it = pendingReads.begin(); it != pendingReads.end(); ++it)
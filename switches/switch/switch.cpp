@@ -67,7 +67,7 @@ namespace Aseba
 	
 	void Switch::incomingData(Stream *stream)
 	{
-		Message* message(Message::receive(stream));
+		Message* message(messagePool.receive(stream));
 		
 		// remap source
 		{
@@ -85,13 +85,32 @@ namespace Aseba
 			std::wcout << std::endl;
 		}
 		
-		// write on all connected streams
-		CmdMessage* cmdMessage(dynamic_cast<CmdMessage*>(message));
+		// scan this message for nodes descriptions, remembering through which stream nodes are reachable
+		if ((message->type == ASEBA_MESSAGE_DESCRIPTION) || (message->type == ASEBA_MESSAGE_DESCRIPTION_HASH))
+			nodesStreams[message->source] = stream;
+		DescriptionsManager::processMessage(message);
+		
+		// if we know all descriptions, answer ourself and only ask nodes for their hashes, to discover new nodes cheaply;
+		// if some are still being received, let the nodes answer the full request
+		if (message->type == ASEBA_MESSAGE_GET_DESCRIPTION && knownDescriptionsComplete() && sendKnownDescriptions(stream))
+		{
+			GetDescriptionHash getDescriptionHash;
+			sendMessage(&getDescriptionHash, stream);
+			return;
+		}
+		
+		sendMessage(message, stream);
+	}
+	
+	void Switch::sendMessage(Message* message, Stream* sourceStream)
+	{
+		// write on all connected streams, only look for a command message if there is any id to remap
+		CmdMessage* cmdMessage(idRemapTable.empty() ? 0 : dynamic_cast<CmdMessage*>(message));
 		for (StreamsSet::iterator it = dataStreams.begin(); it != dataStreams.end();++it)
 		{
 			Stream* destStream = *it;
 			
-			if ((forward) && (destStream == stream))
+			if ((forward) && (destStream == sourceStream))
 				continue;
 			
 			try
@@ -120,8 +139,101 @@ namespace Aseba
 				std::cerr << "error while writing" << std::endl;
 			}
 		}
+	}
+	
+	bool Switch::knownDescriptionsComplete() const
+	{
+		// nodes whose hash was unknown have not sent their description yet
+		if (!pendingCacheKeys.empty())
+			return false;
 		
-		delete message;
+		for (NodesDescriptionsMap::const_iterator it = nodesDescriptions.begin(); it != nodesDescriptions.end(); ++it)
+		{
+			const NodeDescription& nodeDescription(it->second);
+			if ((nodeDescription.namedVariablesReceptionCounter != nodeDescription.namedVariables.size()) ||
+				(nodeDescription.localEventsReceptionCounter != nodeDescription.localEvents.size()) ||
+				(nodeDescription.nativeFunctionReceptionCounter != nodeDescription.nativeFunctions.size())
+			)
+				return false;
+		}
+		return true;
+	}
+	
+	bool Switch::sendKnownDescriptions(Stream* stream)
+	{
+		bool sent(false);
+		try
+		{
+			for (NodesDescriptionsMap::const_iterator it = nodesDescriptions.begin(); it != nodesDescriptions.end(); ++it)
+			{
+				const NodeDescription& nodeDescription(it->second);
+				
+				// only replay descriptions that were completely received
+				if ((nodeDescription.namedVariablesReceptionCounter != nodeDescription.namedVariables.size()) ||
+					(nodeDescription.localEventsReceptionCounter != nodeDescription.localEvents.size()) ||
+					(nodeDescription.nativeFunctionReceptionCounter != nodeDescription.nativeFunctions.size())
+				)
+					continue;
+				
+				// send the same sequence of messages as the node would
+				Description description;
+				static_cast<TargetDescription&>(description) = nodeDescription;
+				description.source = it->first;
+				description.serialize(stream);
+				for (size_t i = 0; i < nodeDescription.namedVariables.size(); ++i)
+				{
+					NamedVariableDescription namedVariableDescription;
+					static_cast<TargetDescription::NamedVariable&>(namedVariableDescription) = nodeDescription.namedVariables[i];
+					namedVariableDescription.source = it->first;
+					namedVariableDescription.serialize(stream);
+				}
+				for (size_t i = 0; i < nodeDescription.localEvents.size(); ++i)
+				{
+					LocalEventDescription localEventDescription;
+					static_cast<TargetDescription::LocalEvent&>(localEventDescription) = nodeDescription.localEvents[i];
+					localEventDescription.source = it->first;
+					localEventDescription.serialize(stream);
+				}
+				for (size_t i = 0; i < nodeDescription.nativeFunctions.size(); ++i)
+				{
+					NativeFunctionDescription nativeFunctionDescription;
+					static_cast<TargetDescription::NativeFunction&>(nativeFunctionDescription) = nodeDescription.nativeFunctions[i];
+					nativeFunctionDescription.source = it->first;
+					nativeFunctionDescription.serialize(stream);
+				}
+				// then its hash, so that the client can cache the description and recognise the answers to our hash request
+				if (nodeDescription.crcKnown)
+				{
+					DescriptionHash descriptionHash;
+					descriptionHash.source = it->first;
+					descriptionHash.name = nodeDescription.name;
+					descriptionHash.protocolVersion = nodeDescription.protocolVersion;
+					descriptionHash.crc = nodeDescription.crc;
+					descriptionHash.serialize(stream);
+				}
+				sent = true;
+			}
+			stream->flush();
+		}
+		catch (DashelException e)
+		{
+			// if this stream has a problem, ignore it for now, and let Hub call connectionClosed later.
+			std::cerr << "error while writing" << std::endl;
+		}
+		
+		if (sent && verbose)
+		{
+			dumpTime(cout, rawTime);
+			cout << "Answered description request from " << stream->getTargetName() << " with known descriptions" << endl;
+		}
+		return sent;
+	}
+	
+	void Switch::nodeDescriptionHashUnknown(unsigned nodeId)
+	{
+		// a node we do not know answered to our hash request, ask it for its description
+		GetNodeDescription getNodeDescription(nodeId);
+		sendMessage(&getNodeDescription, 0);
 	}
 	
 	void Switch::connectionClosed(Stream *stream, bool abnormal)
@@ -134,6 +246,20 @@ namespace Aseba
 			else
 				cout << "Normal connection closed to " << stream->getTargetName() << endl;
 		}
+		
+		// forget the descriptions of the nodes that were reachable through this stream
+		for (NodesStreamsTable::iterator it = nodesStreams.begin(); it != nodesStreams.end();)
+		{
+			if (it->second == stream)
+			{
+				Disconnected disconnected;
+				disconnected.source = it->first;
+				processDisconnected(&disconnected);
+				nodesStreams.erase(it++);
+			}
+			else
+				++it;
+		}
 	}
 	
 	void Switch::broadcastDummyUserMessage()
@@ -24,6 +24,8 @@
 #include <dashel/dashel.h>
 #include <map>
 #include "../../common/types.h"
+#include "../../common/msg/msg.h"
+#include "../../common/msg/descriptions-manager.h"
 
 namespace Aseba
 {
@@ -34,8 +36,9 @@ namespace Aseba
 
 	/*!
 		Route Aseba messages on the TCP part of the network.
+		Keep the descriptions of the nodes, to answer to the description requests of new clients without involving the nodes.
 	*/
-	class Switch: public Dashel::Hub
+	class Switch: public Dashel::Hub, public DescriptionsManager
 	{
 		public:
 			/*! Creates the switch, listen to TCP on port.
@@ -65,6 +68,24 @@ namespace Aseba
 			virtual void connectionCreated(Dashel::Stream *stream);
 			virtual void incomingData(Dashel::Stream *stream);
 			virtual void connectionClosed(Dashel::Stream *stream, bool abnormal);
+			
+			// from DescriptionsManager
+			virtual void nodeDescriptionHashUnknown(unsigned nodeId);
+			
+			/*! Send a message to all connected streams, remapping node ids if required.
+				@param message the message to send
+				@param sourceStream the stream the message was received from, if any
+			*/
+			void sendMessage(Message* message, Dashel::Stream* sourceStream);
+			
+			/*! Return whether the descriptions of all known nodes were completely received. */
+			bool knownDescriptionsComplete() const;
+			
+			/*! If the description of some nodes is known, send them to stream.
+				@param stream the stream of the client requesting the descriptions
+				@return whether any description was sent
+			*/
+			bool sendKnownDescriptions(Dashel::Stream* stream);
 
 		private:
 			bool verbose; //!< should we print a notification on each message
@@ -77,6 +98,12 @@ namespace Aseba
 			//! A table allowing to remap the aseba node id of streams
 			typedef std::map<Dashel::Stream*, IdPair> IdRemapTable;
 			IdRemapTable idRemapTable; //!< table for remapping id
+			
+			//! A table giving the stream through which the description of each node was received
+			typedef std::map<unsigned, Dashel::Stream*> NodesStreamsTable;
+			NodesStreamsTable nodesStreams; //!< streams of known nodes, to forget their descriptions once disconnected
+			
+			MessagePool messagePool; //!< reusable instances of received messages
 	};
 	
 	/*@}*/
@@ -208,6 +208,14 @@ namespace Enki
 			vm.variables = reinterpret_cast<sint16 *>(&variables);
 			vm.variablesSize = sizeof(variables) / sizeof(sint16);
 			
+			vm.whenStates = 0;
+			vm.eventsIndexSize = 0;
+			vm.eventQueue = 0;
+			vm.breakpointsBitmap = 0;
+			#ifdef ASEBA_VM_PROFILER
+			vm.profiler = 0;
+			#endif // ASEBA_VM_PROFILER
+			
 			port = PORT_BASE+id;
 			try
 			{
@@ -349,7 +357,7 @@ namespace Enki
 			
 			// reschedule a periodic event if we are not in step by step
 			if (AsebaMaskIsClear(vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) || AsebaMaskIsClear(vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK))
-				AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START);
+				AsebaVMQueueEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START, 0, 0, 0);
 		
 			// set physical variables
 			leftSpeed = toDoubleClamp(variables.speedL, 1, -13, 13);
@@ -26,6 +26,7 @@
 #include "../../vm/natives.h"
 #include "../../common/productids.h"
 #include "../../common/consts.h"
+#include "../../common/utils/utils.h"
 #include "../../transport/buffer/vm-buffer.h"
 #include <dashel/dashel.h>
 #include <iostream>
@@ -36,12 +37,25 @@
 
 extern AsebaVMDescription nodeDescription;
 
+#ifdef ASEBA_VM_PROFILER
+//! Monotonic time in microseconds, used as clock by the profiler of the VM
+static uint32 profilerClock()
+{
+	return Aseba::monotonicMicroseconds();
+}
+#endif // ASEBA_VM_PROFILER
+
 class AsebaNode: public Dashel::Hub
 {
 private:
 	AsebaVMState vm;
 	std::valarray<unsigned short> bytecode;
 	std::valarray<signed short> stack;
+	std::valarray<unsigned short> breakpointsBitmap;
+	#ifdef ASEBA_VM_PROFILER
+	AsebaVMProfiler profiler;
+	std::valarray<AsebaVMProfilerEntry> profilerEntries;
+	#endif // ASEBA_VM_PROFILER
 	struct Variables
 	{
 		sint16 id;
@@ -76,6 +90,21 @@ public:
 		
 		vm.variables = reinterpret_cast<sint16 *>(&variables);
 		vm.variablesSize = sizeof(variables) / sizeof(sint16);
+		
+		vm.whenStates = 0;
+		vm.eventsIndexSize = 0;
+		vm.eventQueue = 0;
+		
+		breakpointsBitmap.resize(ASEBA_VM_BREAKPOINTS_BITMAP_SIZE(vm.bytecodeSize));
+		vm.breakpointsBitmap = &breakpointsBitmap[0];
+		
+		#ifdef ASEBA_VM_PROFILER
+		profilerEntries.resize(32);
+		profiler.entriesSize = profilerEntries.size();
+		profiler.entries = &profilerEntries[0];
+		profiler.clock = profilerClock;
+		vm.profiler = &profiler;
+		#endif // ASEBA_VM_PROFILER
 	}
 	
 	void listen(int basePort, int deltaPort)
@@ -152,7 +181,7 @@ public:
 		
 		// reschedule a periodic event if we are not in step by step
 		if (AsebaMaskIsClear(vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) || AsebaMaskIsClear(vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK))
-			AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START-0);
+			AsebaVMQueueEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START-0, 0, 0, 0);
 	}
 } node;
 
@@ -205,11 +234,13 @@ extern "C" const AsebaVMDescription* AsebaGetVMDescription(AsebaVMState *vm)
 static AsebaNativeFunctionPointer nativeFunctions[] =
 {
 	ASEBA_NATIVES_STD_FUNCTIONS,
+	ASEBA_NATIVES_DSP_FUNCTIONS,
 };
 
 static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] =
 {
 	ASEBA_NATIVES_STD_DESCRIPTIONS,
+	ASEBA_NATIVES_DSP_DESCRIPTIONS,
 	0
 };
 
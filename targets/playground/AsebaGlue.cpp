@@ -33,6 +33,7 @@
 #include "PlaygroundViewer.h"
 #include "../../transport/buffer/vm-buffer.h"
 #include "../../common/utils/FormatableString.h"
+#include "../../common/utils/utils.h"
 // #include "../../vm/vm.h"
 
 
@@ -40,6 +41,55 @@ namespace Aseba
 {
 	// Mapping so that Aseba C callbacks can dispatch to the right objects
 	VMStateToEnvironment vmStateToEnvironment;
+	
+	// Sharing of bytecode between VMs running the same program
+	SharedBytecodes sharedBytecodes;
+	
+	#ifdef ASEBA_VM_PROFILER
+	uint32 profilerClock()
+	{
+		return Aseba::monotonicMicroseconds();
+	}
+	#endif // ASEBA_VM_PROFILER
+	
+	void SharedBytecodes::share(AsebaVMState* vm)
+	{
+		// the VM would write into the shared image otherwise
+		if (!vm->whenStates || sharings.find(vm) != sharings.end())
+			return;
+		
+		Sharing sharing;
+		sharing.privateBytecode = vm->bytecode;
+		sharing.image = images.insert(std::make_pair(std::vector<uint16>(vm->bytecode, vm->bytecode + vm->bytecodeSize), 0)).first;
+		sharing.image->second++;
+		sharings[vm] = sharing;
+		
+		// the VM only writes to bytecode when receiving new one, after having called unshare
+		vm->bytecode = const_cast<uint16*>(&sharing.image->first[0]);
+	}
+	
+	void SharedBytecodes::unshare(AsebaVMState* vm)
+	{
+		Sharings::iterator it(sharings.find(vm));
+		if (it == sharings.end())
+			return;
+		
+		const std::vector<uint16>& image(it->second.image->first);
+		std::copy(image.begin(), image.end(), it->second.privateBytecode);
+		vm->bytecode = it->second.privateBytecode;
+		release(vm);
+	}
+	
+	void SharedBytecodes::release(AsebaVMState* vm)
+	{
+		Sharings::iterator it(sharings.find(vm));
+		if (it == sharings.end())
+			return;
+		
+		if (--it->second.image->second == 0)
+			images.erase(it->second.image);
+		sharings.erase(it);
+	}
 
 	// SimpleDashelConnection
 
@@ -124,10 +174,19 @@ namespace Aseba
 			stream->read(&lastMessageData[0], lastMessageData.size());
 		
 			// execute event on all VM that are linked to this connection
+			const uint16 type(uint16(lastMessageData[0]) | (uint16(lastMessageData[1]) << 8));
 			for (VMStateToEnvironment::iterator it(Aseba::vmStateToEnvironment.begin()); it != vmStateToEnvironment.end(); ++it)
 			{
 				if (it.value().second == this)
+				{
+					// new bytecode is written into the private bytecode of the VM
+					if (type == ASEBA_MESSAGE_SET_BYTECODE)
+						sharedBytecodes.unshare(it.key());
 					AsebaProcessIncomingEvents(it.key());
+					// once its program runs, the VM can share it with the VMs running the same one
+					if (type == ASEBA_MESSAGE_RUN)
+						sharedBytecodes.share(it.key());
+				}
 			}
 		}
 		catch (Dashel::DashelException e)
@@ -26,6 +26,8 @@
 #include "../../vm/natives.h"
 #include <dashel/dashel.h>
 #include <valarray>
+#include <vector>
+#include <map>
 #include <QMap>
 #include <QPair>
 
@@ -54,6 +56,42 @@ namespace Aseba
 
 	extern VMStateToEnvironment vmStateToEnvironment;
 	
+	// Sharing of bytecode between VMs running the same program
+	
+	//! Program images shared by VMs running the same bytecode, so that many robots running the same program use a single copy of it.
+	//! As a shared image is read-only, the VMs must store the last results of their conditions in whenStates.
+	class SharedBytecodes
+	{
+	public:
+		//! Make vm run a shared image identical to its bytecode
+		void share(AsebaVMState* vm);
+		//! Make vm run its private bytecode again, with the content of the image it shared, so that its bytecode can be written
+		void unshare(AsebaVMState* vm);
+		//! Forget vm, which is being destroyed
+		void release(AsebaVMState* vm);
+		
+	protected:
+		//! Images with their number of users
+		typedef std::map<std::vector<uint16>, unsigned> Images;
+		//! A VM running a shared image
+		struct Sharing
+		{
+			uint16* privateBytecode; //!< the bytecode of the VM, when not shared
+			Images::iterator image; //!< the image run by the VM
+		};
+		typedef std::map<AsebaVMState*, Sharing> Sharings;
+		
+		Images images;
+		Sharings sharings;
+	};
+	
+	extern SharedBytecodes sharedBytecodes;
+	
+	#ifdef ASEBA_VM_PROFILER
+	//! Monotonic time in microseconds, used as clock by the profilers of the VMs
+	uint32 profilerClock();
+	#endif // ASEBA_VM_PROFILER
+	
 	// Implementation of the connection using Dashel
 
 	class SimpleDashelConnection: public AbstractNodeConnection, public Dashel::Hub
@@ -190,6 +190,25 @@ namespace Enki
 		vm.variables = reinterpret_cast<sint16 *>(&variables);
 		vm.variablesSize = sizeof(variables) / sizeof(sint16);
 		
+		whenStates.resize(ASEBA_VM_WHEN_STATES_SIZE(vm.bytecodeSize));
+		vm.whenStates = &whenStates[0];
+		
+		eventsIndex.resize(128);
+		vm.eventsIndex = &eventsIndex[0];
+		vm.eventsIndexSize = eventsIndex.size();
+		vm.eventQueue = 0;
+		
+		breakpointsBitmap.resize(ASEBA_VM_BREAKPOINTS_BITMAP_SIZE(vm.bytecodeSize));
+		vm.breakpointsBitmap = &breakpointsBitmap[0];
+		
+		#ifdef ASEBA_VM_PROFILER
+		profilerEntries.resize(32);
+		profiler.entriesSize = profilerEntries.size();
+		profiler.entries = &profilerEntries[0];
+		profiler.clock = profilerClock;
+		vm.profiler = &profiler;
+		#endif // ASEBA_VM_PROFILER
+		
 		AsebaVMInit(&vm);
 		
 		variables.id = id;
@@ -200,6 +219,7 @@ namespace Enki
 	
 	AsebaFeedableEPuck::~AsebaFeedableEPuck()
 	{
+		sharedBytecodes.release(&vm);
 		vmStateToEnvironment.remove(&vm);
 	}
 	
@@ -232,9 +252,9 @@ namespace Enki
 		// reschedule a IR sensors and camera events if we are not in step by step
 		if (AsebaMaskIsClear(vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) || AsebaMaskIsClear(vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK))
 		{
-			AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START);
+			AsebaVMQueueEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START, 0, 0, 0);
 			AsebaVMRun(&vm, 1000);
-			AsebaVMSetupEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START-1);
+			AsebaVMQueueEvent(&vm, ASEBA_EVENT_LOCAL_EVENTS_START-1, 0, 0, 0);
 			AsebaVMRun(&vm, 1000);
 		}
 		
@@ -56,6 +56,25 @@ namespace Enki
 		vm.variables = reinterpret_cast<sint16 *>(&variables);
 		vm.variablesSize = sizeof(variables) / sizeof(sint16);
 		
+		whenStates.resize(ASEBA_VM_WHEN_STATES_SIZE(vm.bytecodeSize));
+		vm.whenStates = &whenStates[0];
+		
+		eventsIndex.resize(128);
+		vm.eventsIndex = &eventsIndex[0];
+		vm.eventsIndexSize = eventsIndex.size();
+		vm.eventQueue = 0;
+		
+		breakpointsBitmap.resize(ASEBA_VM_BREAKPOINTS_BITMAP_SIZE(vm.bytecodeSize));
+		vm.breakpointsBitmap = &breakpointsBitmap[0];
+		
+		#ifdef ASEBA_VM_PROFILER
+		profilerEntries.resize(32);
+		profiler.entriesSize = profilerEntries.size();
+		profiler.entries = &profilerEntries[0];
+		profiler.clock = profilerClock;
+		vm.profiler = &profiler;
+		#endif // ASEBA_VM_PROFILER
+		
 		AsebaVMInit(&vm);
 		
 		variables.id = vm.nodeId;
@@ -66,6 +85,7 @@ namespace Enki
 	
 	AsebaThymio2::~AsebaThymio2()
 	{
+		sharedBytecodes.release(&vm);
 		vmStateToEnvironment.remove(&vm);
 	}
 	
@@ -38,6 +38,13 @@ namespace Enki
 		AsebaVMState vm;
 		std::valarray<unsigned short> bytecode;
 		std::valarray<signed short> stack;
+		std::valarray<unsigned short> whenStates;
+		std::valarray<unsigned short> eventsIndex;
+		std::valarray<unsigned short> breakpointsBitmap;
+		#ifdef ASEBA_VM_PROFILER
+		AsebaVMProfiler profiler;
+		std::valarray<AsebaVMProfilerEntry> profilerEntries;
+		#endif // ASEBA_VM_PROFILER
 		struct Variables
 		{
 			sint16 id;
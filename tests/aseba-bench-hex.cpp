@@ -0,0 +1,73 @@
+// Aseba
+#include "../common/utils/HexFile.h"
+using namespace Aseba;
+
+// C++
+#include <iostream>
+#include <fstream>
+#include <string>
+
+// C
+#include <stdlib.h>		// atoi()
+#include <stdio.h>		// remove()
+#include <time.h>		// clock()
+
+static double elapsed(clock_t start)
+{
+	return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned megabytes(argc > 1 ? atoi(argv[1]) : 4);
+	const std::string fileName("aseba-bench-hex.hex");
+	const unsigned pageSize(2048);
+
+	// a firmware image of several blocks, with gaps and crossing 64 K boundaries
+	HexFile image;
+	const unsigned blockSize(48 * 1024);
+	uint32 address(0x1000);
+	for (unsigned size = 0; size < megabytes * 1024 * 1024; size += blockSize)
+	{
+		std::vector<uint8> block(blockSize);
+		for (size_t i = 0; i < block.size(); ++i)
+			block[i] = uint8((address + i) * 31 + (i >> 8));
+		image.addData(address, &block[0], block.size());
+		address += blockSize + 0x1234;
+	}
+	image.write(fileName);
+
+	std::ifstream ifs(fileName.c_str(), std::ios::binary | std::ios::ate);
+	const double fileMegabytes(double(ifs.tellg()) / (1024. * 1024.));
+	ifs.close();
+
+	// parse
+	HexFile hexFile;
+	clock_t start(clock());
+	hexFile.read(fileName);
+	const double readTime(elapsed(start));
+
+	// split into pages
+	start = clock();
+	HexFile::PageMap pages;
+	hexFile.buildPages(pageSize, pages, 0xff);
+	const double pagesTime(elapsed(start));
+
+	// write back
+	start = clock();
+	hexFile.write(fileName);
+	const double writeTime(elapsed(start));
+	remove(fileName.c_str());
+
+	std::cout << "hex file: " << fileMegabytes << " MB, chunks: " << hexFile.data.size() << ", pages: " << pages.size() << std::endl;
+	std::cout << "read: " << readTime << " s (" << fileMegabytes / readTime << " MB/s)" << std::endl;
+	std::cout << "build pages: " << pagesTime << " s" << std::endl;
+	std::cout << "write: " << writeTime << " s (" << fileMegabytes / writeTime << " MB/s)" << std::endl;
+
+	if (hexFile.data != image.data)
+	{
+		std::cerr << "image did not survive the round trip" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+// Aseba
+#include "../common/msg/msg.h"
+#include "../common/consts.h"
+using namespace Aseba;
+
+// Dashel
+#include <dashel/dashel.h>
+
+// C++
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// C
+#include <stdlib.h>		// atoi(), exit()
+#include <string.h>		// memcpy()
+#include <time.h>		// clock()
+
+//! A stream reading back what was written to it, without any system call
+class MemoryStream: public Dashel::Stream
+{
+public:
+	std::vector<uint8> buffer;
+	size_t readPos;
+
+public:
+	MemoryStream() : Stream("memory"), readPos(0) { }
+
+	virtual void write(const void *data, const size_t size)
+	{
+		const uint8* ptr(reinterpret_cast<const uint8*>(data));
+		buffer.insert(buffer.end(), ptr, ptr + size);
+	}
+
+	virtual void flush() { }
+
+	virtual void read(void *data, size_t size)
+	{
+		if (readPos + size > buffer.size())
+			throw Dashel::DashelException(Dashel::DashelException::IOError, 0, "Reading past end of memory stream", this);
+		memcpy(data, &buffer[readPos], size);
+		readPos += size;
+	}
+
+	void rewind()
+	{
+		buffer.clear();
+		readPos = 0;
+	}
+};
+
+static double elapsed(clock_t start)
+{
+	return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned iterations(argc > 1 ? atoi(argv[1]) : 100000);
+
+	// a full-size user message and a full-size bytecode chunk, the two largest messages on the bus
+	UserMessage::DataVector data(ASEBA_MAX_EVENT_ARG_COUNT);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = sint16(i * 257);
+	UserMessage userMessage(1, data);
+	SetBytecode setBytecode(1, 0);
+	setBytecode.bytecode.assign(ASEBA_MAX_EVENT_ARG_COUNT - 2, 0x1234);
+
+	MemoryStream stream;
+	unsigned failures(0);
+
+	// serialize
+	clock_t start(clock());
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		stream.rewind();
+		userMessage.serialize(&stream);
+		setBytecode.serialize(&stream);
+	}
+	const double serializeTime(elapsed(start));
+
+	// deserialize, checking that we get back what we wrote
+	start = clock();
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		stream.readPos = 0;
+		Message* message(Message::receive(&stream));
+		UserMessage* receivedUserMessage(dynamic_cast<UserMessage*>(message));
+		if (!receivedUserMessage || receivedUserMessage->data != data)
+			++failures;
+		delete message;
+		message = Message::receive(&stream);
+		SetBytecode* receivedSetBytecode(dynamic_cast<SetBytecode*>(message));
+		if (!receivedSetBytecode || receivedSetBytecode->bytecode != setBytecode.bytecode)
+			++failures;
+		delete message;
+	}
+	const double deserializeTime(elapsed(start));
+
+	// deserialize into reused messages
+	MessagePool messagePool;
+	start = clock();
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		stream.readPos = 0;
+		UserMessage* receivedUserMessage(dynamic_cast<UserMessage*>(messagePool.receive(&stream)));
+		if (!receivedUserMessage || receivedUserMessage->data != data)
+			++failures;
+		SetBytecode* receivedSetBytecode(dynamic_cast<SetBytecode*>(messagePool.receive(&stream)));
+		if (!receivedSetBytecode || receivedSetBytecode->bytecode != setBytecode.bytecode)
+			++failures;
+	}
+	const double poolDeserializeTime(elapsed(start));
+
+	const double megabytes(double(stream.buffer.size()) * iterations / (1024. * 1024.));
+	std::cout << "messages pairs: " << iterations << ", bytes per pair: " << stream.buffer.size() << std::endl;
+	std::cout << "serialize: " << serializeTime << " s (" << megabytes / serializeTime << " MB/s)" << std::endl;
+	std::cout << "deserialize: " << deserializeTime << " s (" << megabytes / deserializeTime << " MB/s)" << std::endl;
+	std::cout << "deserialize with pool: " << poolDeserializeTime << " s (" << megabytes / poolDeserializeTime << " MB/s)" << std::endl;
+
+	if (failures)
+	{
+		std::cerr << failures << " messages did not survive the round trip" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
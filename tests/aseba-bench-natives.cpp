@@ -0,0 +1,100 @@
+// Aseba
+#include "natives-reference.h"
+
+// C++
+#include <iostream>
+#include <vector>
+
+// C
+#include <stdlib.h>		// atoi()
+#include <time.h>		// clock()
+
+// this prevents a link problem when compiling in debug
+void AsebaSendMessage(AsebaVMState *vm, uint16 id, const void *data, uint16 size)
+{
+}
+
+static double elapsed(clock_t start)
+{
+	return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+//! Print the time of the native and of the scalar loop for the same work
+static void report(const char* name, double nativeTime, double referenceTime)
+{
+	std::cout << name << ": " << nativeTime << " s, scalar loop: " << referenceTime << " s (" << referenceTime / nativeTime << "x)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned iterations(argc > 1 ? atoi(argv[1]) : 200000);
+	const uint16 length(argc > 2 ? atoi(argv[2]) : 256);
+
+	// three vectors of length, as a vision or proximity-array processing would, then scalars
+	NativesVM vm(3 * length + 4);
+	for (size_t i = 0; i < vm.variables.size(); ++i)
+		vm.variables[i] = sint16(i * 257);
+	const uint16 a(0), b(length), c(2 * length), scalars(3 * length);
+	vm.variables[scalars] = 8;
+	sint16* v(&vm.variables[0]);
+
+	std::cout << "vectors of " << length << " values, " << iterations << " calls per native" << std::endl;
+
+	const char* binaryNames[] = { "math.add", "math.sub", "math.mul", "math.min", "math.max" };
+	const AsebaNativeFunctionPointer binaryNatives[] = { AsebaNative_vecadd, AsebaNative_vecsub, AsebaNative_vecmul, AsebaNative_vecmin, AsebaNative_vecmax };
+	const ReferenceBinary binaryReferences[] = { referenceAdd, referenceSub, referenceMul, referenceMin, referenceMax };
+	for (size_t n = 0; n < sizeof(binaryNatives) / sizeof(binaryNatives[0]); ++n)
+	{
+		std::vector<uint16> args(4);
+		args[0] = c; args[1] = a; args[2] = b; args[3] = length;
+		clock_t start(clock());
+		for (unsigned i = 0; i < iterations; ++i)
+			vm.call(binaryNatives[n], args);
+		const double nativeTime(elapsed(start));
+		start = clock();
+		for (unsigned i = 0; i < iterations; ++i)
+			binaryReferences[n](v, c, a, b, length);
+		report(binaryNames[n], nativeTime, elapsed(start));
+	}
+
+	{
+		std::vector<uint16> args(5);
+		args[0] = c; args[1] = c; args[2] = a; args[3] = b; args[4] = length;
+		clock_t start(clock());
+		for (unsigned i = 0; i < iterations; ++i)
+			vm.call(AsebaNative_vecclamp, args);
+		const double nativeTime(elapsed(start));
+		start = clock();
+		for (unsigned i = 0; i < iterations; ++i)
+			referenceClamp(v, c, c, a, b, length);
+		report("math.clamp", nativeTime, elapsed(start));
+	}
+
+	{
+		std::vector<uint16> args(5);
+		args[0] = scalars + 1; args[1] = a; args[2] = b; args[3] = scalars; args[4] = length;
+		clock_t start(clock());
+		for (unsigned i = 0; i < iterations; ++i)
+			vm.call(AsebaNative_vecdot, args);
+		const double nativeTime(elapsed(start));
+		start = clock();
+		for (unsigned i = 0; i < iterations; ++i)
+			referenceDot(v, scalars + 1, a, b, scalars, length);
+		report("math.dot", nativeTime, elapsed(start));
+	}
+
+	{
+		std::vector<uint16> args(5);
+		args[0] = a; args[1] = scalars + 1; args[2] = scalars + 2; args[3] = scalars + 3; args[4] = length;
+		clock_t start(clock());
+		for (unsigned i = 0; i < iterations; ++i)
+			vm.call(AsebaNative_vecstat, args);
+		const double nativeTime(elapsed(start));
+		start = clock();
+		for (unsigned i = 0; i < iterations; ++i)
+			referenceStat(v, a, scalars + 1, scalars + 2, scalars + 3, length);
+		report("math.stat", nativeTime, elapsed(start));
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,276 @@
+// Check that the fleet upgrader recovers from late and lost acknowledgements by rebooting nodes,
+// and that it rejects invalid page sizes
+
+// Aseba
+#include "../common/consts.h"
+#include "../common/msg/msg.h"
+#include "../common/utils/BootloaderFleet.h"
+
+// C++
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// C
+#include <stdio.h>
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+using namespace Aseba;
+
+//! A stream keeping what is written to it, to be read back as messages
+class MockStream: public Dashel::Stream
+{
+public:
+	MockStream() : Stream("mock") {}
+
+	virtual void write(const void *data, const size_t size)
+	{
+		const uint8* bytes(static_cast<const uint8*>(data));
+		written.insert(written.end(), bytes, bytes + size);
+	}
+
+	virtual void flush() {}
+
+	virtual void read(void *data, size_t size)
+	{
+		if (size > written.size())
+			throw Dashel::DashelException(Dashel::DashelException::IOError, 0, "no more data", this);
+		uint8* bytes(static_cast<uint8*>(data));
+		for (size_t i = 0; i < size; ++i)
+		{
+			bytes[i] = written.front();
+			written.pop_front();
+		}
+	}
+
+	//! Return the types of the messages written since the last call
+	std::vector<uint16> takeMessages()
+	{
+		std::vector<uint16> types;
+		while (!written.empty())
+		{
+			std::auto_ptr<Message> message(Message::receive(this));
+			types.push_back(message->type);
+		}
+		return types;
+	}
+
+protected:
+	std::deque<uint8> written; //!< bytes written by the fleet
+};
+
+//! A fleet whose nodes are driven by the test rather than by a hub
+class TestFleet: public BootloaderFleet
+{
+public:
+	TestFleet(const std::string& hexFileName) : BootloaderFleet(hexFileName, 5, 1000) {}
+
+	//! Add a node on stream and return its index
+	size_t addMockNode(Dashel::Stream* stream, uint16 dest)
+	{
+		addNode(stream, "mock", dest);
+		nodes.back().lastActivity = UnifiedTime();
+		++activeCount;
+		return nodes.size() - 1;
+	}
+
+	//! Return the node at index
+	const Node& node(size_t index) const { return nodes[index]; }
+
+	//! Process message as if received from the node at index
+	void receive(size_t index, const Message& message) { processMessage(nodes[index], &message); }
+
+	//! Process a successful acknowledgement from the node at index
+	void ack(size_t index)
+	{
+		BootloaderAck ack;
+		ack.source = nodes[index].dest;
+		ack.errorCode = BootloaderAck::SUCCESS;
+		receive(index, ack);
+	}
+
+	//! Process the bootloader description of the node at index
+	void describe(size_t index, uint16 pageSize, uint16 dataChunkSize, uint16 pagesInFlight)
+	{
+		BootloaderDescription description;
+		description.source = nodes[index].dest;
+		description.pageSize = pageSize;
+		description.pagesStart = 0;
+		description.pagesCount = 16;
+		description.dataChunkSize = dataChunkSize;
+		description.pagesInFlight = pagesInFlight;
+		receive(index, description);
+	}
+
+	//! Let the timeout of all nodes expire
+	void expire() { checkTimeouts(UnifiedTime() + UnifiedTime(2000)); }
+};
+
+//! Number of failed checks
+static unsigned failures = 0;
+
+//! Check that the messages written to stream are count messages of type
+static void expectMessages(MockStream& stream, size_t count, uint16 type, const char* what)
+{
+	const std::vector<uint16> types(stream.takeMessages());
+	bool ok(types.size() == count);
+	for (size_t i = 0; i < types.size(); ++i)
+		ok = ok && (types[i] == type);
+	if (!ok)
+	{
+		std::cerr << what << ": expected " << count << " messages of type " << std::hex << type << ", got";
+		for (size_t i = 0; i < types.size(); ++i)
+			std::cerr << " " << types[i];
+		std::cerr << std::dec << std::endl;
+		++failures;
+	}
+}
+
+//! Check that the node at index is in state after ackedCount acknowledged pages
+static void expectState(const TestFleet& fleet, size_t index, BootloaderFleet::Node::State state, size_t ackedCount, const char* what)
+{
+	const BootloaderFleet::Node& node(fleet.node(index));
+	if ((node.state != state) || (node.ackedCount != ackedCount))
+	{
+		std::cerr << what << ": node in state " << node.state << " after " << node.ackedCount << " pages, expected state " << state << " after " << ackedCount << " pages" << std::endl;
+		++failures;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// 24 bytes, that is 3 pages of 8 bytes
+	const std::string hexFileName(argc > 1 ? argv[1] : "aseba-test-bootloader-fleet.hex");
+	{
+		HexFile hexFile;
+		uint8 bytes[24];
+		for (unsigned i = 0; i < sizeof(bytes); ++i)
+			bytes[i] = uint8(i);
+		hexFile.addData(0, bytes, sizeof(bytes));
+		hexFile.write(hexFileName);
+	}
+	TestFleet fleet(hexFileName);
+	remove(hexFileName.c_str());
+
+	// original protocol, the ack of the first write page command comes after the timeout
+	{
+		MockStream stream;
+		const size_t node(fleet.addMockNode(&stream, 1));
+		fleet.describe(node, 8, 0, 0);
+		expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_WRITE_PAGE, "original: first page");
+		fleet.expire();
+		expectMessages(stream, 1, ASEBA_MESSAGE_REBOOT, "original: reboot after timeout");
+		fleet.ack(node);
+		expectMessages(stream, 0, ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE, "original: late ack ignored");
+		fleet.describe(node, 8, 0, 0);
+		expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_WRITE_PAGE, "original: first page sent again");
+		fleet.ack(node);
+		expectMessages(stream, 2, ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE, "original: data of first page");
+		expectState(fleet, node, BootloaderFleet::Node::WAITING_DATA_ACK, 0, "original: data of first page");
+		for (unsigned page = 1; page < 3; ++page)
+		{
+			fleet.ack(node);
+			expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_WRITE_PAGE, "original: next page");
+			fleet.ack(node);
+			expectMessages(stream, 2, ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE, "original: data of next page");
+		}
+		fleet.ack(node);
+		expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_RESET, "original: reset");
+		expectState(fleet, node, BootloaderFleet::Node::DONE, 3, "original: done");
+	}
+
+	// original protocol, the ack of the data of the second page is lost
+	{
+		MockStream stream;
+		const size_t node(fleet.addMockNode(&stream, 2));
+		fleet.describe(node, 8, 0, 0);
+		fleet.ack(node);
+		fleet.ack(node);
+		fleet.ack(node);
+		stream.takeMessages();
+		expectState(fleet, node, BootloaderFleet::Node::WAITING_DATA_ACK, 1, "original lost: data of second page");
+		fleet.expire();
+		expectMessages(stream, 1, ASEBA_MESSAGE_REBOOT, "original lost: reboot after timeout");
+		fleet.describe(node, 8, 0, 0);
+		expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_WRITE_PAGE, "original lost: first page sent again");
+		for (unsigned page = 0; page < 3; ++page)
+		{
+			fleet.ack(node);
+			fleet.ack(node);
+		}
+		expectState(fleet, node, BootloaderFleet::Node::DONE, 3, "original lost: done");
+	}
+
+	// pipelined protocol, two pages in flight, whose acks come after the timeout
+	{
+		MockStream stream;
+		const size_t node(fleet.addMockNode(&stream, 3));
+		fleet.describe(node, 8, 8, 2);
+		expectMessages(stream, 2, ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK, "pipelined: first pages");
+		fleet.ack(node);
+		expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK, "pipelined: last page");
+		fleet.expire();
+		expectMessages(stream, 1, ASEBA_MESSAGE_REBOOT, "pipelined: reboot after timeout");
+		fleet.ack(node);
+		fleet.ack(node);
+		expectState(fleet, node, BootloaderFleet::Node::WAITING_DESCRIPTION, 1, "pipelined: late acks ignored");
+		fleet.describe(node, 8, 8, 2);
+		expectMessages(stream, 2, ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK, "pipelined: pages sent again");
+		fleet.ack(node);
+		fleet.ack(node);
+		expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_PAGE_DATA_WRITE_CHUNK, "pipelined: last page sent again");
+		fleet.ack(node);
+		expectMessages(stream, 1, ASEBA_MESSAGE_BOOTLOADER_RESET, "pipelined: reset");
+		expectState(fleet, node, BootloaderFleet::Node::DONE, 3, "pipelined: done");
+	}
+
+	// pipelined protocol, the ack of the second page is lost, every time but the last one
+	{
+		MockStream stream;
+		const size_t node(fleet.addMockNode(&stream, 4));
+		for (unsigned attempt = 0; attempt < 4; ++attempt)
+		{
+			fleet.describe(node, 8, 8, 2);
+			fleet.ack(node);
+			expectState(fleet, node, BootloaderFleet::Node::WRITING_PIPELINED, 1, "pipelined lost: first page");
+			fleet.expire();
+			expectState(fleet, node, BootloaderFleet::Node::WAITING_DESCRIPTION, 1, "pipelined lost: reboot after timeout");
+		}
+		fleet.describe(node, 8, 8, 2);
+		fleet.ack(node);
+		fleet.ack(node);
+		fleet.ack(node);
+		expectState(fleet, node, BootloaderFleet::Node::DONE, 3, "pipelined lost: done");
+		if (fleet.node(node).retries != 4)
+		{
+			std::cerr << "pipelined lost: " << fleet.node(node).retries << " retries instead of 4" << std::endl;
+			++failures;
+		}
+	}
+
+	// pages are written by words of 4 bytes
+	{
+		MockStream stream;
+		const size_t zeroNode(fleet.addMockNode(&stream, 5));
+		fleet.describe(zeroNode, 0, 0, 0);
+		expectState(fleet, zeroNode, BootloaderFleet::Node::FAILED, 0, "page size 0");
+		const size_t oddNode(fleet.addMockNode(&stream, 6));
+		fleet.describe(oddNode, 6, 0, 0);
+		expectState(fleet, oddNode, BootloaderFleet::Node::FAILED, 0, "page size 6");
+		expectMessages(stream, 0, ASEBA_MESSAGE_BOOTLOADER_WRITE_PAGE, "invalid page sizes");
+		if (fleet.node(oddNode).error != "invalid page size")
+		{
+			std::cerr << "page size 6: failed with " << fleet.node(oddNode).error << std::endl;
+			++failures;
+		}
+	}
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+// Check that breakpoints kept in a bitmap are set, hit and cleared through the debug messages,
+// including more than ASEBA_MAX_BREAKPOINTS of them
+
+// Aseba
+#include "test-node.h"
+
+// C++
+#include <iostream>
+
+// C
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+// each assignment is two words, a small immediate and a store
+static const char* source =
+	"var a\n"
+	"var b\n"
+	"onevent e0\n"
+	"	a = 1\n"
+	"	b = 2\n"
+	"	a = 3\n";
+
+//! Addresses of the variables of source
+enum
+{
+	A_ADDRESS = 0,
+	B_ADDRESS = 1
+};
+
+//! Number of failed checks
+static unsigned failures = 0;
+
+//! A test node whose breakpoints are kept in a bitmap
+struct BreakpointsNode: AsebaNode
+{
+	uint16 bitmap[ASEBA_VM_BREAKPOINTS_BITMAP_SIZE(512)];
+
+	BreakpointsNode()
+	{
+		vm.breakpointsBitmap = bitmap;
+		AsebaVMInit(&vm);
+	}
+
+	//! Send a debug message of type with a single argument to the VM, as the network would
+	void debugMessage(uint16 type, uint16 argument)
+	{
+		uint16 data[2];
+		data[0] = bswap16(vm.nodeId);
+		data[1] = bswap16(argument);
+		AsebaVMDebugMessage(&vm, type, data, 2);
+	}
+
+	//! Send a debug message of type without argument to the VM, as the network would
+	void debugMessage(uint16 type)
+	{
+		uint16 dest(bswap16(vm.nodeId));
+		AsebaVMDebugMessage(&vm, type, &dest, 1);
+	}
+
+	//! Set a breakpoint at pc through the debug message, return the result the VM answers, or 2 if it does not answer
+	uint16 setBreakpoint(uint16 pc)
+	{
+		sentMessages.clear();
+		debugMessage(ASEBA_MESSAGE_BREAKPOINT_SET, pc);
+		if ((sentMessages.size() != 1) || (sentMessages[0].type != ASEBA_MESSAGE_BREAKPOINT_SET_RESULT) || (sentMessages[0].words.size() != 2) || (sentMessages[0].words[0] != pc))
+			return 2;
+		return sentMessages[0].words[1];
+	}
+
+	//! Clear the breakpoint at pc through the debug message, return whether it was set
+	bool clearBreakpoint(uint16 pc)
+	{
+		const bool wasSet(hasBreakpoint(pc));
+		debugMessage(ASEBA_MESSAGE_BREAKPOINT_CLEAR, pc);
+		return wasSet && !hasBreakpoint(pc);
+	}
+
+	//! Return whether the bitmap has a breakpoint at pc
+	bool hasBreakpoint(uint16 pc) const { return (bitmap[pc >> 4] >> (pc & 0xf)) & 1; }
+};
+
+//! Check a condition, counting a failure with the message what if it does not hold
+static void check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		std::cerr << what << std::endl;
+		++failures;
+	}
+}
+
+//! Run event e0 until it finishes or hits a breakpoint
+static void runEvent(BreakpointsNode& node)
+{
+	AsebaVMSetupEvent(&node.vm, 0);
+	AsebaVMRun(&node.vm, 1000);
+}
+
+int main()
+{
+	BreakpointsNode node;
+	CommonDefinitions definitions;
+	definitions.events.push_back(NamedValue(L"e0", 0));
+	const std::string narrowSource(source);
+	if (!node.compile(std::wstring(narrowSource.begin(), narrowSource.end()), definitions))
+		return EXIT_FAILURE;
+	const uint16 eventAddress(AsebaVMGetEventAddress(&node.vm, 0));
+	// on "b = 2"
+	const uint16 breakpointAddress(eventAddress + 2);
+
+	// the VM answers with the result of setting a breakpoint
+	check(node.setBreakpoint(breakpointAddress) == 1, "BreakpointSet failed");
+	check(node.hasBreakpoint(breakpointAddress) && (node.vm.breakpointsCount == 1), "breakpoint not in the bitmap");
+
+	// setting twice the same breakpoint counts it once
+	check(node.setBreakpoint(breakpointAddress) == 1, "breakpoint not set again");
+	check(node.vm.breakpointsCount == 1, "breakpoint counted twice");
+
+	// the bitmap is not limited to ASEBA_MAX_BREAKPOINTS
+	for (uint16 pc = 400; pc < 400 + 2 * ASEBA_MAX_BREAKPOINTS; ++pc)
+		check(node.setBreakpoint(pc) == 1, "breakpoint beyond ASEBA_MAX_BREAKPOINTS not set");
+	check(node.vm.breakpointsCount == 1 + 2 * ASEBA_MAX_BREAKPOINTS, "breakpoints beyond ASEBA_MAX_BREAKPOINTS not counted");
+	for (uint16 pc = 400; pc < 400 + 2 * ASEBA_MAX_BREAKPOINTS; ++pc)
+		check(node.clearBreakpoint(pc), "breakpoint beyond ASEBA_MAX_BREAKPOINTS not cleared");
+	check(node.vm.breakpointsCount == 1, "breakpoints not uncounted when cleared");
+	node.clearBreakpoint(400);
+	check(node.vm.breakpointsCount == 1, "breakpoint uncounted twice");
+
+	// the VM stops on the breakpoint, before executing it, and tells it
+	sentMessages.clear();
+	runEvent(node);
+	check(node.vm.pc == breakpointAddress, "breakpoint not hit");
+	check(AsebaMaskIsSet(node.vm.flags, ASEBA_VM_STEP_BY_STEP_MASK) && AsebaMaskIsSet(node.vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK), "VM not paused on the breakpoint");
+	check((node.vm.variables[A_ADDRESS] == 1) && (node.vm.variables[B_ADDRESS] == 0), "code around the breakpoint not executed as expected");
+	check((sentMessages.size() == 1) && (sentMessages[0].type == ASEBA_MESSAGE_EXECUTION_STATE_CHANGED) && (sentMessages[0].words[0] == breakpointAddress), "breakpoint hit not sent");
+
+	// stepping over the breakpoint then running finishes the event
+	node.debugMessage(ASEBA_MESSAGE_STEP);
+	check(node.vm.pc == breakpointAddress + 1, "step did not move past the breakpoint");
+	node.debugMessage(ASEBA_MESSAGE_RUN);
+	AsebaVMRun(&node.vm, 1000);
+	check(AsebaMaskIsClear(node.vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK), "event not finished after the breakpoint");
+	check((node.vm.variables[A_ADDRESS] == 3) && (node.vm.variables[B_ADDRESS] == 2), "code after the breakpoint not executed");
+
+	// once cleared through the debug message, the breakpoint is not hit anymore
+	check(node.clearBreakpoint(breakpointAddress) && (node.vm.breakpointsCount == 0), "breakpoint not cleared");
+	node.vm.variables[A_ADDRESS] = 0;
+	node.vm.variables[B_ADDRESS] = 0;
+	runEvent(node);
+	check(AsebaMaskIsClear(node.vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK) && (node.vm.variables[A_ADDRESS] == 3) && (node.vm.variables[B_ADDRESS] == 2), "cleared breakpoint hit");
+
+	// clearing all breakpoints empties the bitmap
+	node.setBreakpoint(breakpointAddress);
+	node.setBreakpoint(eventAddress);
+	node.debugMessage(ASEBA_MESSAGE_BREAKPOINT_CLEAR_ALL);
+	check(!node.hasBreakpoint(breakpointAddress) && !node.hasBreakpoint(eventAddress) && (node.vm.breakpointsCount == 0), "breakpoints not all cleared");
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
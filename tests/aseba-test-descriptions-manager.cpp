@@ -0,0 +1,146 @@
+// Check that the descriptions manager keeps descriptions received before the hash of the node,
+// learns their hash for the cache, and drops them only when a known hash changes
+
+// Aseba
+#include "../common/consts.h"
+#include "../common/msg/msg.h"
+#include "../common/msg/descriptions-manager.h"
+
+// C++
+#include <iostream>
+#include <string>
+
+// C
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+using namespace Aseba;
+
+//! A descriptions manager counting the calls of its virtual functions
+class TestDescriptionsManager: public DescriptionsManager
+{
+public:
+	unsigned receivedCount; //!< number of calls to nodeDescriptionReceived
+	unsigned hashUnknownCount; //!< number of calls to nodeDescriptionHashUnknown
+
+	TestDescriptionsManager() : receivedCount(0), hashUnknownCount(0) {}
+
+	//! Process the description of node, with one named variable, and if complete the description of this variable
+	void describe(uint16 node, bool complete)
+	{
+		Description description;
+		description.source = node;
+		description.name = L"dummynode";
+		description.protocolVersion = ASEBA_PROTOCOL_VERSION;
+		description.bytecodeSize = 512;
+		description.variablesSize = 256;
+		description.stackSize = 32;
+		description.namedVariables.resize(1);
+		processMessage(&description);
+		if (complete)
+			describeVariable(node);
+	}
+
+	//! Process the description of the named variable of node
+	void describeVariable(uint16 node)
+	{
+		NamedVariableDescription variable;
+		variable.source = node;
+		variable.name = L"id";
+		variable.size = 1;
+		processMessage(&variable);
+	}
+
+	//! Process the hash crc of the description of node
+	void hash(uint16 node, uint16 crc)
+	{
+		DescriptionHash descriptionHash;
+		descriptionHash.source = node;
+		descriptionHash.name = L"dummynode";
+		descriptionHash.protocolVersion = ASEBA_PROTOCOL_VERSION;
+		descriptionHash.crc = crc;
+		processMessage(&descriptionHash);
+	}
+
+	//! Return whether the description of node is known and complete
+	bool hasDescription(uint16 node) const
+	{
+		bool ok(false);
+		const TargetDescription* description(getDescription(node, &ok));
+		return ok && (description->namedVariables.size() == 1) && (description->namedVariables[0].name == L"id");
+	}
+
+protected:
+	virtual void nodeDescriptionReceived(unsigned nodeId) { ++receivedCount; }
+	virtual void nodeDescriptionHashUnknown(unsigned nodeId) { ++hashUnknownCount; }
+};
+
+//! Number of failed checks
+static unsigned failures = 0;
+
+//! Check the state of manager for node, counting a failure with the message what if it differs
+static void expect(const TestDescriptionsManager& manager, uint16 node, bool known, unsigned receivedCount, unsigned hashUnknownCount, const char* what)
+{
+	if ((manager.hasDescription(node) != known) || (manager.receivedCount != receivedCount) || (manager.hashUnknownCount != hashUnknownCount))
+	{
+		std::cerr << what << ": description " << (manager.hasDescription(node) ? "known" : "unknown");
+		std::cerr << ", received " << manager.receivedCount << " times, hash unknown " << manager.hashUnknownCount << " times";
+		std::cerr << "; expected " << (known ? "known" : "unknown") << ", " << receivedCount << " and " << hashUnknownCount << std::endl;
+		++failures;
+	}
+}
+
+int main()
+{
+	// description, then hash, for instance when another client asked for the hash
+	{
+		TestDescriptionsManager manager;
+		manager.describe(1, true);
+		expect(manager, 1, true, 1, 0, "description before hash");
+		manager.hash(1, 0x1234);
+		expect(manager, 1, true, 1, 0, "hash after description");
+		manager.hash(1, 0x1234);
+		expect(manager, 1, true, 1, 0, "same hash again");
+
+		// the learnt hash filled the cache
+		manager.reset();
+		manager.hash(1, 0x1234);
+		expect(manager, 1, true, 2, 0, "cache filled from a description received before its hash");
+
+		// a known hash that changes drops the description
+		manager.hash(1, 0x5678);
+		expect(manager, 1, false, 2, 1, "changed hash");
+		manager.describe(1, true);
+		expect(manager, 1, true, 3, 1, "description after changed hash");
+	}
+
+	// hash received while the description is being received
+	{
+		TestDescriptionsManager manager;
+		manager.describe(2, false);
+		manager.hash(2, 0x4321);
+		expect(manager, 2, false, 0, 0, "hash during description");
+		manager.describeVariable(2);
+		expect(manager, 2, true, 1, 0, "description completed after hash");
+		manager.reset();
+		manager.hash(2, 0x4321);
+		expect(manager, 2, true, 2, 0, "cache filled from a description completed after its hash");
+	}
+
+	// hash, then description, the usual order
+	{
+		TestDescriptionsManager manager;
+		manager.hash(3, 0x1111);
+		expect(manager, 3, false, 0, 1, "unknown hash");
+		manager.describe(3, true);
+		expect(manager, 3, true, 1, 1, "description after hash");
+		manager.hash(3, 0x1111);
+		expect(manager, 3, true, 1, 1, "same hash after description");
+	}
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
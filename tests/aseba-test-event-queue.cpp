@@ -0,0 +1,222 @@
+// Check that the event queue of the VM delivers events in the order of its policy,
+// along with their source and arguments, and counts queued, coalesced and dropped events
+
+// Aseba
+#include "test-node.h"
+
+// C++
+#include <iostream>
+#include <vector>
+
+// C
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+// every handler logs its identifier, source and first argument, which the queue writes to source and args
+static const char* source =
+	"var source\n"
+	"var args[2]\n"
+	"var events[8]\n"
+	"var sources[8]\n"
+	"var values[8]\n"
+	"var n\n"
+	"sub log\n"
+	"	sources[n] = source\n"
+	"	values[n] = args[0]\n"
+	"	n = n + 1\n"
+	"onevent e0\n"
+	"	events[n] = 0\n"
+	"	callsub log\n"
+	"onevent e1\n"
+	"	events[n] = 1\n"
+	"	callsub log\n"
+	"onevent e2\n"
+	"	events[n] = 2\n"
+	"	callsub log\n"
+	"onevent e3\n"
+	"	events[n] = 3\n"
+	"	callsub log\n";
+
+//! Addresses of the variables of source
+enum
+{
+	SOURCE_ADDRESS = 0,
+	EVENTS_ADDRESS = 3,
+	SOURCES_ADDRESS = 11,
+	VALUES_ADDRESS = 19,
+	N_ADDRESS = 27
+};
+
+//! Depth of the queue, small for overflows to be easy to provoke
+static const uint16 queueDepth = 3;
+//! Number of arguments kept by the queue
+static const uint16 queueArgsSize = 2;
+
+//! An event, as queued and as delivered to its handler
+struct Event
+{
+	uint16 id;
+	uint16 value;
+};
+
+//! Number of failed checks
+static unsigned failures = 0;
+
+//! A test node with an event queue
+struct QueueNode: AsebaNode
+{
+	AsebaVMEventQueue queue;
+	uint16 entries[queueDepth * ASEBA_VM_EVENT_QUEUE_ENTRY_SIZE(queueArgsSize)];
+
+	QueueNode(AsebaVMEventQueuePolicy policy)
+	{
+		queue.policy = policy;
+		queue.depth = queueDepth;
+		queue.argsSize = queueArgsSize;
+		queue.sourceAddress = SOURCE_ADDRESS;
+		queue.entries = entries;
+		vm.eventQueue = &queue;
+		AsebaVMInit(&vm);
+	}
+
+	//! Queue event with value as its first argument and value + 100 as its source, return whether it was queued
+	bool post(uint16 id, uint16 value)
+	{
+		const uint16 args[queueArgsSize] = { value, 0 };
+		return AsebaVMQueueEvent(&vm, id, value + 100, args, queueArgsSize) != 0;
+	}
+
+	//! Return the number of handlers that have run so far
+	sint16 handledCount() const { return vm.variables[N_ADDRESS]; }
+};
+
+//! Check a condition, counting a failure with the message what if it does not hold
+static void check(bool condition, const char* policy, const char* what)
+{
+	if (!condition)
+	{
+		std::cerr << policy << ": " << what << std::endl;
+		++failures;
+	}
+}
+
+//! Run the node until its queue is empty, and check the events its handlers have logged and its counters
+static void checkDelivery(QueueNode& node, const char* policy, const std::vector<Event>& expected, uint16 queuedCount, uint16 coalescedCount, uint16 droppedCount)
+{
+	// the first event runs at once, the others wait for it to finish
+	check(node.handledCount() == 0, policy, "handler ran before the VM");
+	check(AsebaMaskIsSet(node.vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK), policy, "first event was not set up");
+
+	// queued events are dispatched by the stop bytecode at the end of each handler
+	AsebaVMRun(&node.vm, 1000);
+	check(AsebaMaskIsClear(node.vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK), policy, "handlers still running");
+	check(node.queue.count == 0, policy, "events left in the queue");
+
+	if (node.handledCount() != sint16(expected.size()))
+	{
+		std::cerr << policy << ": " << node.handledCount() << " events delivered instead of " << expected.size() << std::endl;
+		++failures;
+	}
+	for (size_t i = 0; (i < expected.size()) && (sint16(i) < node.handledCount()); ++i)
+	{
+		const sint16 id(node.vm.variables[EVENTS_ADDRESS + i]);
+		const sint16 value(node.vm.variables[VALUES_ADDRESS + i]);
+		const sint16 source(node.vm.variables[SOURCES_ADDRESS + i]);
+		if ((id != expected[i].id) || (value != expected[i].value) || (source != expected[i].value + 100))
+		{
+			std::cerr << policy << ": event " << i << " is e" << id << " with argument " << value << " from " << source;
+			std::cerr << ", expected e" << expected[i].id << " with argument " << expected[i].value << " from " << expected[i].value + 100 << std::endl;
+			++failures;
+		}
+	}
+
+	if ((node.queue.queuedCount != queuedCount) || (node.queue.coalescedCount != coalescedCount) || (node.queue.droppedCount != droppedCount))
+	{
+		std::cerr << policy << ": " << node.queue.queuedCount << " queued, " << node.queue.coalescedCount << " coalesced, " << node.queue.droppedCount << " dropped";
+		std::cerr << ", expected " << queuedCount << ", " << coalescedCount << ", " << droppedCount << std::endl;
+		++failures;
+	}
+}
+
+//! Append an event to events
+static void expect(std::vector<Event>& events, uint16 id, uint16 value)
+{
+	const Event event = { id, value };
+	events.push_back(event);
+}
+
+int main()
+{
+	CommonDefinitions definitions;
+	definitions.events.push_back(NamedValue(L"e0", queueArgsSize));
+	definitions.events.push_back(NamedValue(L"e1", queueArgsSize));
+	definitions.events.push_back(NamedValue(L"e2", queueArgsSize));
+	definitions.events.push_back(NamedValue(L"e3", queueArgsSize));
+	const std::string narrowSource(source);
+	const std::wstring wideSource(narrowSource.begin(), narrowSource.end());
+
+	// events run in their order of arrival, the ones arriving when the queue is full are dropped
+	{
+		QueueNode node(ASEBA_VM_EVENT_QUEUE_FIFO);
+		if (!node.compile(wideSource, definitions))
+			return EXIT_FAILURE;
+		check(node.post(0, 1), "FIFO", "e0 not set up");
+		check(node.post(2, 2), "FIFO", "e2 not queued");
+		check(node.post(1, 3), "FIFO", "e1 not queued");
+		check(node.post(2, 4), "FIFO", "second e2 not queued");
+		check(!node.post(1, 5), "FIFO", "event queued in a full queue");
+		check(node.queue.count == queueDepth, "FIFO", "queue is not full");
+		std::vector<Event> expected;
+		expect(expected, 0, 1);
+		expect(expected, 2, 2);
+		expect(expected, 1, 3);
+		expect(expected, 2, 4);
+		checkDelivery(node, "FIFO", expected, 4, 0, 1);
+	}
+
+	// a new event replaces the queued one with the same identifier, keeping its place
+	{
+		QueueNode node(ASEBA_VM_EVENT_QUEUE_LATEST);
+		if (!node.compile(wideSource, definitions))
+			return EXIT_FAILURE;
+		check(node.post(0, 1), "LATEST", "e0 not set up");
+		check(node.post(2, 2), "LATEST", "e2 not queued");
+		check(node.post(1, 3), "LATEST", "e1 not queued");
+		check(node.post(2, 4), "LATEST", "e2 not coalesced");
+		check(node.post(3, 5), "LATEST", "e3 not queued");
+		check(node.post(3, 6), "LATEST", "e3 not coalesced in a full queue");
+		check(node.post(1, 7), "LATEST", "e1 not coalesced in a full queue");
+		check(!node.post(0, 8), "LATEST", "new event queued in a full queue");
+		std::vector<Event> expected;
+		expect(expected, 0, 1);
+		expect(expected, 2, 4);
+		expect(expected, 1, 7);
+		expect(expected, 3, 6);
+		checkDelivery(node, "LATEST", expected, 4, 3, 1);
+	}
+
+	// events with smaller identifiers run first, the largest identifier is dropped when the queue is full
+	{
+		QueueNode node(ASEBA_VM_EVENT_QUEUE_PRIORITY);
+		if (!node.compile(wideSource, definitions))
+			return EXIT_FAILURE;
+		check(node.post(3, 1), "PRIORITY", "e3 not set up");
+		check(node.post(3, 2), "PRIORITY", "e3 not queued");
+		check(node.post(2, 3), "PRIORITY", "e2 not queued");
+		check(node.post(1, 4), "PRIORITY", "e1 not queued");
+		check(node.post(0, 5), "PRIORITY", "e0 did not replace e3 in a full queue");
+		check(!node.post(3, 6), "PRIORITY", "e3 replaced a smaller event in a full queue");
+		std::vector<Event> expected;
+		expect(expected, 3, 1);
+		expect(expected, 0, 5);
+		expect(expected, 1, 4);
+		expect(expected, 2, 3);
+		checkDelivery(node, "PRIORITY", expected, 5, 0, 2);
+	}
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
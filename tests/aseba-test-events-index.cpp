@@ -0,0 +1,169 @@
+// Check that the address of events is the same whether it is found by binary search in the events index,
+// or by scanning the event vector because the index is missing or too small,
+// and that the index follows new bytecode with the same number of handlers at other addresses
+
+// Aseba
+#include "test-node.h"
+
+// C++
+#include <iostream>
+#include <vector>
+
+// C
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+// handlers are not in the order of the events, so that the index must sort them; e1 is not handled
+static const char* source =
+	"var a\n"
+	"onevent e3\n"
+	"	a = 3\n"
+	"onevent e0\n"
+	"	a = 0\n"
+	"onevent e4\n"
+	"	a = 4\n"
+	"onevent e2\n"
+	"	a = 2\n";
+
+// the same handlers, longer, so that they are at other addresses with the same event vector size
+static const char* otherSource =
+	"var a\n"
+	"onevent e3\n"
+	"	a = 3\n"
+	"	a = 33\n"
+	"onevent e0\n"
+	"	a = 0\n"
+	"	a = 10\n"
+	"onevent e4\n"
+	"	a = 4\n"
+	"onevent e2\n"
+	"	a = 2\n";
+
+//! Number of events in the common definitions
+static const uint16 eventsCount = 5;
+
+//! Number of failed checks
+static unsigned failures = 0;
+
+//! Return the address of event by scanning the event vector of vm
+static uint16 scanEventAddress(const AsebaVMState& vm, uint16 event)
+{
+	for (uint16 i = 1; i < vm.bytecode[0]; i += 2)
+		if (vm.bytecode[i] == event)
+			return vm.bytecode[i + 1];
+	return 0;
+}
+
+//! Check that AsebaVMGetEventAddress agrees with the event vector for all events and the init event
+static void checkAddresses(AsebaNode& node, const char* what)
+{
+	for (uint16 event = 0; event <= eventsCount; ++event)
+	{
+		const uint16 id(event == eventsCount ? uint16(ASEBA_EVENT_INIT) : event);
+		const uint16 address(AsebaVMGetEventAddress(&node.vm, id));
+		const uint16 expected(scanEventAddress(node.vm, id));
+		if (address != expected)
+		{
+			std::cerr << what << ": event " << id << " at address " << address << " instead of " << expected << std::endl;
+			++failures;
+		}
+	}
+}
+
+int main()
+{
+	CommonDefinitions definitions;
+	definitions.events.push_back(NamedValue(L"e0", 0));
+	definitions.events.push_back(NamedValue(L"e1", 0));
+	definitions.events.push_back(NamedValue(L"e2", 0));
+	definitions.events.push_back(NamedValue(L"e3", 0));
+	definitions.events.push_back(NamedValue(L"e4", 0));
+	const std::string narrowSource(source);
+	const std::wstring wideSource(narrowSource.begin(), narrowSource.end());
+	const std::string otherNarrowSource(otherSource);
+	const std::wstring otherWideSource(otherNarrowSource.begin(), otherNarrowSource.end());
+
+	// binary search in the index
+	{
+		AsebaNode node;
+		if (!node.compile(wideSource, definitions))
+			return EXIT_FAILURE;
+		if (node.vm.eventsIndex[0] != node.vm.bytecode[0])
+		{
+			std::cerr << "index not built" << std::endl;
+			++failures;
+		}
+		checkAddresses(node, "index");
+		if (AsebaVMGetEventAddress(&node.vm, 1) != 0)
+		{
+			std::cerr << "index: unhandled event found" << std::endl;
+			++failures;
+		}
+	}
+
+	// new bytecode with the same event vector size but other addresses,
+	// received through the SetBytecode message, which rebuilds the index
+	{
+		AsebaNode node;
+		AsebaNode otherNode;
+		if (!node.compile(wideSource, definitions) || !otherNode.compile(otherWideSource, definitions))
+			return EXIT_FAILURE;
+		unsigned movedCount(0);
+		for (uint16 event = 0; event < eventsCount; ++event)
+			if (AsebaVMGetEventAddress(&node.vm, event) != AsebaVMGetEventAddress(&otherNode.vm, event))
+				++movedCount;
+		if ((node.vm.bytecode[0] != otherNode.vm.bytecode[0]) || (movedCount == 0))
+		{
+			std::cerr << "other bytecode: not the same event vector size at other addresses" << std::endl;
+			++failures;
+		}
+		std::vector<uint16> data;
+		data.push_back(bswap16(node.vm.nodeId));
+		data.push_back(bswap16(0));
+		for (uint16 i = 0; i < otherNode.vm.bytecodeSize; ++i)
+			data.push_back(bswap16(otherNode.vm.bytecode[i]));
+		AsebaVMDebugMessage(&node.vm, ASEBA_MESSAGE_SET_BYTECODE, &data[0], data.size());
+		checkAddresses(node, "bytecode received");
+	}
+
+	// the same, written directly into bytecode as a glue loading it from flash, which must rebuild the index
+	{
+		AsebaNode node;
+		AsebaNode otherNode;
+		if (!node.compile(wideSource, definitions) || !otherNode.compile(otherWideSource, definitions))
+			return EXIT_FAILURE;
+		for (uint16 i = 0; i < otherNode.vm.bytecodeSize; ++i)
+			node.vm.bytecode[i] = otherNode.vm.bytecode[i];
+		AsebaVMBuildEventsIndex(&node.vm);
+		checkAddresses(node, "bytecode loaded");
+	}
+
+	// scan of the event vector, without index
+	{
+		AsebaNode node;
+		node.vm.eventsIndexSize = 0;
+		if (!node.compile(wideSource, definitions))
+			return EXIT_FAILURE;
+		checkAddresses(node, "no index");
+	}
+
+	// scan of the event vector, with an index too small for it
+	{
+		AsebaNode node;
+		node.vm.eventsIndexSize = 3;
+		if (!node.compile(wideSource, definitions))
+			return EXIT_FAILURE;
+		if (node.vm.eventsIndex[0] != 0)
+		{
+			std::cerr << "index too small not marked as unusable" << std::endl;
+			++failures;
+		}
+		checkAddresses(node, "index too small");
+	}
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
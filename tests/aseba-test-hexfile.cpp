@@ -0,0 +1,193 @@
+// Check that reading a hex file with out-of-order, adjacent and overlapping records
+// builds the expected chunks byte for byte, and that writing them back preserves them
+
+// Aseba
+#include "../common/utils/HexFile.h"
+
+// C++
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+// C
+#include <stdio.h>
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+using namespace Aseba;
+
+//! Bytes by address, the straightforward model of what the records contain
+typedef std::map<uint32, uint8> ByteMap;
+
+//! Number of failed checks
+static unsigned failures = 0;
+
+//! Return value as two hexadecimal digits
+static std::string hex(uint8 value)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	std::string text;
+	text += digits[value >> 4];
+	text += digits[value & 0xf];
+	return text;
+}
+
+//! Return a record of type with data at address, terminated by lineEnd
+static std::string record(uint16 address, uint8 type, const std::vector<uint8>& data, const char* lineEnd)
+{
+	uint8 checkSum(uint8(data.size()) + uint8(address >> 8) + uint8(address) + type);
+	std::string text(":" + hex(uint8(data.size())) + hex(uint8(address >> 8)) + hex(uint8(address)) + hex(type));
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		text += hex(data[i]);
+		checkSum += data[i];
+	}
+	return text + hex(uint8(~checkSum + 1)) + lineEnd;
+}
+
+//! Return a data record of count bytes starting with first at address within the 64 KB segment of base, and write them to bytes
+static std::string dataRecord(uint32 base, uint16 address, uint8 count, uint8 first, ByteMap& bytes, const char* lineEnd = "\n")
+{
+	std::vector<uint8> data;
+	for (uint8 i = 0; i < count; ++i)
+	{
+		data.push_back(uint8(first + i));
+		bytes[base + address + i] = uint8(first + i);
+	}
+	return record(address, 0, data, lineEnd);
+}
+
+//! Return an extended linear address record setting the upper 16 bits of addresses
+static std::string extendedAddressRecord(uint16 high)
+{
+	std::vector<uint8> data;
+	data.push_back(uint8(high >> 8));
+	data.push_back(uint8(high));
+	return record(0, 4, data, "\n");
+}
+
+//! Check that the chunks of hexFile hold exactly bytes, in maximal runs of consecutive addresses
+static void checkChunks(const HexFile& hexFile, const ByteMap& bytes, const char* what)
+{
+	// group the bytes into runs of consecutive addresses
+	HexFile::ChunkMap expected;
+	for (ByteMap::const_iterator it = bytes.begin(); it != bytes.end(); ++it)
+	{
+		HexFile::ChunkMap::reverse_iterator last(expected.rbegin());
+		if ((last != expected.rend()) && (last->first + last->second.size() == it->first))
+			last->second.push_back(it->second);
+		else
+			expected[it->first].push_back(it->second);
+	}
+
+	if (hexFile.data.size() != expected.size())
+	{
+		std::cerr << what << ": " << hexFile.data.size() << " chunks instead of " << expected.size() << std::endl;
+		++failures;
+	}
+	for (HexFile::ChunkMap::const_iterator it = expected.begin(); it != expected.end(); ++it)
+	{
+		const HexFile::ChunkMap::const_iterator chunk(hexFile.data.find(it->first));
+		if (chunk == hexFile.data.end())
+		{
+			std::cerr << what << ": no chunk at " << std::hex << it->first << std::dec << std::endl;
+			++failures;
+		}
+		else if (chunk->second != it->second)
+		{
+			std::cerr << what << ": chunk at " << std::hex << it->first << std::dec << " has " << chunk->second.size() << " bytes instead of " << it->second.size();
+			for (size_t i = 0; (i < chunk->second.size()) && (i < it->second.size()); ++i)
+				if (chunk->second[i] != it->second[i])
+				{
+					std::cerr << ", byte " << i << " differs";
+					break;
+				}
+			std::cerr << std::endl;
+			++failures;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string fileName(argc > 1 ? argv[1] : "aseba-test-hexfile.hex");
+	ByteMap bytes;
+	std::string text;
+
+	// records out of order, with a gap between 0x1020 and 0x1030
+	text += dataRecord(0, 0x1030, 16, 0x30, bytes);
+	text += dataRecord(0, 0x1000, 16, 0x00, bytes);
+	// adjacent to the end of the first chunk, then to the start of the second one, closing the gap
+	text += dataRecord(0, 0x1010, 16, 0x10, bytes);
+	text += dataRecord(0, 0x1020, 16, 0x20, bytes, "\r\n");
+	// overlapping the end of a chunk, the later record wins
+	text += dataRecord(0, 0x1038, 16, 0x80, bytes, "\r\n");
+	// inside an existing chunk
+	text += dataRecord(0, 0x1004, 4, 0xa0, bytes);
+	// before a chunk, overlapping its start
+	text += dataRecord(0, 0x0ff8, 12, 0xc0, bytes);
+	// separate chunks, then one record covering them and the gap between them
+	text += dataRecord(0, 0x2010, 4, 0x01, bytes);
+	text += dataRecord(0, 0x2000, 4, 0x02, bytes);
+	text += dataRecord(0, 0x2008, 4, 0x03, bytes);
+	text += dataRecord(0, 0x2002, 20, 0x40, bytes);
+	// in another 64 KB segment, out of order
+	text += extendedAddressRecord(1);
+	text += dataRecord(0x10000, 0x0010, 8, 0x50, bytes);
+	text += dataRecord(0x10000, 0x0008, 8, 0x60, bytes);
+	text += extendedAddressRecord(0);
+	text += dataRecord(0, 0x3000, 2, 0x70, bytes);
+	text += ":00000001FF\r\n";
+
+	{
+		std::ofstream ofs(fileName.c_str(), std::ios::binary);
+		ofs << text;
+	}
+
+	HexFile hexFile;
+	try
+	{
+		hexFile.read(fileName);
+	}
+	catch (const HexFile::Error& e)
+	{
+		std::cerr << "cannot read " << fileName << ": " << e.toString() << std::endl;
+		remove(fileName.c_str());
+		return EXIT_FAILURE;
+	}
+	checkChunks(hexFile, bytes, "read");
+
+	// the written file has the same chunks, and uses \n line ends on all platforms
+	HexFile written;
+	try
+	{
+		hexFile.write(fileName);
+		written.read(fileName);
+	}
+	catch (const HexFile::Error& e)
+	{
+		std::cerr << "cannot write and read back " << fileName << ": " << e.toString() << std::endl;
+		remove(fileName.c_str());
+		return EXIT_FAILURE;
+	}
+	checkChunks(written, bytes, "written");
+	{
+		std::ifstream ifs(fileName.c_str(), std::ios::binary);
+		const std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		if (content.find('\r') != std::string::npos)
+		{
+			std::cerr << "written file contains \\r" << std::endl;
+			++failures;
+		}
+	}
+	remove(fileName.c_str());
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+// Check that frames written to a binary log are read back identically,
+// whether the log was properly closed, truncated, or has a corrupted index cache
+
+// Aseba
+#include "../clients/replay/logfile.h"
+
+// C++
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// C
+#include <stdio.h>
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+using namespace Aseba;
+
+//! Number of frames written, enough for the seek index to have several entries
+static const unsigned framesCount = 3000;
+//! Time of the start of the recording
+static const UnifiedTime::Value startTime = 1000000;
+
+//! Return the raw message of the i-th frame, a user message of i % 4 words
+static std::vector<uint8> frameData(unsigned i)
+{
+	const uint16 len(uint16(2 * (i % 4)));
+	std::vector<uint8> frame;
+	frame.push_back(uint8(len)); frame.push_back(0);
+	frame.push_back(uint8(i % 3 + 1)); frame.push_back(0);
+	frame.push_back(uint8(i % 5)); frame.push_back(0);
+	for (uint16 j = 0; j < len; ++j)
+		frame.push_back(uint8(i + j));
+	return frame;
+}
+
+//! Return the time of the i-th frame, in ms since 1970, with regular jumps for the index to have entries for time
+static UnifiedTime::Value frameTime(unsigned i)
+{
+	return startTime + i * 3 + (i / 7) * 200;
+}
+
+//! Write all frames to fileName, return the content of the file
+static std::vector<uint8> writeLog(const std::string& fileName)
+{
+	FILE* file(fopen(fileName.c_str(), "wb"));
+	if (!file)
+		return std::vector<uint8>();
+	{
+		LogWriter writer(file, 0, UnifiedTime(startTime));
+		for (unsigned i = 0; i < framesCount; ++i)
+		{
+			const std::vector<uint8> frame(frameData(i));
+			writer.write(UnifiedTime(frameTime(i)), &frame[0], frame.size());
+		}
+	}
+	fclose(file);
+
+	file = fopen(fileName.c_str(), "rb");
+	std::vector<uint8> content;
+	int c;
+	while ((c = fgetc(file)) != EOF)
+		content.push_back(uint8(c));
+	fclose(file);
+	return content;
+}
+
+//! Write content to fileName
+static void writeFile(const std::string& fileName, const std::vector<uint8>& content)
+{
+	FILE* file(fopen(fileName.c_str(), "wb"));
+	fwrite(&content[0], 1, content.size(), file);
+	fclose(file);
+}
+
+//! Read fileName and check that it contains the first expectedCount frames, return the number of errors
+static unsigned checkLog(const std::string& fileName, unsigned expectedCount, const char* what)
+{
+	LogReader reader(fileName);
+	if (!reader.isValid())
+	{
+		std::cerr << what << ": log is invalid" << std::endl;
+		return 1;
+	}
+	if (reader.getStartTime() != startTime)
+	{
+		std::cerr << what << ": start time " << reader.getStartTime() << " instead of " << startTime << std::endl;
+		return 1;
+	}
+
+	unsigned count(0);
+	LogFrame frame;
+	while (reader.next(frame))
+	{
+		const std::vector<uint8> expected(frameData(count));
+		if ((count >= expectedCount) ||
+			(frame.time != frameTime(count)) ||
+			(frame.rawSize() != expected.size()) ||
+			!std::equal(expected.begin(), expected.end(), frame.raw)
+		)
+		{
+			std::cerr << what << ": frame " << count << " differs" << std::endl;
+			return 1;
+		}
+		++count;
+	}
+	if (count != expectedCount)
+	{
+		std::cerr << what << ": read " << count << " frames instead of " << expectedCount << std::endl;
+		return 1;
+	}
+
+	// seeking must lead to a frame not later than the requested time
+	if (reader.getIndex().size() < 2)
+	{
+		std::cerr << what << ": seek index has only " << reader.getIndex().size() << " entries" << std::endl;
+		return 1;
+	}
+	const unsigned target(expectedCount * 2 / 3);
+	reader.seek(frameTime(target));
+	if (!reader.next(frame) || (frame.time > frameTime(target)))
+	{
+		std::cerr << what << ": seek to frame " << target << " went too far" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string fileName(argc > 1 ? argv[1] : "aseba-test-logfile.log");
+	const std::string cacheFileName(fileName + ".idx");
+	unsigned failures(0);
+
+	// properly closed log, with its index
+	remove(cacheFileName.c_str());
+	const std::vector<uint8> content(writeLog(fileName));
+	if (content.empty())
+	{
+		std::cerr << "cannot write " << fileName << std::endl;
+		return EXIT_FAILURE;
+	}
+	failures += checkLog(fileName, framesCount, "closed log");
+
+	// log truncated in the middle of the last frame, the index is rebuilt and cached
+	size_t lastFrameStart(0);
+	{
+		LogReader reader(fileName);
+		for (LogIndex::const_iterator it = reader.getIndex().begin(); it != reader.getIndex().end(); ++it)
+			lastFrameStart = size_t(it->offset);
+	}
+	// keep the frames before the last indexed one, and the beginning of it
+	const std::vector<uint8> truncated(content.begin(), content.begin() + lastFrameStart + 3);
+	writeFile(fileName, truncated);
+	remove(cacheFileName.c_str());
+	unsigned truncatedCount(0);
+	{
+		LogReader reader(fileName);
+		LogFrame frame;
+		while (reader.next(frame))
+			++truncatedCount;
+	}
+	if ((truncatedCount == 0) || (truncatedCount >= framesCount))
+	{
+		std::cerr << "truncated log has " << truncatedCount << " frames" << std::endl;
+		++failures;
+	}
+	failures += checkLog(fileName, truncatedCount, "truncated log, rebuilt index");
+	failures += checkLog(fileName, truncatedCount, "truncated log, cached index");
+
+	// corrupted cache announcing more entries than it contains, the index must be rebuilt
+	{
+		FILE* file(fopen(cacheFileName.c_str(), "r+b"));
+		if (file)
+		{
+			const uint8 hugeCount[8] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0f };
+			fseek(file, 24, SEEK_SET);
+			fwrite(hugeCount, 1, sizeof(hugeCount), file);
+			fclose(file);
+		}
+		else
+		{
+			std::cerr << "index cache " << cacheFileName << " was not written" << std::endl;
+			++failures;
+		}
+	}
+	failures += checkLog(fileName, truncatedCount, "truncated log, corrupted cache");
+
+	// truncated cache
+	{
+		FILE* file(fopen(cacheFileName.c_str(), "rb"));
+		std::vector<uint8> cache;
+		int c;
+		while (file && ((c = fgetc(file)) != EOF))
+			cache.push_back(uint8(c));
+		if (file)
+			fclose(file);
+		if (cache.size() > 40)
+		{
+			cache.resize(cache.size() - 8);
+			writeFile(cacheFileName, cache);
+		}
+	}
+	failures += checkLog(fileName, truncatedCount, "truncated log, truncated cache");
+
+	remove(fileName.c_str());
+	remove(cacheFileName.c_str());
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
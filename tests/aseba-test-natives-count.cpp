@@ -9,7 +9,9 @@ int main(int argc, char*argv[])
 {
 	AsebaNativeFunctionPointer defaultNatives[] ={ ASEBA_NATIVES_STD_FUNCTIONS };
 	size_t nativesCount = (sizeof(defaultNatives)/sizeof(AsebaNativeFunctionPointer));
-	if (nativesCount != ASEBA_NATIVES_STD_COUNT)
+	AsebaNativeFunctionPointer dspNatives[] ={ ASEBA_NATIVES_DSP_FUNCTIONS };
+	size_t dspNativesCount = (sizeof(dspNatives)/sizeof(AsebaNativeFunctionPointer));
+	if ((nativesCount != ASEBA_NATIVES_STD_COUNT) || (dspNativesCount != ASEBA_NATIVES_DSP_COUNT))
 		return 1;
 	else
 		return 0;
@@ -0,0 +1,171 @@
+// Check that the element-wise natives, vectorized on hosts with a vector unit,
+// give exactly the same memory as the scalar loops, on random vectors and placements
+
+// Aseba
+#include "natives-reference.h"
+
+// C++
+#include <iostream>
+#include <vector>
+
+// C
+#include <stdlib.h>		// atoi(), rand()
+
+// this prevents a link problem when compiling in debug
+void AsebaSendMessage(AsebaVMState *vm, uint16 id, const void *data, uint16 size)
+{
+}
+
+//! Number of variables holding vectors, the shift of math.dot being after them
+static const uint16 vectorsSize = 240;
+//! Variable holding the shift of math.dot
+static const uint16 shiftVar = 250;
+
+//! Return a random value, often an extreme one to exercise wrap-around
+static sint16 randomValue()
+{
+	switch (rand() % 8)
+	{
+		case 0: return -32768;
+		case 1: return 32767;
+		case 2: return sint16(rand() % 5 - 2);
+		default: return sint16(rand());
+	}
+}
+
+//! Return a random length, often around multiples of vector widths
+static uint16 randomLength()
+{
+	if (rand() % 4 == 0)
+		return uint16(rand() % vectorsSize / 2);
+	return uint16(rand() % 40);
+}
+
+//! Return a random start for a vector of length, near the others so that they often overlap
+static uint16 randomStart(uint16 length)
+{
+	const uint16 window(vectorsSize - length < 48 ? vectorsSize - length : 48);
+	return uint16(rand() % (window + 1));
+}
+
+//! Fill both memories with the same random values
+static void randomize(NativesVM& vm, std::vector<sint16>& reference)
+{
+	for (size_t i = 0; i < vm.variables.size(); ++i)
+		vm.variables[i] = randomValue();
+	vm.variables[shiftVar] = sint16(rand() % 32);
+	reference = vm.variables;
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned rounds(argc > 1 ? atoi(argv[1]) : 20000);
+	const char* binaryNames[] = { "math.add", "math.sub", "math.mul", "math.min", "math.max" };
+	const AsebaNativeFunctionPointer binaryNatives[] = { AsebaNative_vecadd, AsebaNative_vecsub, AsebaNative_vecmul, AsebaNative_vecmin, AsebaNative_vecmax };
+	const ReferenceBinary binaryReferences[] = { referenceAdd, referenceSub, referenceMul, referenceMin, referenceMax };
+
+	NativesVM vm(256);
+	std::vector<sint16> reference;
+	unsigned failures(0);
+
+	srand(0);
+	for (unsigned round = 0; round < rounds; ++round)
+	{
+		const uint16 length(randomLength());
+
+		for (size_t n = 0; n < sizeof(binaryNatives) / sizeof(binaryNatives[0]); ++n)
+		{
+			randomize(vm, reference);
+			std::vector<uint16> args(4);
+			args[0] = randomStart(length);
+			args[1] = randomStart(length);
+			args[2] = randomStart(length);
+			args[3] = length;
+			vm.call(binaryNatives[n], args);
+			binaryReferences[n](&reference[0], args[0], args[1], args[2], length);
+			if (vm.variables != reference)
+			{
+				std::cerr << binaryNames[n] << " differs for dest " << args[0] << ", src1 " << args[1] << ", src2 " << args[2] << ", length " << length << std::endl;
+				++failures;
+			}
+		}
+
+		{
+			randomize(vm, reference);
+			std::vector<uint16> args(5);
+			for (size_t i = 0; i < 4; ++i)
+				args[i] = randomStart(length);
+			args[4] = length;
+			vm.call(AsebaNative_vecclamp, args);
+			referenceClamp(&reference[0], args[0], args[1], args[2], args[3], length);
+			if (vm.variables != reference)
+			{
+				std::cerr << "math.clamp differs for dest " << args[0] << ", src " << args[1] << ", low " << args[2] << ", high " << args[3] << ", length " << length << std::endl;
+				++failures;
+			}
+		}
+
+		{
+			randomize(vm, reference);
+			std::vector<uint16> args(5);
+			args[0] = randomStart(1);
+			args[1] = randomStart(length);
+			args[2] = randomStart(length);
+			args[3] = shiftVar;
+			args[4] = length;
+			vm.call(AsebaNative_vecdot, args);
+			referenceDot(&reference[0], args[0], args[1], args[2], args[3], length);
+			if (vm.variables != reference)
+			{
+				std::cerr << "math.dot differs for dest " << args[0] << ", src1 " << args[1] << ", src2 " << args[2] << ", shift " << vm.variables[shiftVar] << ", length " << length << std::endl;
+				++failures;
+			}
+		}
+
+		{
+			randomize(vm, reference);
+			std::vector<uint16> args(5);
+			args[0] = randomStart(length);
+			args[1] = randomStart(1);
+			args[2] = randomStart(1);
+			args[3] = randomStart(1);
+			args[4] = length;
+			vm.call(AsebaNative_vecstat, args);
+			referenceStat(&reference[0], args[0], args[1], args[2], args[3], length);
+			if (vm.variables != reference)
+			{
+				std::cerr << "math.stat differs for src " << args[0] << ", min " << args[1] << ", max " << args[2] << ", mean " << args[3] << ", length " << length << std::endl;
+				++failures;
+			}
+		}
+	}
+
+	// long vectors of extreme values, for the accumulations of math.dot and math.stat not to overflow
+	NativesVM longVM(4100);
+	for (unsigned round = 0; round < 64; ++round)
+	{
+		for (size_t i = 0; i < 4096; ++i)
+			longVM.variables[i] = (round % 2 == 0) ? sint16(-32768) : randomValue();
+		longVM.variables[4096] = sint16(round % 33);
+		reference = longVM.variables;
+		std::vector<uint16> args(5);
+		args[0] = 4097; args[1] = 0; args[2] = (round % 4 < 2) ? 0 : 2048; args[3] = 4096; args[4] = 2048;
+		longVM.call(AsebaNative_vecdot, args);
+		referenceDot(&reference[0], args[0], args[1], args[2], args[3], args[4]);
+		args[0] = 0; args[1] = 4097; args[2] = 4098; args[3] = 4099; args[4] = 4096;
+		longVM.call(AsebaNative_vecstat, args);
+		referenceStat(&reference[0], args[0], args[1], args[2], args[3], args[4]);
+		if (longVM.variables != reference)
+		{
+			std::cerr << "math.dot or math.stat differs on long vectors, shift " << longVM.variables[4096] << std::endl;
+			++failures;
+		}
+	}
+
+	if (failures)
+	{
+		std::cerr << failures << " calls differ from the scalar loops" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
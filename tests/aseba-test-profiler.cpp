@@ -0,0 +1,149 @@
+// Check the counters of the profiler of the VM on a small program,
+// this test is compiled with ASEBA_VM_PROFILER along with its own copy of the VM
+
+// Aseba
+#include "test-node.h"
+
+// C++
+#include <iostream>
+#include <map>
+
+// C
+#include <stdlib.h>		// EXIT_SUCCESS, EXIT_FAILURE
+
+#ifndef ASEBA_VM_PROFILER
+#error This test must be compiled with ASEBA_VM_PROFILER
+#endif // ASEBA_VM_PROFILER
+
+// event1 runs 9 instructions and 1 native function, and calls inc twice,
+// inc runs 9 instructions and 1 native function, event2 runs 3 instructions
+static const char* source =
+	"var a[4]\n"
+	"var b\n"
+	"sub inc\n"
+	"	b = b + 1\n"
+	"	call math.fill(a, b)\n"
+	"onevent event1\n"
+	"	callsub inc\n"
+	"	callsub inc\n"
+	"	call math.fill(a, 0)\n"
+	"onevent event2\n"
+	"	b = 5\n";
+
+//! Expected counters of an entry
+struct Expected
+{
+	uint32 instructionsCount;
+	uint32 nativeCallsCount;
+};
+
+//! Number of failed checks
+static unsigned failures = 0;
+
+//! Run event to its end one step at a time, return the number of steps
+static unsigned runEvent(AsebaNode& node, uint16 event)
+{
+	unsigned steps(0);
+	AsebaVMSetupEvent(&node.vm, event);
+	while (AsebaMaskIsSet(node.vm.flags, ASEBA_VM_EVENT_ACTIVE_MASK) && (steps < 1000))
+	{
+		AsebaVMRun(&node.vm, 1);
+		++steps;
+	}
+	return steps;
+}
+
+//! Check the counters of the profiler against expected, by address, for rounds runs
+static void checkCounters(const AsebaVMProfiler& profiler, const std::map<uint16, Expected>& expected, unsigned rounds, unsigned steps)
+{
+	if (profiler.entriesCount != expected.size())
+	{
+		std::cerr << profiler.entriesCount << " entries instead of " << expected.size() << std::endl;
+		++failures;
+	}
+	uint32 instructionsCount(0);
+	for (uint16 i = 0; i < profiler.entriesCount; ++i)
+	{
+		const AsebaVMProfilerEntry& entry(profiler.entries[i]);
+		instructionsCount += entry.instructionsCount;
+		const std::map<uint16, Expected>::const_iterator it(expected.find(entry.address));
+		if (it == expected.end())
+		{
+			std::cerr << "unexpected entry at address " << entry.address << std::endl;
+			++failures;
+		}
+		else if ((entry.instructionsCount != it->second.instructionsCount * rounds) || (entry.nativeCallsCount != it->second.nativeCallsCount * rounds))
+		{
+			std::cerr << "entry at address " << entry.address << ": " << entry.instructionsCount << " instructions and " << entry.nativeCallsCount << " native calls, expected " << it->second.instructionsCount * rounds << " and " << it->second.nativeCallsCount * rounds << std::endl;
+			++failures;
+		}
+	}
+	// every step must be counted once
+	if (instructionsCount != steps)
+	{
+		std::cerr << instructionsCount << " instructions counted for " << steps << " steps" << std::endl;
+		++failures;
+	}
+}
+
+int main()
+{
+	AsebaNode node;
+	AsebaVMProfilerEntry entries[8];
+	AsebaVMProfiler profiler;
+	profiler.entriesSize = 8;
+	profiler.entries = entries;
+	profiler.clock = 0;
+	node.vm.profiler = &profiler;
+	AsebaVMInit(&node.vm);
+
+	CommonDefinitions definitions;
+	definitions.events.push_back(NamedValue(L"event1", 0));
+	definitions.events.push_back(NamedValue(L"event2", 0));
+	const std::string narrowSource(source);
+	if (!node.compile(std::wstring(narrowSource.begin(), narrowSource.end()), definitions))
+		return EXIT_FAILURE;
+
+	const uint16 event1Address(AsebaVMGetEventAddress(&node.vm, 0));
+	const uint16 event2Address(AsebaVMGetEventAddress(&node.vm, 1));
+	std::map<uint16, Expected> expected;
+	const Expected event1Counters = { 9, 1 };
+	const Expected incCounters = { 2 * 9, 2 * 1 };
+	const Expected event2Counters = { 3, 0 };
+	expected[event1Address] = event1Counters;
+	// inc follows event2, which has 3 words
+	expected[event2Address + 3] = incCounters;
+	expected[event2Address] = event2Counters;
+
+	// counters accumulate over runs
+	unsigned steps(0);
+	for (unsigned round = 1; round <= 2; ++round)
+	{
+		steps += runEvent(node, 0);
+		steps += runEvent(node, 1);
+		checkCounters(profiler, expected, round, steps);
+	}
+
+	// the node sends one message per entry, then forgets them on reset
+	uint16 dest(node.vm.nodeId);
+	sentMessages.clear();
+	AsebaVMDebugMessage(&node.vm, ASEBA_MESSAGE_GET_PROFILE, &dest, 1);
+	if ((sentMessages.size() != 3) || (sentMessages[0].type != ASEBA_MESSAGE_PROFILE) || (sentMessages[0].words[0] != 3))
+	{
+		std::cerr << "GetProfile answered with " << sentMessages.size() << " messages instead of 3" << std::endl;
+		++failures;
+	}
+	AsebaVMDebugMessage(&node.vm, ASEBA_MESSAGE_RESET_PROFILE, &dest, 1);
+	if (profiler.entriesCount != 0)
+	{
+		std::cerr << "ResetProfile kept " << profiler.entriesCount << " entries" << std::endl;
+		++failures;
+	}
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
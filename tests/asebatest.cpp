@@ -1,8 +1,5 @@
 // Aseba
-#include "../compiler/compiler.h"
-#include "../vm/vm.h"
-#include "../vm/natives.h"
-#include "../common/consts.h"
+#include "test-node.h"
 #include "../common/utils/utils.h"
 #include "../common/utils/FormatableString.h"
 using namespace Aseba;
@@ -23,7 +20,7 @@ using namespace Aseba;
 std::wstring read_source(const std::string& filename);
 void dump_source(const std::wstring& source);
 
-static const char short_options [] = "fcepnsdmi:";
+static const char short_options [] = "fcepnsdmi:a";
 static const struct option long_options[] = { 
 	{ "fail",	no_argument,			NULL,	'f'},
 	{ "comp_fail",	no_argument,		NULL,	'c'},
@@ -35,6 +32,7 @@ static const struct option long_options[] = {
 	{ "memdump",	no_argument,		NULL,	'u'},
 	{ "memcmp", 	required_argument,	NULL,	'm'},
 	{ "steps", 		required_argument,	NULL,	'i'},
+	{ "native_args",no_argument,		NULL,	'a'},
 	{ 0, 0, 0, 0 } 
 };
 
@@ -50,205 +48,10 @@ static void usage (int argc, char** argv)
 			<< "    -s | --source       Dump the source code" << std::endl
 			<< "    -d | --dump         Dump the compilation result (tokens, tree, bytecode)" << std::endl
 			<< "    -u | --memdump      Dump the memory content at the end of the execution" << std::endl
-			<< "    -m | --memcmp file  Compare result of the VM execution with file" << std::endl;
+			<< "    -m | --memcmp file  Compare result of the VM execution with file" << std::endl
+			<< "    -a | --native_args  Put constant arguments of native calls after them in bytecode, not yet used by nodes" << std::endl;
 }
 
-static bool executionError(false);
-
-extern "C" void AsebaSendMessage(AsebaVMState *vm, uint16 type, const void *data, uint16 size)
-{
-	switch (type)
-	{
-		case ASEBA_MESSAGE_DIVISION_BY_ZERO:
-		std::cerr << "Division by zero" << std::endl;
-		executionError = true;
-		break;
-		
-		case ASEBA_MESSAGE_ARRAY_ACCESS_OUT_OF_BOUNDS:
-		std::cerr << "Array access out of bounds" << std::endl;
-		executionError = true;
-		break;
-		
-		default:
-		std::cerr << "AsebaSendMessage of type " << type << ", size " << size << std::endl;
-		break;
-	}
-}
-
-#ifdef __BIG_ENDIAN__
-extern "C" void AsebaSendMessageWords(AsebaVMState *vm, uint16 type, const uint16* data, uint16 count)
-{
-	AsebaSendMessage(vm, type, data, count*2);
-}
-#endif
-
-extern "C" void AsebaSendVariables(AsebaVMState *vm, uint16 start, uint16 length)
-{
-	std::cerr << "AsebaSendVariables at pos " << start << ", length " << length << std::endl;
-}
-
-extern "C" void AsebaSendDescription(AsebaVMState *vm)
-{
-	std::cerr << "AsebaSendDescription" << std::endl;
-}
-
-extern "C" void AsebaPutVmToSleep(AsebaVMState *vm)
-{
-	std::cerr << "AsebaPutVmToSleep" << std::endl;
-}
-
-static AsebaNativeFunctionPointer nativeFunctions[] =
-{
-	ASEBA_NATIVES_STD_FUNCTIONS,
-};
-
-static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] =
-{
-	ASEBA_NATIVES_STD_DESCRIPTIONS,
-	0
-};
-
-extern "C" const AsebaNativeFunctionDescription * const * AsebaGetNativeFunctionsDescriptions(AsebaVMState *vm)
-{
-	return nativeFunctionsDescriptions;
-}
-
-extern "C" void AsebaNativeFunction(AsebaVMState *vm, uint16 id)
-{
-	nativeFunctions[id](vm);
-}
-
-extern "C" void AsebaWriteBytecode(AsebaVMState *vm)
-{
-	std::cerr << "AsebaWriteBytecode" << std::endl;
-}
-
-extern "C" void AsebaResetIntoBootloader(AsebaVMState *vm)
-{
-	std::cerr << "AsebaResetIntoBootloader" << std::endl;
-}
-
-extern "C" void AsebaAssert(AsebaVMState *vm, AsebaAssertReason reason)
-{
-	std::cerr << "\nFatal error, internal VM exception: ";
-	switch (reason)
-	{
-		case ASEBA_ASSERT_UNKNOWN: std::cerr << "undefined"; break;
-		case ASEBA_ASSERT_UNKNOWN_UNARY_OPERATOR: std::cerr << "unknown unary operator"; break;
-		case ASEBA_ASSERT_UNKNOWN_BINARY_OPERATOR: std::cerr << "unknown binary operator"; break;
-		case ASEBA_ASSERT_UNKNOWN_BYTECODE: std::cerr << "unknown bytecode"; break;
-		case ASEBA_ASSERT_STACK_OVERFLOW: std::cerr << "stack overflow"; break;
-		case ASEBA_ASSERT_STACK_UNDERFLOW: std::cerr << "stack underflow"; break;
-		case ASEBA_ASSERT_OUT_OF_VARIABLES_BOUNDS: std::cerr << "out of variables bounds"; break;
-		case ASEBA_ASSERT_OUT_OF_BYTECODE_BOUNDS: std::cerr << "out of bytecode bounds"; break;
-		case ASEBA_ASSERT_STEP_OUT_OF_RUN: std::cerr << "step out of run"; break;
-		case ASEBA_ASSERT_BREAKPOINT_OUT_OF_BYTECODE_BOUNDS: std::cerr << "breakpoint out of bytecode bounds"; break;
-		case ASEBA_ASSERT_EMIT_BUFFER_TOO_LONG: std::cerr << "tried to emit a buffer too long"; break;
-		default: std::cerr << "unknown exception"; break;
-	}
-	std::cerr << ".\npc = " << vm->pc << ", sp = " << vm->sp;
-	std::cerr << "\nResetting VM" << std::endl;
-	executionError = true;
-	AsebaVMInit(vm);
-}
-
-struct AsebaNode
-{
-	AsebaVMState vm;
-	std::valarray<unsigned short> bytecode;
-	std::valarray<signed short> stack;
-	TargetDescription d;
-	
-	struct Variables
-	{
-		sint16 user[256];
-	} variables;
-
-	AsebaNode()
-	{
-		// create VM
-		vm.nodeId = 0;
-		bytecode.resize(512);
-		vm.bytecode = &bytecode[0];
-		vm.bytecodeSize = bytecode.size();
-		
-		stack.resize(64);
-		vm.stack = &stack[0];
-		vm.stackSize = stack.size();
-		
-		vm.variables = reinterpret_cast<sint16 *>(&variables);
-		vm.variablesSize = sizeof(variables) / sizeof(sint16);
-		
-		AsebaVMInit(&vm);
-		
-		// fill description accordingly
-		d.name = L"testvm";
-		d.protocolVersion = ASEBA_PROTOCOL_VERSION;
-		
-		d.bytecodeSize = vm.bytecodeSize;
-		d.variablesSize = vm.variablesSize;
-		d.stackSize = vm.stackSize;
-		
-		/*d.namedVariables.push_back(TargetDescription::NamedVariable("id", 1));
-		d.namedVariables.push_back(TargetDescription::NamedVariable("source", 1));
-		d.namedVariables.push_back(TargetDescription::NamedVariable("args", 32));*/
-		
-		const AsebaNativeFunctionDescription** nativeDescs(nativeFunctionsDescriptions);
-		while (*nativeDescs)
-		{
-			const AsebaNativeFunctionDescription* nativeDesc(*nativeDescs);
-			std::string name(nativeDesc->name);
-			std::string doc(nativeDesc->doc);
-			
-			TargetDescription::NativeFunction native(
-				std::wstring(name.begin(), name.end()),
-				std::wstring(doc.begin(), doc.end())
-			);
-			
-			const AsebaNativeFunctionArgumentDescription* params(nativeDesc->arguments);
-			while (params->size)
-			{
-				AsebaNativeFunctionArgumentDescription param(*params);
-				name = param.name;
-				int size = param.size;
-				native.parameters.push_back(
-					TargetDescription::NativeFunctionParameter(std::wstring(name.begin(), name.end()), size)
-				);
-				++params;
-			}
-			
-			d.nativeFunctions.push_back(native);
-			
-			++nativeDescs;
-		}
-	}
-	
-	const TargetDescription* getTargetDescription() const
-	{
-		return &d;
-	}
-
-	bool loadBytecode(const BytecodeVector& bytecode)
-	{
-		size_t i = 0;
-		for (BytecodeVector::const_iterator it(bytecode.begin()); it != bytecode.end(); ++it)
-		{
-			if (i == vm.bytecodeSize)
-				return false;
-			const BytecodeElement& be(*it);
-			vm.bytecode[i++] = be.bytecode;
-		}
-		return true;
-	}
-	
-	void run(int stepCount)
-	{
-		// run VM
-		AsebaVMSetupEvent(&vm, ASEBA_EVENT_INIT);
-		AsebaVMRun(&vm, stepCount);
-	}
-};
-
 void checkForError(const std::string& module, bool shouldFail, bool wasError, const std::wstring& errorMessage = L"")
 {
 	if (wasError)
@@ -287,6 +90,7 @@ int main(int argc, char** argv)
 	bool dump = false;
 	bool memDump = false;
 	bool memCmp = false;
+	bool nativeArgs = false;
 	int stepCount = 1000;
 	std::string memCmpFileName;
 	
@@ -338,6 +142,9 @@ int main(int argc, char** argv)
 				memCmp = true;
 				memCmpFileName = optarg;
 				break;
+			case 'a':
+				nativeArgs = true;
+				break;
 			case 'i':
 				stepCount = atoi(optarg);
 			default:
@@ -385,6 +192,7 @@ int main(int argc, char** argv)
 	Error outError;
 
 	// compile
+	node.d.nativeCallArgsBlocks = nativeArgs;
 	compiler.setTargetDescription(node.getTargetDescription());
 	compiler.setCommonDefinitions(&definitions);
 	if (dump)
@@ -0,0 +1,127 @@
+#ifndef ASEBA_TESTS_NATIVES_REFERENCE_H
+#define ASEBA_TESTS_NATIVES_REFERENCE_H
+
+// Scalar versions of the element-wise natives, written as the generic loops of vm/natives.c,
+// to check and to measure the vectorized versions against them
+
+#include "../vm/vm.h"
+#include "../vm/natives.h"
+
+#include <vector>
+
+//! A VM state with only what natives use, variables and a stack for their arguments
+struct NativesVM
+{
+	AsebaVMState vm;
+	std::vector<sint16> variables;
+	std::vector<sint16> stack;
+
+	NativesVM(uint16 variablesSize) :
+		variables(variablesSize),
+		stack(8)
+	{
+		vm.variables = &variables[0];
+		vm.variablesSize = variables.size();
+		vm.stack = &stack[0];
+		vm.stackSize = stack.size();
+		vm.sp = -1;
+		vm.nativeArgs = 0;
+	}
+
+	//! Call native with args, given in the order of its description, followed by the length of the vectors
+	void call(AsebaNativeFunctionPointer native, const std::vector<uint16>& args)
+	{
+		vm.sp = -1;
+		for (size_t i = args.size(); i > 0; --i)
+			vm.stack[++vm.sp] = args[i - 1];
+		native(&vm);
+	}
+};
+
+typedef void (*ReferenceBinary)(sint16* v, uint16 dest, uint16 src1, uint16 src2, uint16 length);
+
+static void referenceAdd(sint16* v, uint16 dest, uint16 src1, uint16 src2, uint16 length)
+{
+	for (uint16 i = 0; i < length; i++)
+		v[dest++] = v[src1++] + v[src2++];
+}
+
+static void referenceSub(sint16* v, uint16 dest, uint16 src1, uint16 src2, uint16 length)
+{
+	for (uint16 i = 0; i < length; i++)
+		v[dest++] = v[src1++] - v[src2++];
+}
+
+static void referenceMul(sint16* v, uint16 dest, uint16 src1, uint16 src2, uint16 length)
+{
+	for (uint16 i = 0; i < length; i++)
+		v[dest++] = v[src1++] * v[src2++];
+}
+
+static void referenceMin(sint16* v, uint16 dest, uint16 src1, uint16 src2, uint16 length)
+{
+	for (uint16 i = 0; i < length; i++)
+	{
+		sint16 v1 = v[src1++];
+		sint16 v2 = v[src2++];
+		v[dest++] = v1 < v2 ? v1 : v2;
+	}
+}
+
+static void referenceMax(sint16* v, uint16 dest, uint16 src1, uint16 src2, uint16 length)
+{
+	for (uint16 i = 0; i < length; i++)
+	{
+		sint16 v1 = v[src1++];
+		sint16 v2 = v[src2++];
+		v[dest++] = v1 > v2 ? v1 : v2;
+	}
+}
+
+static void referenceClamp(sint16* v, uint16 dest, uint16 src, uint16 low, uint16 high, uint16 length)
+{
+	for (uint16 i = 0; i < length; i++)
+	{
+		sint16 x = v[src++];
+		sint16 l = v[low++];
+		sint16 h = v[high++];
+		v[dest++] = x > h ? h : (x < l ? l : x);
+	}
+}
+
+static void referenceDot(sint16* v, uint16 dest, uint16 src1, uint16 src2, uint16 shift, uint16 length)
+{
+	const sint16 shiftValue = v[shift];
+	// unsigned, so that the wrap-around of the accumulator is defined
+	uint32 res = 0;
+	if (shiftValue > 32)
+	{
+		v[dest] = 0;
+		return;
+	}
+	for (uint16 i = 0; i < length; i++)
+		res += uint32(sint32(v[src1++]) * sint32(v[src2++]));
+	v[dest] = sint16(sint32(res) >> shiftValue);
+}
+
+static void referenceStat(sint16* v, uint16 src, uint16 min, uint16 max, uint16 mean, uint16 length)
+{
+	if (!length)
+		return;
+	sint16 val = v[src++];
+	sint32 acc = val;
+	v[min] = val;
+	v[max] = val;
+	for (uint16 i = 1; i < length; i++)
+	{
+		val = v[src++];
+		if (val < v[min])
+			v[min] = val;
+		if (val > v[max])
+			v[max] = val;
+		acc += val;
+	}
+	v[mean] = sint16(acc / sint32(length));
+}
+
+#endif // ASEBA_TESTS_NATIVES_REFERENCE_H
@@ -0,0 +1,279 @@
+#ifndef ASEBA_TESTS_TEST_NODE_H
+#define ASEBA_TESTS_TEST_NODE_H
+
+// A VM with the standard and DSP natives and the glue functions it needs,
+// along with its description for the compiler, shared by the tests running compiled programs;
+// as it defines the glue functions, it must only be included once per test executable
+
+// Aseba
+#include "../compiler/compiler.h"
+#include "../vm/vm.h"
+#include "../vm/natives.h"
+#include "../common/consts.h"
+
+// C++
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <valarray>
+#include <vector>
+
+using namespace Aseba;
+
+//! A message sent by the VM, kept for the tests to check
+struct SentMessage
+{
+	uint16 type;
+	std::vector<uint16> words;
+};
+
+//! Messages sent by the VM, in order
+static std::vector<SentMessage> sentMessages;
+
+static bool executionError(false);
+
+extern "C" void AsebaSendMessage(AsebaVMState *vm, uint16 type, const void *data, uint16 size)
+{
+	SentMessage message;
+	message.type = type;
+	message.words.assign(static_cast<const uint16*>(data), static_cast<const uint16*>(data) + size / 2);
+	sentMessages.push_back(message);
+	
+	switch (type)
+	{
+		case ASEBA_MESSAGE_DIVISION_BY_ZERO:
+		std::cerr << "Division by zero" << std::endl;
+		executionError = true;
+		break;
+		
+		case ASEBA_MESSAGE_ARRAY_ACCESS_OUT_OF_BOUNDS:
+		std::cerr << "Array access out of bounds" << std::endl;
+		executionError = true;
+		break;
+		
+		default:
+		std::cerr << "AsebaSendMessage of type " << type << ", size " << size << std::endl;
+		break;
+	}
+}
+
+#ifdef __BIG_ENDIAN__
+extern "C" void AsebaSendMessageWords(AsebaVMState *vm, uint16 type, const uint16* data, uint16 count)
+{
+	AsebaSendMessage(vm, type, data, count*2);
+}
+#endif
+
+extern "C" void AsebaSendVariables(AsebaVMState *vm, uint16 start, uint16 length)
+{
+	std::cerr << "AsebaSendVariables at pos " << start << ", length " << length << std::endl;
+}
+
+extern "C" void AsebaSendVariablesChunk(AsebaVMState *vm, uint16 sequence, uint16 start, uint16 length)
+{
+	std::cerr << "AsebaSendVariablesChunk " << sequence << " at pos " << start << ", length " << length << std::endl;
+}
+
+extern "C" void AsebaSendDescription(AsebaVMState *vm)
+{
+	std::cerr << "AsebaSendDescription" << std::endl;
+}
+
+extern "C" void AsebaSendDescriptionHash(AsebaVMState *vm)
+{
+	std::cerr << "AsebaSendDescriptionHash" << std::endl;
+}
+
+extern "C" void AsebaPutVmToSleep(AsebaVMState *vm)
+{
+	std::cerr << "AsebaPutVmToSleep" << std::endl;
+}
+
+static AsebaNativeFunctionPointer nativeFunctions[] =
+{
+	ASEBA_NATIVES_STD_FUNCTIONS,
+	ASEBA_NATIVES_DSP_FUNCTIONS,
+};
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] =
+{
+	ASEBA_NATIVES_STD_DESCRIPTIONS,
+	ASEBA_NATIVES_DSP_DESCRIPTIONS,
+	0
+};
+
+extern "C" const AsebaNativeFunctionDescription * const * AsebaGetNativeFunctionsDescriptions(AsebaVMState *vm)
+{
+	return nativeFunctionsDescriptions;
+}
+
+extern "C" void AsebaNativeFunction(AsebaVMState *vm, uint16 id)
+{
+	nativeFunctions[id](vm);
+}
+
+extern "C" void AsebaWriteBytecode(AsebaVMState *vm)
+{
+	std::cerr << "AsebaWriteBytecode" << std::endl;
+}
+
+extern "C" void AsebaResetIntoBootloader(AsebaVMState *vm)
+{
+	std::cerr << "AsebaResetIntoBootloader" << std::endl;
+}
+
+extern "C" void AsebaAssert(AsebaVMState *vm, AsebaAssertReason reason)
+{
+	std::cerr << "\nFatal error, internal VM exception: ";
+	switch (reason)
+	{
+		case ASEBA_ASSERT_UNKNOWN: std::cerr << "undefined"; break;
+		case ASEBA_ASSERT_UNKNOWN_UNARY_OPERATOR: std::cerr << "unknown unary operator"; break;
+		case ASEBA_ASSERT_UNKNOWN_BINARY_OPERATOR: std::cerr << "unknown binary operator"; break;
+		case ASEBA_ASSERT_UNKNOWN_BYTECODE: std::cerr << "unknown bytecode"; break;
+		case ASEBA_ASSERT_STACK_OVERFLOW: std::cerr << "stack overflow"; break;
+		case ASEBA_ASSERT_STACK_UNDERFLOW: std::cerr << "stack underflow"; break;
+		case ASEBA_ASSERT_OUT_OF_VARIABLES_BOUNDS: std::cerr << "out of variables bounds"; break;
+		case ASEBA_ASSERT_OUT_OF_BYTECODE_BOUNDS: std::cerr << "out of bytecode bounds"; break;
+		case ASEBA_ASSERT_STEP_OUT_OF_RUN: std::cerr << "step out of run"; break;
+		case ASEBA_ASSERT_BREAKPOINT_OUT_OF_BYTECODE_BOUNDS: std::cerr << "breakpoint out of bytecode bounds"; break;
+		case ASEBA_ASSERT_EMIT_BUFFER_TOO_LONG: std::cerr << "tried to emit a buffer too long"; break;
+		default: std::cerr << "unknown exception"; break;
+	}
+	std::cerr << ".\npc = " << vm->pc << ", sp = " << vm->sp;
+	std::cerr << "\nResetting VM" << std::endl;
+	executionError = true;
+	AsebaVMInit(vm);
+}
+
+struct AsebaNode
+{
+	AsebaVMState vm;
+	std::valarray<unsigned short> bytecode;
+	std::valarray<signed short> stack;
+	std::valarray<unsigned short> whenStates;
+	std::valarray<unsigned short> eventsIndex;
+	TargetDescription d;
+	
+	struct Variables
+	{
+		sint16 user[256];
+	} variables;
+
+	AsebaNode()
+	{
+		// create VM
+		vm.nodeId = 0;
+		bytecode.resize(512);
+		vm.bytecode = &bytecode[0];
+		vm.bytecodeSize = bytecode.size();
+		
+		stack.resize(64);
+		vm.stack = &stack[0];
+		vm.stackSize = stack.size();
+		
+		vm.variables = reinterpret_cast<sint16 *>(&variables);
+		vm.variablesSize = sizeof(variables) / sizeof(sint16);
+		
+		whenStates.resize(ASEBA_VM_WHEN_STATES_SIZE(vm.bytecodeSize));
+		vm.whenStates = &whenStates[0];
+		
+		eventsIndex.resize(128);
+		vm.eventsIndex = &eventsIndex[0];
+		vm.eventsIndexSize = eventsIndex.size();
+		vm.eventQueue = 0;
+		vm.breakpointsBitmap = 0;
+		#ifdef ASEBA_VM_PROFILER
+		vm.profiler = 0;
+		#endif // ASEBA_VM_PROFILER
+		
+		AsebaVMInit(&vm);
+		
+		// fill description accordingly
+		d.name = L"testvm";
+		d.protocolVersion = ASEBA_PROTOCOL_VERSION;
+		
+		d.bytecodeSize = vm.bytecodeSize;
+		d.variablesSize = vm.variablesSize;
+		d.stackSize = vm.stackSize;
+		
+		/*d.namedVariables.push_back(TargetDescription::NamedVariable("id", 1));
+		d.namedVariables.push_back(TargetDescription::NamedVariable("source", 1));
+		d.namedVariables.push_back(TargetDescription::NamedVariable("args", 32));*/
+		
+		const AsebaNativeFunctionDescription** nativeDescs(nativeFunctionsDescriptions);
+		while (*nativeDescs)
+		{
+			const AsebaNativeFunctionDescription* nativeDesc(*nativeDescs);
+			std::string name(nativeDesc->name);
+			std::string doc(nativeDesc->doc);
+			
+			TargetDescription::NativeFunction native(
+				std::wstring(name.begin(), name.end()),
+				std::wstring(doc.begin(), doc.end())
+			);
+			
+			const AsebaNativeFunctionArgumentDescription* params(nativeDesc->arguments);
+			while (params->size)
+			{
+				AsebaNativeFunctionArgumentDescription param(*params);
+				name = param.name;
+				int size = param.size;
+				native.parameters.push_back(
+					TargetDescription::NativeFunctionParameter(std::wstring(name.begin(), name.end()), size)
+				);
+				++params;
+			}
+			
+			d.nativeFunctions.push_back(native);
+			
+			++nativeDescs;
+		}
+	}
+	
+	const TargetDescription* getTargetDescription() const
+	{
+		return &d;
+	}
+	
+	//! Compile source and load its bytecode, return false and print the error on failure
+	bool compile(const std::wstring& source, const CommonDefinitions& definitions)
+	{
+		std::wistringstream is(source);
+		Compiler compiler;
+		compiler.setTargetDescription(getTargetDescription());
+		compiler.setCommonDefinitions(&definitions);
+		BytecodeVector bytecode;
+		unsigned varCount;
+		Error error;
+		if (!compiler.compile(is, bytecode, varCount, error))
+		{
+			std::wcerr << L"Compilation error: " << error.toWString() << std::endl;
+			return false;
+		}
+		return loadBytecode(bytecode);
+	}
+
+	bool loadBytecode(const BytecodeVector& bytecode)
+	{
+		size_t i = 0;
+		for (BytecodeVector::const_iterator it(bytecode.begin()); it != bytecode.end(); ++it)
+		{
+			if (i == vm.bytecodeSize)
+				return false;
+			const BytecodeElement& be(*it);
+			vm.bytecode[i++] = be.bytecode;
+		}
+		AsebaVMBuildEventsIndex(&vm);
+		return true;
+	}
+	
+	void run(int stepCount)
+	{
+		// run VM
+		AsebaVMSetupEvent(&vm, ASEBA_EVENT_INIT);
+		AsebaVMRun(&vm, stepCount);
+	}
+};
+
+#endif // ASEBA_TESTS_TEST_NODE_H
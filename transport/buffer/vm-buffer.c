@@ -108,6 +108,20 @@ void AsebaSendVariables(AsebaVMState *vm, uint16 start, uint16 length)
 	AsebaSendBuffer(vm, buffer, buffer_pos);
 }
 
+void AsebaSendVariablesChunk(AsebaVMState *vm, uint16 sequence, uint16 start, uint16 length)
+{
+	uint16 i;
+
+	buffer_pos = 0;
+	buffer_add_uint16(ASEBA_MESSAGE_VARIABLES_SNAPSHOT_CHUNK);
+	buffer_add_uint16(sequence);
+	buffer_add_uint16(start);
+	for (i = start; i < start + length; i++)
+		buffer_add_uint16(vm->variables[i]);
+
+	AsebaSendBuffer(vm, buffer, buffer_pos);
+}
+
 void AsebaSendDescription(AsebaVMState *vm)
 {
 	const AsebaVMDescription *vmDescription = AsebaGetVMDescription(vm);
@@ -200,6 +214,85 @@ void AsebaSendDescription(AsebaVMState *vm)
 	}
 }
 
+/* XModem CRC, as used to compute the hash of descriptions in AS001 */
+
+static uint16 crc_xmodem_update(uint16 crc, uint8 data)
+{
+	int i;
+	
+	crc = crc ^ ((uint16)data << 8);
+	for (i = 0; i < 8; i++)
+	{
+		if (crc & 0x8000)
+			crc = (crc << 1) ^ 0x1021;
+		else
+			crc <<= 1;
+	}
+	
+	return crc;
+}
+
+static uint16 crc_xmodem_update_uint16(uint16 crc, uint16 value)
+{
+	crc = crc_xmodem_update(crc, (uint8)(value & 0xff));
+	return crc_xmodem_update(crc, (uint8)(value >> 8));
+}
+
+static uint16 crc_xmodem_update_string(uint16 crc, const char* s)
+{
+	uint16 len = strlen(s);
+	uint16 i;
+	for (i = 0; i < len; i++)
+		crc = crc_xmodem_update(crc, (uint8)s[i]);
+	// strings are padded to an even length with their terminating zero
+	if (len & 0x1)
+		crc = crc_xmodem_update(crc, 0);
+	return crc;
+}
+
+void AsebaSendDescriptionHash(AsebaVMState *vm)
+{
+	const AsebaVMDescription *vmDescription = AsebaGetVMDescription(vm);
+	const AsebaVariableDescription* namedVariables = vmDescription->variables;
+	const AsebaNativeFunctionDescription* const * nativeFunctionsDescription = AsebaGetNativeFunctionsDescriptions(vm);
+	const AsebaLocalEventDescription* localEvents = AsebaGetLocalEventsDescriptions(vm);
+	
+	uint16 crc = 0;
+	uint16 i;
+	
+	// compute the CRC of the description the same way as TargetDescription::crc()
+	crc = crc_xmodem_update_uint16(crc, vm->bytecodeSize);
+	crc = crc_xmodem_update_uint16(crc, vm->variablesSize);
+	crc = crc_xmodem_update_uint16(crc, vm->stackSize);
+	for (i = 0; namedVariables[i].name; i++)
+	{
+		crc = crc_xmodem_update_uint16(crc, namedVariables[i].size);
+		crc = crc_xmodem_update_string(crc, namedVariables[i].name);
+	}
+	for (i = 0; localEvents[i].name; i++)
+		crc = crc_xmodem_update_string(crc, localEvents[i].name);
+	for (i = 0; nativeFunctionsDescription[i]; i++)
+	{
+		uint16 j;
+		crc = crc_xmodem_update_string(crc, nativeFunctionsDescription[i]->name);
+		for (j = 0; nativeFunctionsDescription[i]->arguments[j].size; j++)
+		{
+			crc = crc_xmodem_update_uint16(crc, (uint16)nativeFunctionsDescription[i]->arguments[j].size);
+			crc = crc_xmodem_update_string(crc, nativeFunctionsDescription[i]->arguments[j].name);
+		}
+	}
+	
+	buffer_pos = 0;
+	
+	buffer_add_uint16(ASEBA_MESSAGE_DESCRIPTION_HASH);
+	
+	buffer_add_string(vmDescription->name);
+	buffer_add_uint16(ASEBA_PROTOCOL_VERSION);
+	buffer_add_uint16(crc);
+	
+	AsebaSendBuffer(vm, buffer, buffer_pos);
+}
+
 void AsebaProcessIncomingEvents(AsebaVMState *vm)
 {
 	uint16 source;
@@ -214,8 +307,16 @@ void AsebaProcessIncomingEvents(AsebaVMState *vm)
 		uint16 payloadSize = (amount-2)/2;
 		if (type < 0x8000)
 		{
-			// user message, only process if we are not stepping inside an event
-			if (AsebaMaskIsClear(vm->flags, ASEBA_VM_STEP_BY_STEP_MASK) || AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK))
+			// user message, if the VM has a queue, queue it along with its arguments in host order
+			if (vm->eventQueue)
+			{
+				uint16 i;
+				for (i = 0; i < payloadSize; i++)
+					payload[i] = bswap16(payload[i]);
+				AsebaVMQueueEvent(vm, type, source, payload, payloadSize);
+			}
+			// otherwise, only process if we are not stepping inside an event
+			else if (AsebaMaskIsClear(vm->flags, ASEBA_VM_STEP_BY_STEP_MASK) || AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK))
 			{
 				// by convention. the source begin at variables, address 1
 				// then it's followed by the args
@@ -35,7 +35,9 @@ extern "C" {
 	This helper provides to the VM:
 	* AsebaSendMessage()
 	* AsebaSendVariables()
+	* AsebaSendVariablesChunk()
 	* AsebaSendDescription()
+	* AsebaSendDescriptionHash()
 	
 	This helper provides to the glue code:
 	* AsebaProcessIncomingEvents()
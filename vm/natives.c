@@ -35,6 +35,76 @@
 #include <p24Hxxxx.h>
 #endif 
 
+// vector units of hosts, used by the element-wise natives unless ASEBA_NATIVES_NO_SIMD is defined
+#if defined(ASEBA_NATIVES_NO_SIMD)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVAILABLE
+#define SIMD_WIDTH 16
+#define SIMD_ACC_WIDTH 8
+typedef __m256i AsebaSimdVector;
+typedef __m256i AsebaSimdAccumulator;
+#define SIMD_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define SIMD_STORE(p, v) _mm256_storeu_si256((__m256i *)(p), (v))
+#define SIMD_SET1(x) _mm256_set1_epi16(x)
+#define SIMD_ADD(a, b) _mm256_add_epi16((a), (b))
+#define SIMD_SUB(a, b) _mm256_sub_epi16((a), (b))
+#define SIMD_MUL(a, b) _mm256_mullo_epi16((a), (b))
+#define SIMD_MIN(a, b) _mm256_min_epi16((a), (b))
+#define SIMD_MAX(a, b) _mm256_max_epi16((a), (b))
+#define SIMD_SELECT_GT(a, b, x) _mm256_blendv_epi8((x), (b), _mm256_cmpgt_epi16((a), (b)))
+#define SIMD_LOW_BYTE(v) _mm256_and_si256((v), _mm256_set1_epi16(0xff))
+#define SIMD_HIGH_BYTE(v) _mm256_srai_epi16((v), 8)
+#define SIMD_ACC_ZERO() _mm256_setzero_si256()
+#define SIMD_ACC_MAC(acc, a, b) _mm256_add_epi32((acc), _mm256_madd_epi16((a), (b)))
+#define SIMD_ACC_ADD(acc, v) _mm256_add_epi32((acc), _mm256_madd_epi16((v), _mm256_set1_epi16(1)))
+#define SIMD_ACC_STORE(p, acc) _mm256_storeu_si256((__m256i *)(p), (acc))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_AVAILABLE
+#define SIMD_WIDTH 8
+#define SIMD_ACC_WIDTH 4
+typedef __m128i AsebaSimdVector;
+typedef __m128i AsebaSimdAccumulator;
+#define SIMD_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SIMD_STORE(p, v) _mm_storeu_si128((__m128i *)(p), (v))
+#define SIMD_SET1(x) _mm_set1_epi16(x)
+#define SIMD_ADD(a, b) _mm_add_epi16((a), (b))
+#define SIMD_SUB(a, b) _mm_sub_epi16((a), (b))
+#define SIMD_MUL(a, b) _mm_mullo_epi16((a), (b))
+#define SIMD_MIN(a, b) _mm_min_epi16((a), (b))
+#define SIMD_MAX(a, b) _mm_max_epi16((a), (b))
+#define SIMD_SELECT_GT(a, b, x) _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi16((a), (b)), (b)), _mm_andnot_si128(_mm_cmpgt_epi16((a), (b)), (x)))
+#define SIMD_LOW_BYTE(v) _mm_and_si128((v), _mm_set1_epi16(0xff))
+#define SIMD_HIGH_BYTE(v) _mm_srai_epi16((v), 8)
+#define SIMD_ACC_ZERO() _mm_setzero_si128()
+#define SIMD_ACC_MAC(acc, a, b) _mm_add_epi32((acc), _mm_madd_epi16((a), (b)))
+#define SIMD_ACC_ADD(acc, v) _mm_add_epi32((acc), _mm_madd_epi16((v), _mm_set1_epi16(1)))
+#define SIMD_ACC_STORE(p, acc) _mm_storeu_si128((__m128i *)(p), (acc))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_AVAILABLE
+#define SIMD_WIDTH 8
+#define SIMD_ACC_WIDTH 4
+typedef int16x8_t AsebaSimdVector;
+typedef int32x4_t AsebaSimdAccumulator;
+#define SIMD_LOAD(p) vld1q_s16(p)
+#define SIMD_STORE(p, v) vst1q_s16((p), (v))
+#define SIMD_SET1(x) vdupq_n_s16(x)
+#define SIMD_ADD(a, b) vaddq_s16((a), (b))
+#define SIMD_SUB(a, b) vsubq_s16((a), (b))
+#define SIMD_MUL(a, b) vmulq_s16((a), (b))
+#define SIMD_MIN(a, b) vminq_s16((a), (b))
+#define SIMD_MAX(a, b) vmaxq_s16((a), (b))
+#define SIMD_SELECT_GT(a, b, x) vbslq_s16(vcgtq_s16((a), (b)), (b), (x))
+#define SIMD_LOW_BYTE(v) vandq_s16((v), vdupq_n_s16(0xff))
+#define SIMD_HIGH_BYTE(v) vshrq_n_s16((v), 8)
+#define SIMD_ACC_ZERO() vdupq_n_s32(0)
+#define SIMD_ACC_MAC(acc, a, b) vmlal_s16(vmlal_s16((acc), vget_low_s16(a), vget_low_s16(b)), vget_high_s16(a), vget_high_s16(b))
+#define SIMD_ACC_ADD(acc, v) vpadalq_s16((acc), (v))
+#define SIMD_ACC_STORE(p, acc) vst1q_s32((p), (acc))
+#endif
+
 
 
 /**
@@ -128,10 +198,17 @@ sint16 aseba_atan2(sint16 y, sint16 x)
 			sint32 value = (((sint32)ay << 16)/(sint32)(ax));
 			sint16 fb1 = 0;
 			
+#if defined(__GNUC__) && !defined(__C30__)
+			// index of the highest bit set among the 32 lowest ones, as the loop below, but in one instruction;
+			// unsigned long has at least 32 bits, unlike unsigned int on 16-bit targets
+			if (value != 0)
+				fb1 = (sint16)(8 * sizeof(unsigned long) - 1 - __builtin_clzl((unsigned long)value & 0xffffffffUL));
+#else
 			sint16 fb1_counter;
 			for (fb1_counter = 0; fb1_counter < 32; fb1_counter++)
 				if ((value >> (sint32)fb1_counter) != 0)
 					fb1 = fb1_counter;
+#endif
 						
 			{
 				// we only keep 4 bits of precision below comma as atan(x) is like x near 0
@@ -164,8 +241,8 @@ sint16 aseba_atan2(sint16 y, sint16 x)
 	}
 }
 
-// 2 << 7 entries + 1, from 0 to 16384, being from 0 to PI
-static const sint16 aseba_sin_table[128+1] = {0, 403, 804, 1207, 1608, 2010, 2411, 2812, 3212, 3612, 4011, 4411, 4808, 5206, 5603, 5998, 6393, 6787, 7180, 7572, 7962, 8352, 8740, 9127, 9513, 9896, 10279, 10660, 11040, 11417, 11794, 12167, 12540, 12911, 13279, 13646, 14010, 14373, 14733, 15091, 15447, 15801, 16151, 16500, 16846, 17190, 17531, 17869, 18205, 18538, 18868, 19196, 19520, 19842, 20160, 20476, 20788, 21097, 21403, 21706, 22006, 22302, 22595, 22884, 23171, 23453, 23732, 24008, 24279, 24548, 24812, 25073, 25330, 25583, 25833, 26078, 26320, 26557, 26791, 27020, 27246, 27467, 27684, 27897, 28106, 28311, 28511, 28707, 28899, 29086, 29269, 29448, 29622, 29792, 29957, 30117, 30274, 30425, 30572, 30715, 30852, 30985, 31114, 31238, 31357, 31471, 31581, 31686, 31786, 31881, 31972, 32057, 32138, 32215, 32285, 32352, 32413, 32470, 32521, 32569, 32610, 32647, 32679, 32706, 32728, 32746, 32758, 32766, 32767, };
+// 2 << 7 entries + 1, from 0 to 16384, being from 0 to PI, and a copy of the last one, read with a zero weight at PI/2
+static const sint16 aseba_sin_table[128+2] = {0, 403, 804, 1207, 1608, 2010, 2411, 2812, 3212, 3612, 4011, 4411, 4808, 5206, 5603, 5998, 6393, 6787, 7180, 7572, 7962, 8352, 8740, 9127, 9513, 9896, 10279, 10660, 11040, 11417, 11794, 12167, 12540, 12911, 13279, 13646, 14010, 14373, 14733, 15091, 15447, 15801, 16151, 16500, 16846, 17190, 17531, 17869, 18205, 18538, 18868, 19196, 19520, 19842, 20160, 20476, 20788, 21097, 21403, 21706, 22006, 22302, 22595, 22884, 23171, 23453, 23732, 24008, 24279, 24548, 24812, 25073, 25330, 25583, 25833, 26078, 26320, 26557, 26791, 27020, 27246, 27467, 27684, 27897, 28106, 28311, 28511, 28707, 28899, 29086, 29269, 29448, 29622, 29792, 29957, 30117, 30274, 30425, 30572, 30715, 30852, 30985, 31114, 31238, 31357, 31471, 31581, 31686, 31786, 31881, 31972, 32057, 32138, 32215, 32285, 32352, 32413, 32470, 32521, 32569, 32610, 32647, 32679, 32706, 32728, 32746, 32758, 32766, 32767, 32767, };
 /* Generation code:
 int i;
 for (i = 0; i <= 128; i++)
@@ -230,6 +307,10 @@ sint16 aseba_sqrt(sint16 num)
 	sint16 res = 0;
 	sint16 one = 1 << 14;
 	
+	// the loop below would never end for negative values
+	if (num < 0)
+		return 0;
+	
 	while(one > op)
 		one >>= 2;
 		
@@ -249,39 +330,210 @@ sint16 aseba_sqrt(sint16 num)
 	return res;
 }
 
-// comb sort ( from Wikipedia )
-void aseba_comb_sort(sint16* input, uint16 size)
+// sorting networks for 2 to 8 values, as pairs of indices to compare and exchange
+static const uint8 aseba_sort_network_2[] = { 0,1 };
+static const uint8 aseba_sort_network_3[] = { 1,2, 0,2, 0,1 };
+static const uint8 aseba_sort_network_4[] = { 0,1, 2,3, 0,2, 1,3, 1,2 };
+static const uint8 aseba_sort_network_5[] = { 0,1, 3,4, 2,4, 2,3, 0,3, 0,2, 1,4, 1,3, 1,2 };
+static const uint8 aseba_sort_network_6[] = { 1,2, 4,5, 0,2, 3,5, 0,1, 3,4, 2,5, 0,3, 1,4, 2,4, 1,3, 2,3 };
+static const uint8 aseba_sort_network_7[] = { 1,2, 3,4, 5,6, 0,2, 3,5, 4,6, 0,1, 4,5, 2,6, 0,4, 1,5, 0,3, 2,5, 1,3, 2,4, 2,3 };
+static const uint8 aseba_sort_network_8[] = { 0,1, 2,3, 4,5, 6,7, 0,2, 1,3, 4,6, 5,7, 1,2, 5,6, 0,4, 3,7, 1,5, 2,6, 1,4, 3,6, 2,4, 3,5, 3,4 };
+static const uint8* const aseba_sort_networks[9] = { 0, 0, aseba_sort_network_2, aseba_sort_network_3, aseba_sort_network_4, aseba_sort_network_5, aseba_sort_network_6, aseba_sort_network_7, aseba_sort_network_8 };
+static const uint8 aseba_sort_networks_sizes[9] = { 0, 0, sizeof(aseba_sort_network_2), sizeof(aseba_sort_network_3), sizeof(aseba_sort_network_4), sizeof(aseba_sort_network_5), sizeof(aseba_sort_network_6), sizeof(aseba_sort_network_7), sizeof(aseba_sort_network_8) };
+#define ASEBA_SORT_NETWORK_MAX 8
+
+// sort up to ASEBA_SORT_NETWORK_MAX values with a sorting network, without branching on their order
+static void aseba_network_sort(sint16* input, uint16 size)
 {
-	uint16 gap = size;
-	uint16 swapped = 0;
-	uint16 i;
+	const uint8* network = aseba_sort_networks[size];
+	const uint8* end = network + aseba_sort_networks_sizes[size];
+	
+	for (; network != end; network += 2)
+	{
+		sint16 a = input[network[0]];
+		sint16 b = input[network[1]];
+		input[network[0]] = a < b ? a : b;
+		input[network[1]] = a < b ? b : a;
+	}
+}
 
-	while ((gap > 1) || swapped)
+// heap sort, for the partitions that quick sort fails to split evenly
+static void aseba_heap_sort(sint16* input, uint16 size)
+{
+	uint16 end = size;
+	uint16 start = size / 2;
+	
+	while (end > 1)
 	{
-		if (gap > 1)
+		uint16 root;
+		sint16 value;
+		
+		// build the heap first, then move its top to the end, one value at a time
+		if (start > 0)
+			start--;
+		else
 		{
-#ifdef __C30__
-			gap = __builtin_divud(__builtin_muluu(gap,4),5);
-#else
-			gap = (uint16)(((uint32)gap * 4) / 5);
-#endif
+			end--;
+			value = input[end];
+			input[end] = input[0];
+			input[0] = value;
 		}
+		
+		// sift down the value at start
+		root = start;
+		value = input[root];
+		while ((uint32)root * 2 + 1 < end)
+		{
+			uint16 child = root * 2 + 1;
+			if ((child + 1 < end) && (input[child + 1] > input[child]))
+				child++;
+			if (input[child] <= value)
+				break;
+			input[root] = input[child];
+			root = child;
+		}
+		input[root] = value;
+	}
+}
 
-		swapped = 0;
+// Hoare partition around the median of the first, middle and last values, return the size of the lower part,
+// which is at least 1 and at most size-1, all its values being lower or equal than the ones of the upper part
+static uint16 aseba_partition(sint16* input, uint16 size)
+{
+	uint16 i = 0;
+	uint16 j = size - 1;
+	uint16 middle = size / 2;
+	sint16 pivot;
+	
+	// order the three values so that first and last stop the scans, and so that sorted arrays are split evenly
+	if (input[middle] < input[0]) { pivot = input[middle]; input[middle] = input[0]; input[0] = pivot; }
+	if (input[j] < input[middle]) { pivot = input[j]; input[j] = input[middle]; input[middle] = pivot; }
+	if (input[middle] < input[0]) { pivot = input[middle]; input[middle] = input[0]; input[0] = pivot; }
+	pivot = input[middle];
+	
+	for (;;)
+	{
+		sint16 swap;
+		while (input[i] < pivot)
+			i++;
+		while (input[j] > pivot)
+			j--;
+		if (i >= j)
+			return j + 1;
+		swap = input[i];
+		input[i] = input[j];
+		input[j] = swap;
+		i++;
+		j--;
+	}
+}
+
+// return the depth of quick sort after which to switch to heap sort, twice the number of bits of size
+static uint16 aseba_sort_depth(uint16 size)
+{
+	uint16 depth = 0;
+	while (size > 1)
+	{
+		size >>= 1;
+		depth += 2;
+	}
+	return depth;
+}
 
-		for (i = 0; gap + i < size; i++)
+// introspective sort: quick sort recursing on the smaller part only, so that the C stack stays small,
+// heap sort when the partitions are unbalanced, and sorting networks for small parts
+static void aseba_intro_sort(sint16* input, uint16 size, uint16 depth)
+{
+	while (size > ASEBA_SORT_NETWORK_MAX)
+	{
+		uint16 lowerSize;
+		if (depth == 0)
 		{
-			if (input[i] - input[i + gap] > 0)
-			{
-				sint16 swap = input[i];
-				input[i] = input[i + gap];
-				input[i + gap] = swap;
-				swapped = 1;
-			}
+			aseba_heap_sort(input, size);
+			return;
+		}
+		depth--;
+		lowerSize = aseba_partition(input, size);
+		if (lowerSize < size - lowerSize)
+		{
+			aseba_intro_sort(input, lowerSize, depth);
+			input += lowerSize;
+			size -= lowerSize;
+		}
+		else
+		{
+			aseba_intro_sort(input + lowerSize, size - lowerSize, depth);
+			size = lowerSize;
 		}
 	}
+	aseba_network_sort(input, size);
 }
 
+// sort input in place
+void aseba_sort(sint16* input, uint16 size)
+{
+	aseba_intro_sort(input, size, aseba_sort_depth(size));
+}
+
+// quick select: reorder input so that input[k] is the value it would have if input was sorted,
+// with lower or equal values before it and greater or equal ones after, and return it
+sint16 aseba_select(sint16* input, uint16 size, uint16 k)
+{
+	uint16 depth = aseba_sort_depth(size);
+	uint16 start = 0;
+	
+	// only keep the part holding k
+	while (size > ASEBA_SORT_NETWORK_MAX)
+	{
+		uint16 lowerSize;
+		if (depth == 0)
+		{
+			aseba_heap_sort(input + start, size);
+			return input[k];
+		}
+		depth--;
+		lowerSize = aseba_partition(input + start, size);
+		if (k < start + lowerSize)
+			size = lowerSize;
+		else
+		{
+			start += lowerSize;
+			size -= lowerSize;
+		}
+	}
+	aseba_network_sort(input + start, size);
+	return input[k];
+}
+
+
+#ifdef SIMD_AVAILABLE
+
+// helpers for the vectorized natives, which must give exactly the same results as the scalar loops
+
+// return whether dest can be written a vector at a time while reading length values from src,
+// which is not the case if dest is after the start of src but overlaps it, as the scalar loop
+// would then read values it has just written
+static int simd_can_write(uint16 dest, uint16 src, uint16 length)
+{
+	return (dest <= src) || (dest >= (uint32)src + length);
+}
+
+// return the sum of the lanes of acc, which are 32 bits while sint32 is 64 bits on some hosts
+static sint64 simd_sum(AsebaSimdAccumulator acc)
+{
+	int lanes[SIMD_ACC_WIDTH];
+	sint64 sum = 0;
+	uint16 i;
+	SIMD_ACC_STORE(lanes, acc);
+	for (i = 0; i < SIMD_ACC_WIDTH; i++)
+		sum += lanes[i];
+	return sum;
+}
+
+// number of vectors math.dot can accumulate in 32-bit lanes without overflow, see AsebaNative_vecdot
+#define SIMD_DOT_BLOCK 64
+
+#endif
 
 // standard natives functions
 
@@ -384,8 +636,18 @@ void AsebaNative_vecadd(AsebaVMState *vm)
 	// variable size
 	uint16 length = AsebaNativePopArg(vm);
 	
-	uint16 i;
-	for (i = 0; i < length; i++)
+	uint16 i = 0;
+#ifdef SIMD_AVAILABLE
+	if (simd_can_write(dest, src1, length) && simd_can_write(dest, src2, length))
+	{
+		for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH)
+			SIMD_STORE(&vm->variables[dest + i], SIMD_ADD(SIMD_LOAD(&vm->variables[src1 + i]), SIMD_LOAD(&vm->variables[src2 + i])));
+		dest += i;
+		src1 += i;
+		src2 += i;
+	}
+#endif
+	for (; i < length; i++)
 	{
 		vm->variables[dest++] = vm->variables[src1++] + vm->variables[src2++];
 	}
@@ -414,8 +676,18 @@ void AsebaNative_vecsub(AsebaVMState *vm)
 	// variable size
 	uint16 length = AsebaNativePopArg(vm);
 	
-	uint16 i;
-	for (i = 0; i < length; i++)
+	uint16 i = 0;
+#ifdef SIMD_AVAILABLE
+	if (simd_can_write(dest, src1, length) && simd_can_write(dest, src2, length))
+	{
+		for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH)
+			SIMD_STORE(&vm->variables[dest + i], SIMD_SUB(SIMD_LOAD(&vm->variables[src1 + i]), SIMD_LOAD(&vm->variables[src2 + i])));
+		dest += i;
+		src1 += i;
+		src2 += i;
+	}
+#endif
+	for (; i < length; i++)
 	{
 		vm->variables[dest++] = vm->variables[src1++] - vm->variables[src2++];
 	}
@@ -444,8 +716,18 @@ void AsebaNative_vecmul(AsebaVMState *vm)
 	// variable size
 	uint16 length = AsebaNativePopArg(vm);
 	
-	uint16 i;
-	for (i = 0; i < length; i++)
+	uint16 i = 0;
+#ifdef SIMD_AVAILABLE
+	if (simd_can_write(dest, src1, length) && simd_can_write(dest, src2, length))
+	{
+		for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH)
+			SIMD_STORE(&vm->variables[dest + i], SIMD_MUL(SIMD_LOAD(&vm->variables[src1 + i]), SIMD_LOAD(&vm->variables[src2 + i])));
+		dest += i;
+		src1 += i;
+		src2 += i;
+	}
+#endif
+	for (; i < length; i++)
 	{
 		vm->variables[dest++] = vm->variables[src1++] * vm->variables[src2++];
 	}
@@ -516,8 +798,18 @@ void AsebaNative_vecmin(AsebaVMState *vm)
 	// variable size
 	uint16 length = AsebaNativePopArg(vm);
 	
-	uint16 i;
-	for (i = 0; i < length; i++)
+	uint16 i = 0;
+#ifdef SIMD_AVAILABLE
+	if (simd_can_write(dest, src1, length) && simd_can_write(dest, src2, length))
+	{
+		for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH)
+			SIMD_STORE(&vm->variables[dest + i], SIMD_MIN(SIMD_LOAD(&vm->variables[src1 + i]), SIMD_LOAD(&vm->variables[src2 + i])));
+		dest += i;
+		src1 += i;
+		src2 += i;
+	}
+#endif
+	for (; i < length; i++)
 	{
 		sint16 v1 = vm->variables[src1++];
 		sint16 v2 = vm->variables[src2++];
@@ -549,8 +841,18 @@ void AsebaNative_vecmax(AsebaVMState *vm)
 	// variable size
 	uint16 length = AsebaNativePopArg(vm);
 	
-	uint16 i;
-	for (i = 0; i < length; i++)
+	uint16 i = 0;
+#ifdef SIMD_AVAILABLE
+	if (simd_can_write(dest, src1, length) && simd_can_write(dest, src2, length))
+	{
+		for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH)
+			SIMD_STORE(&vm->variables[dest + i], SIMD_MAX(SIMD_LOAD(&vm->variables[src1 + i]), SIMD_LOAD(&vm->variables[src2 + i])));
+		dest += i;
+		src1 += i;
+		src2 += i;
+	}
+#endif
+	for (; i < length; i++)
 	{
 		sint16 v1 = vm->variables[src1++];
 		sint16 v2 = vm->variables[src2++];
@@ -582,8 +884,25 @@ void AsebaNative_vecclamp(AsebaVMState *vm)
 	// variable size
 	uint16 length = AsebaNativePopArg(vm);
 	
-	uint16 i;
-	for (i = 0; i < length; i++)
+	uint16 i = 0;
+#ifdef SIMD_AVAILABLE
+	if (simd_can_write(dest, src, length) && simd_can_write(dest, low, length) && simd_can_write(dest, high, length))
+	{
+		for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH)
+		{
+			const AsebaSimdVector v = SIMD_LOAD(&vm->variables[src + i]);
+			const AsebaSimdVector l = SIMD_LOAD(&vm->variables[low + i]);
+			const AsebaSimdVector h = SIMD_LOAD(&vm->variables[high + i]);
+			// v > h ? h : max(v, l), which unlike clamping in the other order keeps h when l > h
+			SIMD_STORE(&vm->variables[dest + i], SIMD_SELECT_GT(v, h, SIMD_MAX(v, l)));
+		}
+		dest += i;
+		src += i;
+		low += i;
+		high += i;
+	}
+#endif
+	for (; i < length; i++)
 	{
 		sint16 v = vm->variables[src++];
 		sint16 l = vm->variables[low++];
@@ -659,7 +978,32 @@ void AsebaNative_vecdot(AsebaVMState *vm)
 	res >>= shift;
 	vm->variables[dest] = (sint16) res;
 #else
-	for (i = 0; i < length; i++)
+	i = 0;
+#ifdef SIMD_AVAILABLE
+	{
+		// src2 is split into its signed high byte and unsigned low byte, so that the sums of products
+		// fit 32-bit lanes for SIMD_DOT_BLOCK vectors and the total is exact, as res might be 64 bits
+		sint64 sum = 0;
+		while (i + SIMD_WIDTH <= length)
+		{
+			AsebaSimdAccumulator low = SIMD_ACC_ZERO();
+			AsebaSimdAccumulator high = SIMD_ACC_ZERO();
+			uint16 j;
+			for (j = 0; (j < SIMD_DOT_BLOCK) && (i + SIMD_WIDTH <= length); j++, i += SIMD_WIDTH)
+			{
+				const AsebaSimdVector v1 = SIMD_LOAD(&vm->variables[src1 + i]);
+				const AsebaSimdVector v2 = SIMD_LOAD(&vm->variables[src2 + i]);
+				low = SIMD_ACC_MAC(low, v1, SIMD_LOW_BYTE(v2));
+				high = SIMD_ACC_MAC(high, v1, SIMD_HIGH_BYTE(v2));
+			}
+			sum += simd_sum(low) + simd_sum(high) * 256;
+		}
+		res = (sint32)sum;
+		src1 += i;
+		src2 += i;
+	}
+#endif
+	for (; i < length; i++)
 	{
 		res += (sint32)vm->variables[src1++] * (sint32)vm->variables[src2++];
 	}
@@ -703,7 +1047,38 @@ void AsebaNative_vecstat(AsebaVMState *vm)
 		vm->variables[min] = val;
 		vm->variables[max] = val;
 		
-		for (i = 1; i < length; i++)
+		i = 1;
+#ifdef SIMD_AVAILABLE
+		// min and max are read back by the scalar loop, so they must not be in the values still to read
+		if ((min != max) && simd_can_write(min, src - 1, length) && simd_can_write(max, src - 1, length))
+		{
+			AsebaSimdVector minVector = SIMD_SET1(val);
+			AsebaSimdVector maxVector = minVector;
+			AsebaSimdAccumulator sum = SIMD_ACC_ZERO();
+			sint16 lanes[SIMD_WIDTH];
+			uint16 j;
+			
+			for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH)
+			{
+				const AsebaSimdVector v = SIMD_LOAD(&vm->variables[src]);
+				minVector = SIMD_MIN(minVector, v);
+				maxVector = SIMD_MAX(maxVector, v);
+				sum = SIMD_ACC_ADD(sum, v);
+				src += SIMD_WIDTH;
+			}
+			acc += (sint32)simd_sum(sum);
+			
+			SIMD_STORE(lanes, minVector);
+			for (j = 0; j < SIMD_WIDTH; j++)
+				if (lanes[j] < vm->variables[min])
+					vm->variables[min] = lanes[j];
+			SIMD_STORE(lanes, maxVector);
+			for (j = 0; j < SIMD_WIDTH; j++)
+				if (lanes[j] > vm->variables[max])
+					vm->variables[max] = lanes[j];
+		}
+#endif
+		for (; i < length; i++)
 		{
 			val = vm->variables[src++];
 			if (val < vm->variables[min])
@@ -785,7 +1160,7 @@ void AsebaNative_vecsort(AsebaVMState *vm)
 	// variable size
 	uint16 length = AsebaNativePopArg(vm);
 	
-	aseba_comb_sort(&vm->variables[src], length);
+	aseba_sort(&vm->variables[src], length);
 }
 
 const AsebaNativeFunctionDescription AsebaNativeDescription_vecsort =
@@ -799,6 +1174,84 @@ const AsebaNativeFunctionDescription AsebaNativeDescription_vecsort =
 };
 
 
+void AsebaNative_vecselect(AsebaVMState *vm)
+{
+	// variable pos
+	uint16 dest = AsebaNativePopArg(vm);
+	uint16 src = AsebaNativePopArg(vm);
+	sint16 k = vm->variables[AsebaNativePopArg(vm)];
+	
+	// variable size
+	uint16 length = AsebaNativePopArg(vm);
+	
+	if ((k < 0) || ((uint16)k >= length))
+	{
+		uint16 buffer[3];
+		buffer[0] = vm->pc;
+		buffer[1] = length;
+		buffer[2] = k;
+		vm->flags = ASEBA_VM_STEP_BY_STEP_MASK;
+		AsebaSendMessageWords(vm, ASEBA_MESSAGE_ARRAY_ACCESS_OUT_OF_BOUNDS, buffer, 3);
+		return;
+	}
+	
+	vm->variables[dest] = aseba_select(&vm->variables[src], length, k);
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_vecselect =
+{
+	"math.select",
+	"write the k-th smallest element of array to dest, reordering array around it",
+	{
+		{ 1, "dest" },
+		{ -1, "array" },
+		{ 1, "k" },
+		{ 0, 0 }
+	}
+};
+
+
+void AsebaNative_vecmedian(AsebaVMState *vm)
+{
+	// variable pos
+	uint16 dest = AsebaNativePopArg(vm);
+	uint16 src = AsebaNativePopArg(vm);
+	
+	// variable size
+	uint16 length = AsebaNativePopArg(vm);
+	
+	sint16* array = &vm->variables[src];
+	sint32 median;
+	uint16 i;
+	
+	if (length == 0)
+		return;
+	
+	median = aseba_select(array, length, length / 2);
+	if ((length & 1) == 0)
+	{
+		// mean with the other middle element, the largest one before, rounded towards zero
+		sint16 lower = array[0];
+		for (i = 1; i < length / 2; i++)
+			if (array[i] > lower)
+				lower = array[i];
+		median = (median + (sint32)lower) / 2;
+	}
+	vm->variables[dest] = (sint16)median;
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_vecmedian =
+{
+	"math.median",
+	"write the median of array to dest, reordering array around it",
+	{
+		{ 1, "dest" },
+		{ -1, "array" },
+		{ 0, 0 }
+	}
+};
+
+
 void AsebaNative_mathmuldiv(AsebaVMState *vm)
 {
 	// variable pos
@@ -963,6 +1416,47 @@ const AsebaNativeFunctionDescription AsebaNativeDescription_mathrot2 =
 	}
 };
 
+void AsebaNative_mathrotate(AsebaVMState *vm)
+{
+	// variable pos
+	uint16 destXIndex = AsebaNativePopArg(vm);
+	uint16 destYIndex = AsebaNativePopArg(vm);
+	uint16 xIndex = AsebaNativePopArg(vm);
+	uint16 yIndex = AsebaNativePopArg(vm);
+	uint16 angleIndex = AsebaNativePopArg(vm);
+	
+	// variable size
+	uint16 length = AsebaNativePopArg(vm);
+	
+	// same angle for all points, as when changing the frame of a point cloud
+	sint16 a = vm->variables[angleIndex];
+	sint32 cos_a = aseba_cos(a);
+	sint32 sin_a = aseba_sin(a);
+	
+	uint16 i;
+	for (i = 0; i < length; i++)
+	{
+		sint32 x = vm->variables[xIndex++];
+		sint32 y = vm->variables[yIndex++];
+		vm->variables[destXIndex++] = (sint16)((cos_a * x - sin_a * y) >> (sint32)15);
+		vm->variables[destYIndex++] = (sint16)((cos_a * y + sin_a * x) >> (sint32)15);
+	}
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_mathrotate =
+{
+	"math.rotate",
+	"rotates the points (x,y) of angle a to (destx,desty), element by element",
+	{
+		{ -1, "destx" },
+		{ -1, "desty" },
+		{ -1, "x" },
+		{ -1, "y" },
+		{ 1, "a" },
+		{ 0, 0 }
+	}
+};
+
 void AsebaNative_mathsqrt(AsebaVMState *vm)
 {
 	// variable pos
@@ -1139,4 +1633,278 @@ const AsebaNativeFunctionDescription AsebaNativeDescription_rand =
 };
 
 
+// DSP natives functions
+
+// report an access to state beyond its size, when it is too small for the number of channels
+static void aseba_dsp_state_too_small(AsebaVMState *vm, uint16 stateLength, uint16 index)
+{
+	uint16 buffer[3];
+	buffer[0] = vm->pc;
+	buffer[1] = stateLength;
+	buffer[2] = index;
+	vm->flags = ASEBA_VM_STEP_BY_STEP_MASK;
+	AsebaSendMessageWords(vm, ASEBA_MESSAGE_ARRAY_ACCESS_OUT_OF_BOUNDS, buffer, 3);
+}
+
+static sint16 aseba_dsp_saturate(sint64 value)
+{
+	if (value > 32767)
+		return 32767;
+	if (value < -32768)
+		return -32768;
+	return (sint16)value;
+}
+
+// shift value right by shift, clamped to the bits of the accumulator
+static sint64 aseba_dsp_shift(sint64 value, sint16 shift)
+{
+	if (shift <= 0)
+		return value;
+	if (shift > 63)
+		shift = 63;
+	return value >> shift;
+}
+
+// sum of products of length elements of x and y, without wrapping around on 32 bits; on dsPIC, x must be in X data space
+static sint64 aseba_dsp_mac(const sint16 *x, const sint16 *y, uint16 length)
+{
+	sint64 res = 0;
+#ifndef DSP_AVAILABLE
+	uint16 i;
+#endif
+	
+	if (length == 0)
+		return 0;
+	
+#ifdef DSP_AVAILABLE
+	length--;
+	
+	CORCONbits.US = 0; // Signed mode
+	CORCON |= 0b11110001; // 40 bits mode, saturation enable, integer mode.
+	// Do NOT save the accumulator values, so do NOT USE THIS FUNCTION IN INTERRUPT !
+	asm __volatile__ (
+	"push %[ptr1]		\r\n"
+	"push %[ptr2]		\r\n"
+	"clr A\r\n"									//	A = 0
+	"mov [%[ptr1]++], w4 \r\n"					// Preload ptr
+	"do %[loop_cnt], 1f	\r\n"					//	Iterate loop_cnt time the two following instructions
+	"mov [%[ptr2]++], w5 \r\n"					// 	Load w5
+	"1: mac w4*w5, A, [%[ptr1]]+=2, w4 \r\n"	//	A += w4 * w5, prefetch ptr1 into w4
+	"pop %[ptr2]		\r\n"
+	"pop %[ptr1]		\r\n"
+	: /* No output */
+	: [loop_cnt] "r" (length), [ptr1] "x" (x), [ptr2] "r" (y)
+	: "cc", "w4", "w5" );
+	
+	// the accumulator saturates on 40 bits, keep its upper byte for the sum not to wrap around on 32 bits
+	res = ((sint64)(sint8)ACCAU << 32) | ((uint32)(uint16)ACCAH << 16) | (uint16)ACCAL;
+#elif defined(__C30__)
+	for (i = 0; i < length; i++)
+		res += __builtin_mulss(*x++, *y++);
+#else
+	for (i = 0; i < length; i++)
+		res += (sint32)(*x++) * (sint32)(*y++);
+#endif
+	return res;
+}
+
+// move the history of a channel one step back and put value as its newest element
+static void aseba_dsp_push(sint16 *history, uint16 length, sint16 value)
+{
+	uint16 i;
+	for (i = length - 1; i > 0; i--)
+		history[i] = history[i - 1];
+	history[0] = value;
+}
+
+void AsebaNative_filterfir(AsebaVMState *vm)
+{
+	// variable pos
+	uint16 dest = AsebaNativePopArg(vm);
+	uint16 src = AsebaNativePopArg(vm);
+	uint16 state = AsebaNativePopArg(vm);
+	uint16 coefs = AsebaNativePopArg(vm);
+	sint16 shift = vm->variables[AsebaNativePopArg(vm)];
+	
+	// variable size
+	uint16 length = AsebaNativePopArg(vm);
+	uint16 stateLength = AsebaNativePopArg(vm);
+	uint16 order = AsebaNativePopArg(vm);
+	
+	uint16 i;
+	
+	// each channel has its last order inputs in state
+	if ((uint32)length * order > stateLength)
+	{
+		aseba_dsp_state_too_small(vm, stateLength, length * order - 1);
+		return;
+	}
+	
+	for (i = 0; i < length; i++)
+	{
+		sint16 *history = &vm->variables[state + i * order];
+		aseba_dsp_push(history, order, vm->variables[src + i]);
+		vm->variables[dest + i] = aseba_dsp_saturate(aseba_dsp_shift(aseba_dsp_mac(&vm->variables[coefs], history, order), shift));
+	}
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_filterfir =
+{
+	"filter.fir",
+	"filters each element of src over time with coefs, first applied to the newest input, and a right shift, writing to dest; state keeps as many inputs as coefs per element",
+	{
+		{ -1, "dest" },
+		{ -1, "src" },
+		{ -2, "state" },
+		{ -3, "coefs" },
+		{ 1, "shift" },
+		{ 0, 0 }
+	}
+};
+
+
+void AsebaNative_filteriirbiquad(AsebaVMState *vm)
+{
+	// variable pos
+	uint16 dest = AsebaNativePopArg(vm);
+	uint16 src = AsebaNativePopArg(vm);
+	uint16 state = AsebaNativePopArg(vm);
+	uint16 coefs = AsebaNativePopArg(vm);
+	sint16 shift = vm->variables[AsebaNativePopArg(vm)];
+	
+	// variable size
+	uint16 length = AsebaNativePopArg(vm);
+	uint16 stateLength = AsebaNativePopArg(vm);
+	
+	uint16 i;
+	
+	// each channel has its last two inputs and its last two outputs in state
+	if ((uint32)length * 4 > stateLength)
+	{
+		aseba_dsp_state_too_small(vm, stateLength, length * 4 - 1);
+		return;
+	}
+	
+	for (i = 0; i < length; i++)
+	{
+		sint16 *history = &vm->variables[state + i * 4];
+		sint16 taps[5];
+		sint16 output;
+		
+		// b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+		taps[0] = vm->variables[src + i];
+		taps[1] = history[0];
+		taps[2] = history[1];
+		taps[3] = history[2];
+		taps[4] = history[3];
+		output = aseba_dsp_saturate(aseba_dsp_shift(aseba_dsp_mac(&vm->variables[coefs], taps, 5), shift));
+		
+		history[1] = history[0];
+		history[0] = taps[0];
+		history[3] = history[2];
+		history[2] = output;
+		vm->variables[dest + i] = output;
+	}
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_filteriirbiquad =
+{
+	"filter.iir_biquad",
+	"filters each element of src over time with coefs b0, b1, b2, a1, a2 (feedback added) and a right shift, writing to dest; state keeps the last two inputs and outputs of each element",
+	{
+		{ -1, "dest" },
+		{ -1, "src" },
+		{ -2, "state" },
+		{ 5, "coefs" },
+		{ 1, "shift" },
+		{ 0, 0 }
+	}
+};
+
+
+void AsebaNative_filterema(AsebaVMState *vm)
+{
+	// variable pos
+	uint16 dest = AsebaNativePopArg(vm);
+	uint16 src = AsebaNativePopArg(vm);
+	sint16 alpha = vm->variables[AsebaNativePopArg(vm)];
+	
+	// variable size
+	uint16 length = AsebaNativePopArg(vm);
+	
+	uint16 i;
+	
+	if (alpha < 0)
+		alpha = 0;
+	
+	// dest moves towards src by alpha / 32768 of their difference, rounded
+	for (i = 0; i < length; i++)
+	{
+		sint32 difference = (sint32)vm->variables[src + i] - (sint32)vm->variables[dest + i];
+		vm->variables[dest + i] += (sint16)((difference * alpha + 16384) >> 15);
+	}
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_filterema =
+{
+	"filter.ema",
+	"updates dest, the exponential moving average of src over time, with weight alpha / 32768 for src",
+	{
+		{ -1, "dest" },
+		{ -1, "src" },
+		{ 1, "alpha" },
+		{ 0, 0 }
+	}
+};
+
+
+void AsebaNative_filterwindowmean(AsebaVMState *vm)
+{
+	// variable pos
+	uint16 dest = AsebaNativePopArg(vm);
+	uint16 src = AsebaNativePopArg(vm);
+	uint16 state = AsebaNativePopArg(vm);
+	
+	// variable size
+	uint16 length = AsebaNativePopArg(vm);
+	uint16 stateLength = AsebaNativePopArg(vm);
+	
+	uint16 window;
+	uint16 i, j;
+	
+	if (length == 0)
+		return;
+	
+	// each channel has its last window inputs in state
+	window = stateLength / length;
+	if (window == 0)
+	{
+		aseba_dsp_state_too_small(vm, stateLength, length - 1);
+		return;
+	}
+	
+	for (i = 0; i < length; i++)
+	{
+		sint16 *history = &vm->variables[state + i * window];
+		sint32 sum = 0;
+		aseba_dsp_push(history, window, vm->variables[src + i]);
+		for (j = 0; j < window; j++)
+			sum += history[j];
+		vm->variables[dest + i] = (sint16)(sum / (sint32)window);
+	}
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_filterwindowmean =
+{
+	"filter.window_mean",
+	"writes to dest the mean of the last inputs of each element of src, as many as state holds per element",
+	{
+		{ -1, "dest" },
+		{ -1, "src" },
+		{ -2, "state" },
+		{ 0, 0 }
+	}
+};
+
+
 /*@}*/
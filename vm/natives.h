@@ -84,9 +84,11 @@ typedef struct
 
 // support functions
 
-/*! Return an argument on the stack, including the value of template parameters */
+/*! Return the next argument, including the value of template parameters, from the stack or from bytecode if the compiler put it there */
 static inline sint16 AsebaNativePopArg(AsebaVMState *vm)
 {
+	if (vm->nativeArgs)
+		return (sint16)*vm->nativeArgs++;
 	return vm->stack[vm->sp--];
 }
 
@@ -162,6 +164,16 @@ void AsebaNative_vecsort(AsebaVMState *vm);
 /*! Description of AsebaNative_vecsort */
 extern const AsebaNativeFunctionDescription AsebaNativeDescription_vecsort;
 
+/*! Function to get the k-th smallest element of a vector */
+void AsebaNative_vecselect(AsebaVMState *vm);
+/*! Description of AsebaNative_vecselect */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_vecselect;
+
+/*! Function to get the median of a vector */
+void AsebaNative_vecmedian(AsebaVMState *vm);
+/*! Description of AsebaNative_vecmedian */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_vecmedian;
+
 /*! Function to perform dest = (a*b)/c in 32 bits */
 void AsebaNative_mathmuldiv(AsebaVMState *vm);
 /*! Description of AsebaNative_mathmuldiv */
@@ -187,6 +199,11 @@ void AsebaNative_mathrot2(AsebaVMState *vm);
 /*! Description of AsebaNative_mathrot2 */
 extern const AsebaNativeFunctionDescription AsebaNativeDescription_mathrot2;
 
+/*! Function to perform the rotation of many points by the same angle */
+void AsebaNative_mathrotate(AsebaVMState *vm);
+/*! Description of AsebaNative_mathrotate */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_mathrotate;
+
 /*! Function to perform sqrt */
 void AsebaNative_mathsqrt(AsebaVMState *vm);
 /*! Description of AsebaNative_mathsqrt */
@@ -206,8 +223,30 @@ void AsebaNative_rand(AsebaVMState *vm);
 /*! Description of AsebaNative_rand */
 extern const AsebaNativeFunctionDescription AsebaNativeDescription_rand;
 
+// DSP natives functions, optional, targets include them with ASEBA_NATIVES_DSP_FUNCTIONS
+
+/*! Function to filter each element of a vector over time with a finite impulse response */
+void AsebaNative_filterfir(AsebaVMState *vm);
+/*! Description of AsebaNative_filterfir */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_filterfir;
+
+/*! Function to filter each element of a vector over time with a second-order infinite impulse response */
+void AsebaNative_filteriirbiquad(AsebaVMState *vm);
+/*! Description of AsebaNative_filteriirbiquad */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_filteriirbiquad;
+
+/*! Function to update the exponential moving average of each element of a vector */
+void AsebaNative_filterema(AsebaVMState *vm);
+/*! Description of AsebaNative_filterema */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_filterema;
+
+/*! Function to compute the mean of each element of a vector over a window of time */
+void AsebaNative_filterwindowmean(AsebaVMState *vm);
+/*! Description of AsebaNative_filterwindowmean */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_filterwindowmean;
+
 /*! Embedded targets must know the size of ASEBA_NATIVES_STD_FUNCTIONS without having to compute them by hand, please update this when adding a new function */
-#define ASEBA_NATIVES_STD_COUNT 21
+#define ASEBA_NATIVES_STD_COUNT 24
 
 /*! snippet to include standard native functions */
 #define ASEBA_NATIVES_STD_FUNCTIONS \
@@ -231,7 +270,10 @@ extern const AsebaNativeFunctionDescription AsebaNativeDescription_rand;
 	AsebaNative_mathcos, \
 	AsebaNative_mathrot2, \
 	AsebaNative_mathsqrt, \
-	AsebaNative_rand
+	AsebaNative_rand, \
+	AsebaNative_vecselect, \
+	AsebaNative_vecmedian, \
+	AsebaNative_mathrotate
 
 /*! snippet to include descriptions of standard native functions */
 #define ASEBA_NATIVES_STD_DESCRIPTIONS \
@@ -255,7 +297,27 @@ extern const AsebaNativeFunctionDescription AsebaNativeDescription_rand;
 	&AsebaNativeDescription_mathcos, \
 	&AsebaNativeDescription_mathrot2, \
 	&AsebaNativeDescription_mathsqrt, \
-	&AsebaNativeDescription_rand
+	&AsebaNativeDescription_rand, \
+	&AsebaNativeDescription_vecselect, \
+	&AsebaNativeDescription_vecmedian, \
+	&AsebaNativeDescription_mathrotate
+
+/*! Size of ASEBA_NATIVES_DSP_FUNCTIONS, please update this when adding a new function */
+#define ASEBA_NATIVES_DSP_COUNT 4
+
+/*! snippet to include DSP native functions, after the standard ones */
+#define ASEBA_NATIVES_DSP_FUNCTIONS \
+	AsebaNative_filterfir, \
+	AsebaNative_filteriirbiquad, \
+	AsebaNative_filterema, \
+	AsebaNative_filterwindowmean
+
+/*! snippet to include descriptions of DSP native functions, after the standard ones */
+#define ASEBA_NATIVES_DSP_DESCRIPTIONS \
+	&AsebaNativeDescription_filterfir, \
+	&AsebaNativeDescription_filteriirbiquad, \
+	&AsebaNativeDescription_filterema, \
+	&AsebaNativeDescription_filterwindowmean
 
 /*@}*/
 
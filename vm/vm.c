@@ -40,22 +40,165 @@
 #define BIT_CLR(v, b) ((v) &= (~(1 << (b))))
 
 void AsebaVMSendExecutionStateChanged(AsebaVMState *vm);
+void AsebaVMClearBreakpoints(AsebaVMState *vm);
+
+//! Marker of queued events without arguments
+#define ASEBA_VM_EVENT_QUEUE_NO_ARGS 0xFFFF
+
+//! Forget the last results of conditions, if they are not stored in bytecode
+static void AsebaVMClearWhenStates(AsebaVMState *vm)
+{
+	if (vm->whenStates)
+		memset(vm->whenStates, 0, ASEBA_VM_WHEN_STATES_SIZE(vm->bytecodeSize)*sizeof(uint16));
+}
+
+#ifdef ASEBA_VM_PROFILER
+
+//! Forget all counters of the profiler
+static void AsebaVMResetProfiler(AsebaVMState *vm)
+{
+	if (vm->profiler)
+	{
+		vm->profiler->entriesCount = 0;
+		vm->profiler->current = ASEBA_VM_PROFILER_NO_ENTRY;
+		vm->profiler->callsDepth = 0;
+	}
+}
+
+//! Return the entry of the profiler for code starting at address, adding it if needed, or ASEBA_VM_PROFILER_NO_ENTRY if there is no room left
+static uint16 AsebaVMGetProfilerEntry(AsebaVMProfiler *profiler, uint16 address)
+{
+	AsebaVMProfilerEntry *entry;
+	uint16 i;
+	
+	for (i = 0; i < profiler->entriesCount; i++)
+		if (profiler->entries[i].address == address)
+			return i;
+	
+	if (profiler->entriesCount == profiler->entriesSize)
+		return ASEBA_VM_PROFILER_NO_ENTRY;
+	
+	entry = &profiler->entries[profiler->entriesCount];
+	entry->address = address;
+	entry->instructionsCount = 0;
+	entry->nativeCallsCount = 0;
+	entry->nativeTime = 0;
+	return profiler->entriesCount++;
+}
+
+//! Send the counters of the profiler, one message per entry or an empty one if there is none
+static void AsebaVMSendProfile(AsebaVMState *vm)
+{
+	AsebaVMProfiler *profiler = vm->profiler;
+	uint16 buffer[9];
+	uint16 i;
+	
+	buffer[0] = profiler ? profiler->entriesCount : 0;
+	if (buffer[0] == 0)
+	{
+		memset(&buffer[1], 0, 8*sizeof(uint16));
+		AsebaSendMessageWords(vm, ASEBA_MESSAGE_PROFILE, buffer, 9);
+		return;
+	}
+	
+	for (i = 0; i < profiler->entriesCount; i++)
+	{
+		const AsebaVMProfilerEntry *entry = &profiler->entries[i];
+		// 32 bits counters are sent as pairs of words, low word first
+		buffer[1] = i;
+		buffer[2] = entry->address;
+		buffer[3] = (uint16)(entry->instructionsCount & 0xffff);
+		buffer[4] = (uint16)((entry->instructionsCount >> 16) & 0xffff);
+		buffer[5] = (uint16)(entry->nativeCallsCount & 0xffff);
+		buffer[6] = (uint16)((entry->nativeCallsCount >> 16) & 0xffff);
+		buffer[7] = (uint16)(entry->nativeTime & 0xffff);
+		buffer[8] = (uint16)((entry->nativeTime >> 16) & 0xffff);
+		AsebaSendMessageWords(vm, ASEBA_MESSAGE_PROFILE, buffer, 9);
+	}
+}
+
+#endif /* ASEBA_VM_PROFILER */
 
 void AsebaVMInit(AsebaVMState *vm)
 {
 	vm->pc = 0;
 	vm->flags = 0;
-	vm->breakpointsCount = 0;
+	vm->nativeArgs = 0;
+	AsebaVMClearBreakpoints(vm);
 	
 	// fill with no event
 	vm->bytecode[0] = 0;
 	memset(vm->variables, 0, vm->variablesSize*sizeof(sint16));
+	AsebaVMClearWhenStates(vm);
+	AsebaVMBuildEventsIndex(vm);
+	
+	if (vm->eventQueue)
+	{
+		vm->eventQueue->count = 0;
+		vm->eventQueue->queuedCount = 0;
+		vm->eventQueue->coalescedCount = 0;
+		vm->eventQueue->droppedCount = 0;
+	}
+	
+	#ifdef ASEBA_VM_PROFILER
+	AsebaVMResetProfiler(vm);
+	#endif
+}
+
+void AsebaVMBuildEventsIndex(AsebaVMState *vm)
+{
+	uint16 eventVectorSize = vm->bytecode[0];
+	uint16 i, j;
+	
+	if (vm->eventsIndexSize == 0)
+		return;
+	
+	// if the event vector does not fit, mark the index as unusable
+	if (eventVectorSize > vm->eventsIndexSize)
+	{
+		vm->eventsIndex[0] = 0;
+		return;
+	}
+	
+	// insertion sort of the pairs of event and address, event vectors are small and nearly sorted
+	vm->eventsIndex[0] = 1;
+	for (i = 1; i + 1 < eventVectorSize; i += 2)
+	{
+		uint16 event = vm->bytecode[i];
+		uint16 address = vm->bytecode[i + 1];
+		for (j = i; (j > 1) && (vm->eventsIndex[j - 2] > event); j -= 2)
+		{
+			vm->eventsIndex[j] = vm->eventsIndex[j - 2];
+			vm->eventsIndex[j + 1] = vm->eventsIndex[j - 1];
+		}
+		vm->eventsIndex[j] = event;
+		vm->eventsIndex[j + 1] = address;
+		vm->eventsIndex[0] += 2;
+	}
 }
 
 uint16 AsebaVMGetEventAddress(AsebaVMState *vm, uint16 event)
 {
 	uint16 eventVectorSize = vm->bytecode[0];
 	uint16 i;
+	
+	// binary search for the first pair of event in the index, if the event vector fitted in it
+	if (vm->eventsIndexSize && vm->eventsIndex[0])
+	{
+		uint16 low = 0;
+		uint16 high = vm->eventsIndex[0] / 2;
+		while (low < high)
+		{
+			uint16 middle = (low + high) / 2;
+			if (vm->eventsIndex[1 + 2 * middle] < event)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		if ((low < vm->eventsIndex[0] / 2) && (vm->eventsIndex[1 + 2 * low] == event))
+			return vm->eventsIndex[2 + 2 * low];
+		return 0;
+	}
 
 	// look into event vectors and if event match execute corresponding bytecode
 	for (i = 1; i < eventVectorSize; i += 2)
@@ -80,6 +223,14 @@ uint16 AsebaVMSetupEvent(AsebaVMState *vm, uint16 event)
 		vm->sp = -1;
 		AsebaMaskSet(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK);
 		
+		#ifdef ASEBA_VM_PROFILER
+		if (vm->profiler)
+		{
+			vm->profiler->current = AsebaVMGetProfilerEntry(vm->profiler, address);
+			vm->profiler->callsDepth = 0;
+		}
+		#endif
+		
 		// if we are in step by step, notify
 		if (AsebaMaskIsSet(vm->flags, ASEBA_VM_STEP_BY_STEP_MASK))
 			AsebaVMSendExecutionStateChanged(vm);
@@ -87,6 +238,117 @@ uint16 AsebaVMSetupEvent(AsebaVMState *vm, uint16 event)
 	return address;
 }
 
+//! Remove the entry at index from queue
+static void AsebaVMRemoveQueuedEvent(AsebaVMEventQueue *queue, uint16 index)
+{
+	uint16 entrySize = ASEBA_VM_EVENT_QUEUE_ENTRY_SIZE(queue->argsSize);
+	memmove(&queue->entries[index * entrySize], &queue->entries[(index + 1) * entrySize], (queue->count - index - 1) * entrySize * sizeof(uint16));
+	queue->count--;
+}
+
+//! If no handler is running, set up the next queued event
+static void AsebaVMDispatchQueuedEvent(AsebaVMState *vm)
+{
+	AsebaVMEventQueue *queue = vm->eventQueue;
+	uint16 entrySize, next, i;
+	const uint16 *entry;
+	
+	if (!queue)
+		return;
+	
+	entrySize = ASEBA_VM_EVENT_QUEUE_ENTRY_SIZE(queue->argsSize);
+	while (queue->count && AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK))
+	{
+		// the oldest event, or the oldest with the smallest identifier
+		next = 0;
+		if (queue->policy == ASEBA_VM_EVENT_QUEUE_PRIORITY)
+			for (i = 1; i < queue->count; i++)
+				if (queue->entries[i * entrySize] < queue->entries[next * entrySize])
+					next = i;
+		entry = &queue->entries[next * entrySize];
+		
+		// write source and arguments
+		if (entry[2] != ASEBA_VM_EVENT_QUEUE_NO_ARGS)
+		{
+			vm->variables[queue->sourceAddress] = (sint16)entry[1];
+			for (i = 0; i < entry[2]; i++)
+				vm->variables[queue->sourceAddress + 1 + i] = (sint16)entry[3 + i];
+		}
+		
+		AsebaVMSetupEvent(vm, entry[0]);
+		AsebaVMRemoveQueuedEvent(queue, next);
+	}
+}
+
+uint16 AsebaVMQueueEvent(AsebaVMState *vm, uint16 event, uint16 source, const uint16 *args, uint16 argsCount)
+{
+	AsebaVMEventQueue *queue = vm->eventQueue;
+	uint16 entrySize, i;
+	uint16 *entry = 0;
+	
+	if (!queue)
+		return AsebaVMSetupEvent(vm, event) != 0;
+	
+	// events that are not handled would only take room
+	if (!AsebaVMGetEventAddress(vm, event))
+		return 0;
+	
+	entrySize = ASEBA_VM_EVENT_QUEUE_ENTRY_SIZE(queue->argsSize);
+	
+	// replace the queued event with the same identifier
+	if (queue->policy == ASEBA_VM_EVENT_QUEUE_LATEST)
+	{
+		for (i = 0; i < queue->count; i++)
+		{
+			if (queue->entries[i * entrySize] == event)
+			{
+				entry = &queue->entries[i * entrySize];
+				queue->coalescedCount++;
+				break;
+			}
+		}
+	}
+	
+	if (!entry)
+	{
+		if ((queue->count == queue->depth) && (queue->policy == ASEBA_VM_EVENT_QUEUE_PRIORITY) && queue->count)
+		{
+			// drop the queued event with the largest identifier if it is larger than the new one
+			uint16 last = 0;
+			for (i = 1; i < queue->count; i++)
+				if (queue->entries[i * entrySize] >= queue->entries[last * entrySize])
+					last = i;
+			if (queue->entries[last * entrySize] > event)
+			{
+				AsebaVMRemoveQueuedEvent(queue, last);
+				queue->droppedCount++;
+			}
+		}
+		if (queue->count == queue->depth)
+		{
+			queue->droppedCount++;
+			return 0;
+		}
+		entry = &queue->entries[queue->count * entrySize];
+		queue->count++;
+		queue->queuedCount++;
+	}
+	
+	entry[0] = event;
+	entry[1] = source;
+	if (args)
+	{
+		entry[2] = argsCount < queue->argsSize ? argsCount : queue->argsSize;
+		for (i = 0; i < entry[2]; i++)
+			entry[3 + i] = args[i];
+	}
+	else
+		entry[2] = ASEBA_VM_EVENT_QUEUE_NO_ARGS;
+	
+	AsebaVMDispatchQueuedEvent(vm);
+	return 1;
+}
+
 static sint16 AsebaVMDoBinaryOperation(AsebaVMState *vm, sint16 valueOne, sint16 valueTwo, uint16 op)
 {
 	switch (op)
@@ -161,12 +423,19 @@ void AsebaVMStep(AsebaVMState *vm)
 		AsebaAssert(vm, ASEBA_ASSERT_STEP_OUT_OF_RUN);
 	#endif
 	
+	#ifdef ASEBA_VM_PROFILER
+	if (vm->profiler && (vm->profiler->current != ASEBA_VM_PROFILER_NO_ENTRY))
+		vm->profiler->entries[vm->profiler->current].instructionsCount++;
+	#endif
+	
 	switch (bytecode >> 12)
 	{
 		// Bytecode: Stop
 		case ASEBA_BYTECODE_STOP:
 		{
 			AsebaMaskClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK);
+			// run the next queued event, if any
+			AsebaVMDispatchQueuedEvent(vm);
 		}
 		break;
 		
@@ -419,7 +688,30 @@ void AsebaVMStep(AsebaVMState *vm)
 			vm->sp -= 2;
 			
 			// is the condition really true ?
-			if (conditionResult && !(GET_BIT(bytecode, ASEBA_IF_IS_WHEN_BIT) && GET_BIT(bytecode, ASEBA_IF_WAS_TRUE_BIT)))
+			if (GET_BIT(bytecode, ASEBA_IF_IS_WHEN_BIT))
+			{
+				// when: only true if the condition was false the last time
+				uint16 wasTrue;
+				if (vm->whenStates)
+				{
+					wasTrue = GET_BIT(vm->whenStates[vm->pc >> 4], vm->pc & 0xf);
+					if (conditionResult)
+						BIT_SET(vm->whenStates[vm->pc >> 4], vm->pc & 0xf);
+					else
+						BIT_CLR(vm->whenStates[vm->pc >> 4], vm->pc & 0xf);
+				}
+				else
+				{
+					wasTrue = GET_BIT(bytecode, ASEBA_IF_WAS_TRUE_BIT);
+					if (conditionResult)
+						BIT_SET(vm->bytecode[vm->pc], ASEBA_IF_WAS_TRUE_BIT);
+					else
+						BIT_CLR(vm->bytecode[vm->pc], ASEBA_IF_WAS_TRUE_BIT);
+				}
+				conditionResult = conditionResult && !wasTrue;
+			}
+			
+			if (conditionResult)
 			{
 				// if true disp
 				disp = 2;
@@ -430,12 +722,6 @@ void AsebaVMStep(AsebaVMState *vm)
 				disp = (sint16)vm->bytecode[vm->pc + 1];
 			}
 			
-			// write back condition result
-			if (conditionResult)
-				BIT_SET(vm->bytecode[vm->pc], ASEBA_IF_WAS_TRUE_BIT);
-			else
-				BIT_CLR(vm->bytecode[vm->pc], ASEBA_IF_WAS_TRUE_BIT);
-			
 			// check pc
 			#ifdef ASEBA_ASSERT
 			if ((vm->pc + disp < 0) || (vm->pc + disp >=  vm->bytecodeSize))
@@ -468,11 +754,38 @@ void AsebaVMStep(AsebaVMState *vm)
 		// Bytecode: Call
 		case ASEBA_BYTECODE_NATIVE_CALL:
 		{
+			uint16 id = bytecode & 0x0fff;
+			uint16 argsCount = 0;
+			#ifdef ASEBA_VM_PROFILER
+			AsebaVMProfiler *profiler = vm->profiler;
+			#endif
+			
+			// constant arguments follow the call, natives read them instead of popping them
+			if (bytecode & (1 << ASEBA_NATIVE_CALL_ARGS_BLOCK_BIT))
+			{
+				id = bytecode & ASEBA_NATIVE_CALL_ARGS_ID_MASK;
+				argsCount = (bytecode >> ASEBA_NATIVE_CALL_ARGS_COUNT_SHIFT) & ASEBA_NATIVE_CALL_ARGS_COUNT_MASK;
+				vm->nativeArgs = vm->bytecode + vm->pc + 1;
+			}
+			
+			#ifdef ASEBA_VM_PROFILER
+			if (profiler && (profiler->current != ASEBA_VM_PROFILER_NO_ENTRY))
+			{
+				AsebaVMProfilerEntry *entry = &profiler->entries[profiler->current];
+				uint32 startTime = profiler->clock ? profiler->clock() : 0;
+				AsebaNativeFunction(vm, id);
+				if (profiler->clock)
+					entry->nativeTime += profiler->clock() - startTime;
+				entry->nativeCallsCount++;
+			}
+			else
+			#endif
 			// call native function
-			AsebaNativeFunction(vm, bytecode & 0x0fff);
+			AsebaNativeFunction(vm, id);
+			vm->nativeArgs = 0;
 			
-			// increment PC
-			vm->pc ++;
+			// increment PC, skipping the arguments if any
+			vm->pc += 1 + argsCount;
 		}
 		break;
 		
@@ -486,6 +799,15 @@ void AsebaVMStep(AsebaVMState *vm)
 			
 			// jump
 			vm->pc = dest;
+			
+			#ifdef ASEBA_VM_PROFILER
+			// count the subroutine separately, as long as we can come back to its caller
+			if (vm->profiler && (vm->profiler->callsDepth++ < ASEBA_VM_PROFILER_CALLS_DEPTH))
+			{
+				vm->profiler->callers[vm->profiler->callsDepth - 1] = vm->profiler->current;
+				vm->profiler->current = AsebaVMGetProfilerEntry(vm->profiler, dest);
+			}
+			#endif
 		}
 		break;
 		
@@ -494,6 +816,11 @@ void AsebaVMStep(AsebaVMState *vm)
 		{
 			// do return
 			vm->pc = vm->stack[vm->sp--];
+			
+			#ifdef ASEBA_VM_PROFILER
+			if (vm->profiler && vm->profiler->callsDepth && (--vm->profiler->callsDepth < ASEBA_VM_PROFILER_CALLS_DEPTH))
+				vm->profiler->current = vm->profiler->callers[vm->profiler->callsDepth];
+			#endif
 		}
 		break;
 		
@@ -534,6 +861,18 @@ void AsebaVMEmitNodeSpecificError(AsebaVMState *vm, const char* message)
 uint16 AsebaVMCheckBreakpoint(AsebaVMState *vm)
 {
 	uint16 i;
+	
+	// constant time lookup if there is a bitmap
+	if (vm->breakpointsBitmap)
+	{
+		if (GET_BIT(vm->breakpointsBitmap[vm->pc >> 4], vm->pc & 0xf))
+		{
+			AsebaMaskSet(vm->flags, ASEBA_VM_STEP_BY_STEP_MASK);
+			return 1;
+		}
+		return 0;
+	}
+	
 	for (i = 0; i < vm->breakpointsCount; i++)
 	{
 		if (vm->breakpoints[i] == vm->pc)
@@ -650,6 +989,19 @@ uint8 AsebaVMSetBreakpoint(AsebaVMState *vm, uint16 pc)
 		AsebaAssert(vm, ASEBA_ASSERT_BREAKPOINT_OUT_OF_BYTECODE_BOUNDS);
 	#endif
 	
+	if (vm->breakpointsBitmap)
+	{
+		// breakpointsCount only tells whether to run with breakpoints, do not count twice the same address
+		if (pc >= vm->bytecodeSize)
+			return 0;
+		if (GET_BIT(vm->breakpointsBitmap[pc >> 4], pc & 0xf) == 0)
+		{
+			BIT_SET(vm->breakpointsBitmap[pc >> 4], pc & 0xf);
+			vm->breakpointsCount++;
+		}
+		return 1;
+	}
+	
 	if (vm->breakpointsCount < ASEBA_MAX_BREAKPOINTS)
 	{
 		vm->breakpoints[vm->breakpointsCount++] = pc;
@@ -663,6 +1015,18 @@ uint8 AsebaVMSetBreakpoint(AsebaVMState *vm, uint16 pc)
 uint16 AsebaVMClearBreakpoint(AsebaVMState *vm, uint16 pc)
 {
 	uint16 i;
+	
+	if (vm->breakpointsBitmap)
+	{
+		if ((pc < vm->bytecodeSize) && GET_BIT(vm->breakpointsBitmap[pc >> 4], pc & 0xf))
+		{
+			BIT_CLR(vm->breakpointsBitmap[pc >> 4], pc & 0xf);
+			vm->breakpointsCount--;
+			return 1;
+		}
+		return 0;
+	}
+	
 	for (i = 0; i < vm->breakpointsCount; i++)
 	{
 		if (vm->breakpoints[i] == pc)
@@ -681,6 +1045,8 @@ uint16 AsebaVMClearBreakpoint(AsebaVMState *vm, uint16 pc)
 /*! Clear all breakpoints. */
 void AsebaVMClearBreakpoints(AsebaVMState *vm)
 {
+	if (vm->breakpointsBitmap)
+		memset(vm->breakpointsBitmap, 0, ASEBA_VM_BREAKPOINTS_BITMAP_SIZE(vm->bytecodeSize)*sizeof(uint16));
 	vm->breakpointsCount = 0;
 }
 
@@ -703,6 +1069,13 @@ void AsebaVMDebugMessage(AsebaVMState *vm, uint16 id, uint16 *data, uint16 dataL
 		return;
 	}
 	
+	// react to global presence, when the IDE might have our description in cache
+	if (id == ASEBA_MESSAGE_GET_DESCRIPTION_HASH)
+	{
+		AsebaSendDescriptionHash(vm);
+		return;
+	}
+	
 	// check if we are the destination, return otherwise
 	if (bswap16(data[0]) != vm->nodeId)
 		return;
@@ -723,11 +1096,19 @@ void AsebaVMDebugMessage(AsebaVMState *vm, uint16 id, uint16 *data, uint16 dataL
 			#endif
 			for (i = 0; i < length; i++)
 				vm->bytecode[start+i] = bswap16(data[i+1]);
+			AsebaVMClearWhenStates(vm);
+			AsebaVMBuildEventsIndex(vm);
+			#ifdef ASEBA_VM_PROFILER
+			// the counters refer to the addresses of the previous bytecode
+			AsebaVMResetProfiler(vm);
+			#endif
 		}
 		// There is no break here because we want to do a reset after a set bytecode
 		
 		case ASEBA_MESSAGE_RESET:
 		vm->flags = ASEBA_VM_STEP_BY_STEP_MASK;
+		if (vm->eventQueue)
+			vm->eventQueue->count = 0;
 		// try to setup event, if it fails, return the execution state anyway
 		if (AsebaVMSetupEvent(vm, ASEBA_EVENT_INIT) == 0)
 			AsebaVMSendExecutionStateChanged(vm);
@@ -755,6 +1136,8 @@ void AsebaVMDebugMessage(AsebaVMState *vm, uint16 id, uint16 *data, uint16 dataL
 		
 		case ASEBA_MESSAGE_STOP:
 		vm->flags = ASEBA_VM_STEP_BY_STEP_MASK;
+		if (vm->eventQueue)
+			vm->eventQueue->count = 0;
 		AsebaVMSendExecutionStateChanged(vm);
 		break;
 		
@@ -791,6 +1174,43 @@ void AsebaVMDebugMessage(AsebaVMState *vm, uint16 id, uint16 *data, uint16 dataL
 		}
 		break;
 		
+		case ASEBA_MESSAGE_GET_VARIABLES_SNAPSHOT:
+		{
+			uint16 buffer[3];
+			uint16 start = bswap16(data[0]);
+			uint16 length = bswap16(data[1]);
+			uint16 sequence = 0;
+			#ifdef ASEBA_ASSERT
+			if (start + length > vm->variablesSize)
+				AsebaAssert(vm, ASEBA_ASSERT_OUT_OF_VARIABLES_BOUNDS);
+			#endif
+			buffer[0] = start;
+			buffer[1] = length;
+			
+			// send the variables in as many chunks as needed, then tell that the snapshot is complete
+			while (length > 0)
+			{
+				uint16 chunkLength = length > ASEBA_VARIABLES_SNAPSHOT_CHUNK_SIZE ? ASEBA_VARIABLES_SNAPSHOT_CHUNK_SIZE : length;
+				AsebaSendVariablesChunk(vm, sequence, start, chunkLength);
+				start += chunkLength;
+				length -= chunkLength;
+				sequence++;
+			}
+			buffer[2] = sequence;
+			AsebaSendMessageWords(vm, ASEBA_MESSAGE_VARIABLES_SNAPSHOT_END, buffer, 3);
+		}
+		break;
+		
+		#ifdef ASEBA_VM_PROFILER
+		case ASEBA_MESSAGE_GET_PROFILE:
+		AsebaVMSendProfile(vm);
+		break;
+		
+		case ASEBA_MESSAGE_RESET_PROFILE:
+		AsebaVMResetProfiler(vm);
+		break;
+		#endif
+		
 		case ASEBA_MESSAGE_SET_VARIABLES:
 		{
 			uint16 start = bswap16(data[0]);
@@ -817,6 +1237,10 @@ void AsebaVMDebugMessage(AsebaVMState *vm, uint16 id, uint16 *data, uint16 dataL
 		AsebaPutVmToSleep(vm);
 		break;
 		
+		case ASEBA_MESSAGE_GET_NODE_DESCRIPTION:
+		AsebaSendDescription(vm);
+		break;
+		
 		default:
 		break;
 	}
@@ -834,7 +1258,7 @@ uint16 AsebaVMShouldDropPacket(AsebaVMState *vm, uint16 source, const uint8* dat
 	{
 		// debug message
 		uint16 dest = bswap16(((const uint16*)data)[1]);
-		if (type == ASEBA_MESSAGE_GET_DESCRIPTION)
+		if (type == ASEBA_MESSAGE_GET_DESCRIPTION || type == ASEBA_MESSAGE_GET_DESCRIPTION_HASH)
 			return 0;
 		
 		// check it is for us
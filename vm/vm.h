@@ -56,6 +56,73 @@ enum
 	ASEBA_MAX_BREAKPOINTS = 16		//!< maximum number of simultaneous breakpoints the target supports
 };
 
+/*! Policies of an event queue */
+typedef enum
+{
+	ASEBA_VM_EVENT_QUEUE_FIFO = 0,	//!< events are run in their order of arrival, new events are dropped when the queue is full
+	ASEBA_VM_EVENT_QUEUE_LATEST,	//!< as FIFO, but a new event replaces the queued event with the same identifier, keeping its place
+	ASEBA_VM_EVENT_QUEUE_PRIORITY	//!< events with smaller identifiers are run first, the event with the largest identifier is dropped when the queue is full
+} AsebaVMEventQueuePolicy;
+
+/*! Events waiting for the running event handler to finish, instead of killing it.
+	The glue must set the configuration fields, the other fields are zeroed by AsebaVMInit.
+*/
+typedef struct
+{
+	// configuration
+	uint16 policy; /*!< one of AsebaVMEventQueuePolicy */
+	uint16 depth; /*!< maximum number of queued events */
+	uint16 argsSize; /*!< maximum number of arguments kept for each event */
+	uint16 sourceAddress; /*!< address of the variable receiving the source of an event, followed by the variables receiving its arguments */
+	uint16 * entries; /*!< storage of depth * ASEBA_VM_EVENT_QUEUE_ENTRY_SIZE(argsSize) words */
+	
+	// state
+	uint16 count; /*!< number of queued events */
+	
+	// statistics
+	uint16 queuedCount; /*!< number of events queued */
+	uint16 coalescedCount; /*!< number of events that replaced a queued event with the same identifier */
+	uint16 droppedCount; /*!< number of events dropped because the queue was full */
+} AsebaVMEventQueue;
+
+//! Number of words of an entry of an event queue keeping argsSize arguments
+#define ASEBA_VM_EVENT_QUEUE_ENTRY_SIZE(argsSize) ((argsSize) + 3)
+
+#ifdef ASEBA_VM_PROFILER
+
+//! Maximum depth of subroutine calls followed by the profiler, deeper subroutines are counted in their caller
+#define ASEBA_VM_PROFILER_CALLS_DEPTH 8
+//! Index of no profiler entry, for code that is not counted
+#define ASEBA_VM_PROFILER_NO_ENTRY 0xFFFF
+
+/*! Counters of an event handler or of a subroutine */
+typedef struct
+{
+	uint16 address; /*!< address of the first instruction of the event handler or subroutine */
+	uint32 instructionsCount; /*!< number of instructions executed, not counting the ones of called subroutines */
+	uint32 nativeCallsCount; /*!< number of native functions called */
+	uint32 nativeTime; /*!< time spent in native functions, in units of the clock of the profiler */
+} AsebaVMProfilerEntry;
+
+/*! Execution profiler, compiled in if ASEBA_VM_PROFILER is defined.
+	The glue must set the configuration fields, the other fields are zeroed by AsebaVMInit.
+*/
+typedef struct
+{
+	// configuration
+	uint16 entriesSize; /*!< maximum number of event handlers and subroutines profiled, further ones are not counted */
+	AsebaVMProfilerEntry * entries; /*!< storage of entriesSize entries */
+	uint32 (*clock)(void); /*!< if not 0, monotonic clock used to measure the time spent in native functions */
+	
+	// state
+	uint16 entriesCount; /*!< number of entries in use */
+	uint16 current; /*!< entry of the code being executed, or ASEBA_VM_PROFILER_NO_ENTRY */
+	uint16 callsDepth; /*!< depth of subroutine calls of the code being executed */
+	uint16 callers[ASEBA_VM_PROFILER_CALLS_DEPTH]; /*!< entries of the callers of the code being executed */
+} AsebaVMProfiler;
+
+#endif /* ASEBA_VM_PROFILER */
+
 /*! This structure contains the state of the Aseba VM.
 	This is the required and the sufficient data for the VM to run.
 	This is not sufficient for the compiler to build bytecode, as there is
@@ -91,8 +158,35 @@ typedef struct
 	// breakpoint
 	uint16 breakpoints[ASEBA_MAX_BREAKPOINTS];
 	uint16 breakpointsCount;
+	
+	// edge detection of when
+	uint16 * whenStates; /*!< if not 0, last results of conditions in a table of ASEBA_VM_WHEN_STATES_SIZE(bytecodeSize) words, so that bytecode is never written while running and can be shared by several VMs; if 0, these results are written back into bytecode */
+	
+	// event dispatch
+	uint16 eventsIndexSize; /*!< size of eventsIndex, 0 to look events up by scanning the event vector */
+	uint16 * eventsIndex; /*!< if eventsIndexSize is not 0, copy of the event vector sorted by event, see AsebaVMBuildEventsIndex() */
+	
+	// event queue
+	AsebaVMEventQueue * eventQueue; /*!< if not 0, events posted by AsebaVMQueueEvent() wait for the running handler to finish instead of killing it */
+	
+	// breakpoints lookup
+	uint16 * breakpointsBitmap; /*!< if not 0, breakpoints as one bit per address in a table of ASEBA_VM_BREAKPOINTS_BITMAP_SIZE(bytecodeSize) words, checked in constant time and not limited to ASEBA_MAX_BREAKPOINTS; if 0, breakpoints are stored in breakpoints */
+	
+	// native call
+	const uint16 * nativeArgs; /*!< during a native call whose arguments follow it in bytecode, the next argument to be read by AsebaNativePopArg(); 0 otherwise, arguments are then on the stack. Managed by the VM */
+	
+	#ifdef ASEBA_VM_PROFILER
+	// profiler
+	AsebaVMProfiler * profiler; /*!< if not 0, counts the instructions and native calls of each event handler and subroutine */
+	#endif /* ASEBA_VM_PROFILER */
 } AsebaVMState;
 
+//! Number of words of the table of the last results of conditions for a bytecode of size bytecodeSize
+#define ASEBA_VM_WHEN_STATES_SIZE(bytecodeSize) (((bytecodeSize) + 15) / 16)
+
+//! Number of words of the bitmap of breakpoints for a bytecode of size bytecodeSize
+#define ASEBA_VM_BREAKPOINTS_BITMAP_SIZE(bytecodeSize) (((bytecodeSize) + 15) / 16)
+
 // Macros to work with masks
 
 //! Set the part masked by m of v to 1
@@ -110,11 +204,17 @@ typedef struct
 
 /*! Setup the execution status of the VM.
 	This is not sufficient to have a working VM.
-	nodeId and bytecode, variables, and stack along with their sizes must be set outside this function.
-	The content of the variable array is zeroed by this function.
+	nodeId and bytecode, variables, and stack along with their sizes, whenStates, eventsIndex along with its size, eventQueue, breakpointsBitmap, and profiler if compiled in must be set outside this function.
+	The content of the variable array and of whenStates is zeroed by this function.
 */
 void AsebaVMInit(AsebaVMState *vm);
 
+/*! Build the index of the event vector, so that events are looked up by binary search.
+	Called by AsebaVMInit and when receiving bytecode, must be called after changing bytecode otherwise, for instance when loading it from flash:
+	the index is not checked against the event vector, so a stale index dispatches events to the handlers of the previous bytecode.
+	If eventsIndexSize is smaller than the event vector, events are looked up by scanning the event vector. */
+void AsebaVMBuildEventsIndex(AsebaVMState *vm);
+
 /*!	Return the starting address of an event, or 0 if the event is not handled. */
 uint16 AsebaVMGetEventAddress(AsebaVMState *vm, uint16 event);
 
@@ -123,6 +223,12 @@ uint16 AsebaVMGetEventAddress(AsebaVMState *vm, uint16 event);
 	Return the starting address of the event, or 0 if the event is not handled. */
 uint16 AsebaVMSetupEvent(AsebaVMState *vm, uint16 event);
 
+/*! Queue an event, to be run once the running event handler and the events queued before have finished.
+	If args is not 0, source and the argsCount arguments in args are written to the variables at eventQueue->sourceAddress when the event is set up.
+	If the VM has no event queue, the event is set up at once by AsebaVMSetupEvent, killing the running handler, and args are ignored.
+	Return 1 if the event was queued or set up, 0 if it is not handled or was dropped. */
+uint16 AsebaVMQueueEvent(AsebaVMState *vm, uint16 event, uint16 source, const uint16 *args, uint16 argsCount);
+
 /*! Run the VM depending on the current execution mode.
 	Either run or step, depending of the current mode.
 	If stepsLimit > 0, execute at maximim stepsLimit
@@ -156,9 +262,15 @@ void AsebaSendMessageWords(AsebaVMState *vm, uint16 type, const uint16* data, ui
 /*! Called by AsebaVMDebugMessage when some variables must be sent efficiently */
 void AsebaSendVariables(AsebaVMState *vm, uint16 start, uint16 length);
 
+/*! Called by AsebaVMDebugMessage for each chunk of a variables snapshot, length being at most ASEBA_VARIABLES_SNAPSHOT_CHUNK_SIZE */
+void AsebaSendVariablesChunk(AsebaVMState *vm, uint16 sequence, uint16 start, uint16 length);
+
 /*! Called by AsebaVMDebugMessage when VM must send its description on the network. */
 void AsebaSendDescription(AsebaVMState *vm);
 
+/*! Called by AsebaVMDebugMessage when VM must send the name, protocol version and CRC of its description on the network. */
+void AsebaSendDescriptionHash(AsebaVMState *vm);
+
 /*! Called by AsebaStep to perform a native function call. */
 void AsebaNativeFunction(AsebaVMState *vm, uint16 id);
 